@@ -0,0 +1,56 @@
+#ifndef ARPIYI_BENCH_HPP
+#define ARPIYI_BENCH_HPP
+
+#include "util/intdef.hpp"
+
+/* clang-format off */
+#include <glad/glad.h>
+#include <GLFW/glfw3.h>
+/* clang-format on */
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <limits>
+
+/// Helpers shared by the benchmark executables.
+namespace arpiyi::bench {
+
+/// Runs func the given amount of times and returns the duration of the fastest run, in
+/// milliseconds. Results that the compiler could otherwise optimize out should be accumulated
+/// into a checksum and printed.
+template<typename F> double time_ms(F&& func, u32 runs = 5) {
+    double best = std::numeric_limits<double>::max();
+    for (u32 i = 0; i < runs; ++i) {
+        const auto start = std::chrono::steady_clock::now();
+        func();
+        best = std::min(best, std::chrono::duration<double, std::milli>(
+                                  std::chrono::steady_clock::now() - start)
+                                  .count());
+    }
+    return best;
+}
+
+/// Creates a hidden window to get an OpenGL 4.5 context, for benchmarks that upload data to the
+/// GPU. Returns false if it could not be created.
+inline bool init_gl() {
+    if (!glfwInit())
+        return false;
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 4);
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 5);
+    glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+    GLFWwindow* window = glfwCreateWindow(64, 64, "arpiyi benchmark", nullptr, nullptr);
+    if (!window)
+        return false;
+    glfwMakeContextCurrent(window);
+    return gladLoadGLLoader((GLADloadproc)&glfwGetProcAddress);
+}
+
+/// Prints the name of a benchmark and the lines of text describing what it measures.
+inline void print_title(const char* title, const char* description) {
+    std::printf("%s\n%s\n\n", title, description);
+}
+
+} // namespace arpiyi::bench
+
+#endif // ARPIYI_BENCH_HPP
@@ -0,0 +1,138 @@
+// Compares the ways of recomputing the shape of every autotile of a 1024x1024 layer:
+// - Per tile, reading every neighbour through the layer and the tileset, and finding the row of the
+//   shape in an ordered set: What the editor brush used to do.
+// - The same, with rows found through the lookup tables of autotile::CompiledRules.
+// - With recompute_autotiles: What the editor does now.
+
+#include "asset_manager.hpp"
+#include "assets/map.hpp"
+#include "bench.hpp"
+#include "global_tile_size.hpp"
+
+#include <iterator>
+#include <random>
+#include <set>
+#include <vector>
+
+using namespace arpiyi;
+
+constexpr i32 layer_size = 1024;
+
+/// Old Tileset::get_id_auto, which normalized the surroundings and then found their row in a set.
+u32 get_id_auto_from_set(assets::Tileset const& tileset, u32 x_index, u32 surroundings) {
+    static const std::set<u8> tile_table = {
+        0b00000000, 0b00000001, 0b00000010, 0b00000100, 0b00000101, 0b00001000, 0b00001010,
+        0b00001100, 0b00010000, 0b00010001, 0b00010010, 0b00011000, 0b00011010, 0b00100000,
+        0b00100001, 0b00100010, 0b00100100, 0b00100101, 0b00110000, 0b00110001, 0b00110010,
+        0b01000000, 0b01000001, 0b01000010, 0b01000100, 0b01000101, 0b01001000, 0b01001010,
+        0b01001100, 0b01010000, 0b01010001, 0b01010010, 0b01011000, 0b01011010, 0b10000000,
+        0b10000001, 0b10000010, 0b10000100, 0b10000101, 0b10001000, 0b10001010, 0b10001100,
+        0b10100000, 0b10100001, 0b10100010, 0b10100100, 0b10100101};
+
+    using namespace autotile;
+    if (surroundings & upper_middle_side)
+        surroundings &= ~(upper_left_corner | upper_right_corner);
+    if (surroundings & middle_left_side)
+        surroundings &= ~(upper_left_corner | lower_left_corner);
+    if (surroundings & middle_right_side)
+        surroundings &= ~(upper_right_corner | lower_right_corner);
+    if (surroundings & lower_middle_side)
+        surroundings &= ~(lower_left_corner | lower_right_corner);
+
+    const auto it = tile_table.find(static_cast<u8>(surroundings));
+    const u32 row =
+        it == tile_table.end() ? 0 : static_cast<u32>(std::distance(tile_table.begin(), it));
+    return x_index + tileset.get_size_in_tiles().x * row;
+}
+
+/// Recomputes every tile of the layer like the editor brush used to do with the tiles around the
+/// one placed: Every tile and neighbour is read through the layer, its type is found through the
+/// tileset, and the results are then set all at once.
+template<typename F>
+void recompute_per_tile(assets::Map::Layer& layer,
+                        assets::Tileset const& tileset,
+                        F&& get_id_auto) {
+    std::vector<assets::Map::Tile> result;
+    result.reserve(static_cast<std::size_t>(layer_size) * layer_size);
+    for (i32 y = 0; y < layer_size; ++y) {
+        for (i32 x = 0; x < layer_size; ++x) {
+            const u32 type = tileset.get_x_index_from_auto_id(layer.get_tile({x, y}).id);
+            u32 surroundings = 0xFF;
+            u32 bit = 0;
+            for (i32 iy = -1; iy <= 1; ++iy) {
+                for (i32 ix = -1; ix <= 1; ++ix) {
+                    if (ix == 0 && iy == 0)
+                        continue;
+                    const math::IVec2D neighbour_pos{x + ix, y + iy};
+                    if (layer.is_pos_valid(neighbour_pos) &&
+                        tileset.get_x_index_from_auto_id(layer.get_tile(neighbour_pos).id) == type)
+                        surroundings ^= 1u << bit;
+                    ++bit;
+                }
+            }
+            result.push_back({get_id_auto(type, surroundings)});
+        }
+    }
+    layer.set_tiles({{0, 0}, {layer_size, layer_size}}, result);
+}
+
+u64 get_checksum(assets::Map::Layer const& layer) {
+    u64 checksum = 0;
+    for (auto const& tile : layer.get_tiles()) checksum += tile.id;
+    return checksum;
+}
+
+int main() {
+    bench::print_title("Autotile recompute",
+                       "Time to recompute every autotile of a 1024x1024 layer of an A2 tileset.");
+
+    global_tile_size::set(16);
+    assets::Texture texture;
+    texture.w = 16 * 8;
+    texture.h = 16 * 47;
+    assets::Tileset tileset;
+    tileset.auto_type = assets::Tileset::AutoType::rpgmaker_a2;
+    tileset.texture = asset_manager::put(texture);
+    tileset.compile_autotile_rules();
+    const auto tileset_handle = asset_manager::put(tileset);
+
+    // Blobs of 3 types of autotiles of random sizes, so that there are tiles of every shape
+    std::vector<assets::Map::Tile> tiles(static_cast<std::size_t>(layer_size) * layer_size);
+    std::mt19937 rng(42);
+    for (i32 y = 0; y < layer_size; ++y)
+        for (i32 x = 0; x < layer_size; ++x)
+            tiles[x + y * layer_size].id = ((x / 3) * 7 + (y / 4) * 5 + rng() % 2) % 3;
+
+    assets::Map::Layer layer(layer_size, layer_size, tileset_handle);
+    const auto reset_layer = [&]() { layer.set_tiles({{0, 0}, {layer_size, layer_size}}, tiles); };
+
+    const double set_ms = bench::time_ms([&]() {
+        reset_layer();
+        recompute_per_tile(layer, tileset, [&tileset](u32 x_index, u32 surroundings) {
+            return get_id_auto_from_set(tileset, x_index, surroundings);
+        });
+    });
+    const double table_ms = bench::time_ms([&]() {
+        reset_layer();
+        recompute_per_tile(layer, tileset, [&tileset](u32 x_index, u32 surroundings) {
+            return tileset.get_id_auto(x_index, surroundings);
+        });
+    });
+    const u64 per_tile_checksum = get_checksum(layer);
+    const double region_ms = bench::time_ms([&]() {
+        reset_layer();
+        assets::recompute_autotiles(layer, {{0, 0}, {layer_size, layer_size}});
+    });
+    if (get_checksum(layer) != per_tile_checksum) {
+        std::printf("recompute_autotiles and the per tile method gave different tiles.\n");
+        return -1;
+    }
+    const double reset_ms = bench::time_ms(reset_layer);
+
+    std::printf("%-32s %12s\n", "Method", "Time (ms)");
+    std::printf("%-32s %12.2f\n", "per tile, set lookup", set_ms - reset_ms);
+    std::printf("%-32s %12.2f\n", "per tile, table lookup", table_ms - reset_ms);
+    std::printf("%-32s %12.2f\n", "recompute_autotiles", region_ms - reset_ms);
+    std::printf("\nTimes exclude the %.2f ms taken to reset the layer before every run.\n",
+                reset_ms);
+}
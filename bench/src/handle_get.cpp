@@ -0,0 +1,80 @@
+// Compares the throughput of Handle::get() on the generational slot map that backs asset containers
+// against the std::unordered_map they used before, on containers of 100k assets.
+
+#include "asset_manager.hpp"
+#include "bench.hpp"
+
+#include <numeric>
+#include <random>
+#include <unordered_map>
+#include <vector>
+
+namespace arpiyi::assets {
+
+struct BenchAsset {
+    u64 value;
+};
+template<> inline void raw_unload<BenchAsset>(BenchAsset&) {}
+
+} // namespace arpiyi::assets
+
+using namespace arpiyi;
+
+constexpr u32 asset_count = 100'000;
+constexpr u32 rounds = 100;
+
+/// Lookup done by Handle::get() before asset containers used a slot map.
+struct UnorderedMapStorage {
+    std::unordered_map<u64, assets::BenchAsset> map;
+
+    Expected<assets::BenchAsset> get(u64 id) {
+        const auto it = map.find(id);
+        return it == map.end() ? Expected<assets::BenchAsset>(nullptr) :
+                                 Expected<assets::BenchAsset>(&it->second);
+    }
+};
+
+int main() {
+    bench::print_title("Handle::get() throughput",
+                       "100 rounds of looking up every asset of a container of 100k assets.");
+
+    std::vector<Handle<assets::BenchAsset>> handles;
+    UnorderedMapStorage old_storage;
+    handles.reserve(asset_count);
+    for (u32 i = 0; i < asset_count; ++i) {
+        handles.emplace_back(asset_manager::put(assets::BenchAsset{i}));
+        old_storage.map.emplace(handles.back().get_id(), assets::BenchAsset{i});
+    }
+
+    // Scripts and renderers don't always access assets in the order they were created in
+    std::vector<u32> random_order(asset_count);
+    std::iota(random_order.begin(), random_order.end(), 0);
+    std::shuffle(random_order.begin(), random_order.end(), std::mt19937(42));
+    std::vector<u32> sequential_order(asset_count);
+    std::iota(sequential_order.begin(), sequential_order.end(), 0);
+
+    std::printf("%-12s %-16s %12s %12s\n", "Order", "Storage", "Total (ms)", "ns/get");
+    u64 checksum = 0;
+    for (auto const& [order_name, order] : {std::make_pair("sequential", &sequential_order),
+                                            std::make_pair("random", &random_order)}) {
+        const double slot_map_ms = bench::time_ms([&, order = order]() {
+            for (u32 round = 0; round < rounds; ++round)
+                for (const u32 i : *order)
+                    if (auto asset = handles[i].get())
+                        checksum += asset->value;
+        });
+        const double unordered_map_ms = bench::time_ms([&, order = order]() {
+            for (u32 round = 0; round < rounds; ++round)
+                for (const u32 i : *order)
+                    if (auto asset = old_storage.get(handles[i].get_id()))
+                        checksum += asset->value;
+        });
+
+        constexpr double gets = static_cast<double>(rounds) * asset_count;
+        std::printf("%-12s %-16s %12.2f %12.2f\n", order_name, "slot map", slot_map_ms,
+                    slot_map_ms * 1e6 / gets);
+        std::printf("%-12s %-16s %12.2f %12.2f\n", order_name, "unordered_map", unordered_map_ms,
+                    unordered_map_ms * 1e6 / gets);
+    }
+    std::printf("\nChecksum: %llu\n", static_cast<unsigned long long>(checksum));
+}
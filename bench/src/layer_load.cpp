@@ -0,0 +1,82 @@
+// Compares the ways of filling the tiles of a newly loaded map layer, across map sizes:
+// - Per tile, rebuilding the mesh after every tile: What loading maps used to do.
+// - Per tile, with the mesh updated once afterwards.
+// - All at once with Layer::set_tiles, with the mesh updated once afterwards: What loading maps
+//   does now.
+// Every method ends with the layer mesh uploaded to the GPU.
+
+#include "asset_manager.hpp"
+#include "assets/map.hpp"
+#include "bench.hpp"
+#include "global_tile_size.hpp"
+
+#include <algorithm>
+#include <vector>
+
+using namespace arpiyi;
+
+/// Rebuilding the whole mesh for every tile takes quadratic time, so the first tiles are timed and
+/// the rest estimated from them.
+constexpr u64 max_rebuilt_tiles = 2048;
+
+int main() {
+    bench::print_title("Map layer load",
+                       "Time to fill every tile of a new layer and upload its mesh.");
+    if (!bench::init_gl()) {
+        std::printf("Could not create an OpenGL 4.5 context.\n");
+        return -1;
+    }
+
+    global_tile_size::set(16);
+    assets::Texture texture;
+    texture.w = 16 * 8;
+    texture.h = 16 * 16;
+    assets::Tileset tileset;
+    tileset.texture = asset_manager::put(texture);
+    const auto tileset_handle = asset_manager::put(tileset);
+
+    std::printf("%-10s %26s %24s %16s\n", "Size", "Per tile + rebuild (ms)",
+                "Per tile, deferred (ms)", "set_tiles (ms)");
+    for (const i32 size : {32, 64, 128, 256, 512, 1024}) {
+        const u64 tile_count = static_cast<u64>(size) * size;
+        std::vector<assets::Map::Tile> tiles(tile_count);
+        for (u64 i = 0; i < tile_count; ++i) tiles[i].id = static_cast<u32>(i % 128);
+
+        const u64 rebuilt_tiles = std::min(tile_count, max_rebuilt_tiles);
+        const auto fill_and_rebuild_per_tile = [&]() {
+            assets::Map::Layer layer(size, size, tileset_handle);
+            for (u64 i = 0; i < rebuilt_tiles; ++i) {
+                layer.set_tile({static_cast<i32>(i % size), static_cast<i32>(i / size)}, tiles[i]);
+                layer.regenerate_mesh();
+            }
+            glFinish();
+            layer.unload_render_data();
+        };
+        const double rebuild_ms = bench::time_ms(fill_and_rebuild_per_tile, 1) *
+                                  static_cast<double>(tile_count) / rebuilt_tiles;
+
+        const double deferred_ms = bench::time_ms([&]() {
+            assets::Map::Layer layer(size, size, tileset_handle);
+            for (u64 i = 0; i < tile_count; ++i)
+                layer.set_tile({static_cast<i32>(i % size), static_cast<i32>(i / size)}, tiles[i]);
+            layer.update_mesh();
+            glFinish();
+            layer.unload_render_data();
+        });
+
+        const double bulk_ms = bench::time_ms([&]() {
+            assets::Map::Layer layer(size, size, tileset_handle);
+            layer.set_tiles({{0, 0}, {size, size}}, tiles);
+            layer.update_mesh();
+            glFinish();
+            layer.unload_render_data();
+        });
+
+        char size_str[16];
+        std::snprintf(size_str, sizeof(size_str), "%ix%i", size, size);
+        std::printf("%-10s %22.2f%-4s %24.2f %16.2f\n", size_str, rebuild_ms,
+                    rebuilt_tiles < tile_count ? " (*)" : "", deferred_ms, bulk_ms);
+    }
+    std::printf("\n(*) Estimated from the time taken by the first %llu tiles.\n",
+                static_cast<unsigned long long>(max_rebuilt_tiles));
+}
@@ -0,0 +1,98 @@
+// Compares the time a Lua script takes to update the positions of 10k entities every frame, with
+// the entities passed to Lua as:
+// - Handles: The asset is looked up in its container on every field access.
+// - LuaHandles: The pointer to the asset is kept until its container changes. What scripts get now.
+// - LuaHandles, with an entity added and removed every frame so that their pointers have to be
+//   looked up again once per frame.
+// - Raw pointers to the entities, as the lower bound.
+
+#include "api/api.hpp"
+#include "api/lua_bindings_cg.hpp" // codegen
+#include "assets/entity.hpp"
+#include "bench.hpp"
+
+#include <anton/math/vector2.hpp>
+#include <vector>
+
+using namespace arpiyi;
+
+constexpr u32 entity_count = 10'000;
+constexpr u32 frames = 100;
+
+constexpr const char* update_script = R"(
+function update(entities)
+    for i = 1, #entities do
+        local e = entities[i]
+        e.pos.x = e.pos.x + 0.5
+        e.pos.y = e.pos.y - 0.5
+    end
+end
+)";
+
+/// @returns The time taken to run the update script for every frame, in milliseconds per frame.
+/// get_entity returns what to pass to Lua for each entity handle, and before_frame is called before
+/// every frame.
+template<typename F, typename G>
+double time_frames(std::vector<Handle<assets::Entity>> const& entities,
+                   F&& get_entity,
+                   G&& before_frame) {
+    sol::state lua;
+    lua.open_libraries(sol::lib::base);
+    sol::table game_table = lua.create_named_table("game");
+    /* clang-format off */
+    game_table.new_usertype<aml::Vector2>("Vec2",
+            "x", &aml::Vector2::x,
+            "y", &aml::Vector2::y
+            );
+    /* clang-format on */
+    api::define_usertype<assets::Entity>(game_table);
+    lua.script(update_script);
+
+    sol::table entity_table = lua.create_table();
+    for (u32 i = 0; i < entities.size(); ++i) entity_table[i + 1] = get_entity(entities[i]);
+
+    sol::protected_function update = lua["update"];
+    return bench::time_ms([&]() {
+               for (u32 frame = 0; frame < frames; ++frame) {
+                   before_frame();
+                   const auto result = update(entity_table);
+                   if (!result.valid()) {
+                       sol::error error = result;
+                       std::printf("Script error: %s\n", error.what());
+                       return;
+                   }
+               }
+           }) /
+           frames;
+}
+
+int main() {
+    bench::print_title("Lua entity update",
+                       "Time per frame of a script that moves 10k entities every frame.");
+
+    std::vector<Handle<assets::Entity>> entities;
+    entities.reserve(entity_count);
+    for (u32 i = 0; i < entity_count; ++i)
+        entities.emplace_back(asset_manager::put(assets::Entity{}));
+
+    const auto no_setup = []() {};
+    const auto change_container = []() {
+        auto temporary = asset_manager::put(assets::Entity{});
+        temporary.unload();
+    };
+
+    const auto as_handle = [](Handle<assets::Entity> e) { return e; };
+    const auto as_lua_handle = [](Handle<assets::Entity> e) { return api::LuaHandle(e); };
+    const auto as_pointer = [](Handle<assets::Entity> e) { return &*e.get(); };
+
+    std::printf("%-32s %14s\n", "Passed as", "ms/frame");
+    std::printf("%-32s %14.3f\n", "Handle", time_frames(entities, as_handle, no_setup));
+    std::printf("%-32s %14.3f\n", "LuaHandle", time_frames(entities, as_lua_handle, no_setup));
+    std::printf("%-32s %14.3f\n", "LuaHandle, container changed",
+                time_frames(entities, as_lua_handle, change_container));
+    std::printf("%-32s %14.3f\n", "Raw pointer", time_frames(entities, as_pointer, no_setup));
+
+    double checksum = 0;
+    for (auto const& e : entities) checksum += e.get()->pos.x - e.get()->pos.y;
+    std::printf("\nChecksum: %.1f\n", checksum);
+}
@@ -0,0 +1,99 @@
+// Compares the overhead of accessing the fields of an entity from Lua through different bindings of
+// the Entity usertype:
+// - The ones generated from the [[lua::expose]] attribute: What the API uses now.
+// - Hand-written with member pointers: What the API used before bindings were generated.
+// - Hand-written with a getter and setter function for every field.
+// Every binding gets its own Lua state, with the same script and entity.
+
+#include "api/api.hpp"
+#include "api/lua_bindings_cg.hpp" // codegen
+#include "assets/entity.hpp"
+#include "bench.hpp"
+
+#include <anton/math/vector2.hpp>
+
+using namespace arpiyi;
+
+constexpr u32 iterations = 1'000'000;
+
+constexpr const char* field_access_script = R"(
+function run(entity, iterations)
+    for i = 1, iterations do
+        entity.pos.x = entity.pos.x + 1
+        entity.pos.y = entity.pos.y - 1
+    end
+end
+)";
+
+/// Registers Vec2 like the API does, so that entity positions can be accessed.
+void define_vec2(sol::table& game_table) {
+    /* clang-format off */
+    game_table.new_usertype<aml::Vector2>("Vec2",
+            "x", &aml::Vector2::x,
+            "y", &aml::Vector2::y
+            );
+    /* clang-format on */
+}
+
+void define_generated_entity(sol::table& game_table) {
+    api::define_usertype<assets::Entity>(game_table);
+}
+
+void define_member_pointer_entity(sol::table& game_table) {
+    /* clang-format off */
+    game_table.new_usertype<assets::Entity>("Entity",
+                                            "pos", &assets::Entity::pos,
+                                            "name", &assets::Entity::name,
+                                            "sprite", &assets::Entity::sprite
+    );
+    /* clang-format on */
+}
+
+void define_property_entity(sol::table& game_table) {
+    using assets::Entity;
+    /* clang-format off */
+    game_table.new_usertype<Entity>("Entity",
+        "pos", sol::property([](Entity& e) -> aml::Vector2& { return e.pos; },
+                             [](Entity& e, aml::Vector2 const& pos) { e.pos = pos; }),
+        "name", sol::property([](Entity& e) -> std::string& { return e.name; },
+                              [](Entity& e, std::string const& name) { e.name = name; }),
+        "sprite", sol::property([](Entity& e) { return e.sprite; },
+                                [](Entity& e, Handle<assets::Sprite> sprite) { e.sprite = sprite; })
+    );
+    /* clang-format on */
+}
+
+/// @returns The time taken to run the field access script with the given Entity usertype.
+double time_field_access(void (*define_entity)(sol::table&), assets::Entity& entity) {
+    sol::state lua;
+    lua.open_libraries(sol::lib::base);
+    sol::table game_table = lua.create_named_table("game");
+    define_vec2(game_table);
+    define_entity(game_table);
+    lua.script(field_access_script);
+
+    sol::protected_function run = lua["run"];
+    return bench::time_ms([&]() {
+        const auto result = run(&entity, iterations);
+        if (!result.valid()) {
+            sol::error error = result;
+            std::printf("Script error: %s\n", error.what());
+        }
+    });
+}
+
+int main() {
+    bench::print_title("Lua field access",
+                       "Time to read and write the position of an entity 1M times from Lua.");
+
+    assets::Entity entity;
+    std::printf("%-20s %12s %14s\n", "Binding", "Total (ms)", "ns/iteration");
+    for (auto const& [binding, define_entity] :
+         {std::make_pair("generated", &define_generated_entity),
+          std::make_pair("member pointers", &define_member_pointer_entity),
+          std::make_pair("get/set functions", &define_property_entity)}) {
+        const double ms = time_field_access(define_entity, entity);
+        std::printf("%-20s %12.2f %14.2f\n", binding, ms, ms * 1e6 / iterations);
+    }
+    std::printf("\nChecksum: %.1f\n", static_cast<double>(entity.pos.x - entity.pos.y));
+}
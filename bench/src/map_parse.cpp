@@ -0,0 +1,211 @@
+// Compares the time and peak memory taken to read map files with their tile data stored as plain
+// JSON arrays, across map sizes:
+// - Copying the file into a string and parsing it into a DOM: What loading maps used to do.
+// - Parsing the file into a DOM while reading it in blocks, as assets::parse_json_file does for
+//   other JSON assets now.
+// - Parsing the file in blocks with the SAX handler of raw_prepare_load<Map>, which writes tile IDs
+//   straight into the layer tile vectors: What loading maps does now.
+// DOM methods include the time spent copying the tile IDs out of the DOM.
+// Memory is tracked by replacing operator new, and DOMs are given an allocator that uses it. The
+// SAX reader keeps using malloc for its stack, but it only ever holds the current key or string.
+
+#include "assets/map.hpp"
+#include "bench.hpp"
+
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <new>
+#include <rapidjson/document.h>
+#include <rapidjson/filereadstream.h>
+#include <rapidjson/stringbuffer.h>
+#include <rapidjson/writer.h>
+#include <sstream>
+#include <string>
+#include <vector>
+
+// Allocation tracking. Benchmarks are single threaded, so no synchronization is needed.
+namespace {
+std::size_t allocated_bytes = 0;
+std::size_t peak_allocated_bytes = 0;
+/// Allocations are prefixed with their size so that it's known when they are freed.
+constexpr std::size_t size_prefix = alignof(std::max_align_t);
+} // namespace
+
+void* operator new(std::size_t size) {
+    auto* block = static_cast<char*>(std::malloc(size + size_prefix));
+    if (!block)
+        throw std::bad_alloc();
+    *reinterpret_cast<std::size_t*>(block) = size;
+    allocated_bytes += size;
+    peak_allocated_bytes = std::max(peak_allocated_bytes, allocated_bytes);
+    return block + size_prefix;
+}
+
+void operator delete(void* ptr) noexcept {
+    if (!ptr)
+        return;
+    auto* block = static_cast<char*>(ptr) - size_prefix;
+    allocated_bytes -= *reinterpret_cast<std::size_t*>(block);
+    std::free(block);
+}
+
+void operator delete(void* ptr, std::size_t) noexcept { operator delete(ptr); }
+
+using namespace arpiyi;
+
+/// rapidjson allocator that goes through operator new, so that the memory of DOMs is tracked too.
+struct TrackedAllocator {
+    static const bool kNeedFree = true;
+
+    void* Malloc(std::size_t size) { return size ? ::operator new(size) : nullptr; }
+    void* Realloc(void* original, std::size_t original_size, std::size_t new_size) {
+        if (new_size == 0) {
+            Free(original);
+            return nullptr;
+        }
+        void* result = ::operator new(new_size);
+        if (original) {
+            std::memcpy(result, original, std::min(original_size, new_size));
+            Free(original);
+        }
+        return result;
+    }
+    static void Free(void* ptr) { ::operator delete(ptr); }
+
+    bool operator==(TrackedAllocator const&) const { return true; }
+    bool operator!=(TrackedAllocator const&) const { return false; }
+};
+using TrackedDocument =
+    rapidjson::GenericDocument<rapidjson::UTF8<>, rapidjson::MemoryPoolAllocator<TrackedAllocator>,
+                               TrackedAllocator>;
+
+constexpr u32 layer_count = 4;
+
+/// Writes a map file with plain array tile data, like the ones older versions of the editor save.
+void write_map_file(fs::path const& path, i32 size) {
+    rapidjson::StringBuffer s;
+    rapidjson::Writer<rapidjson::StringBuffer> w(s);
+    w.StartObject();
+    w.Key("name");
+    w.String("Benchmark map");
+    w.Key("width");
+    w.Int64(size);
+    w.Key("height");
+    w.Int64(size);
+    w.Key("layers");
+    w.StartArray();
+    for (u32 layer = 0; layer < layer_count; ++layer) {
+        w.StartObject();
+        w.Key("name");
+        w.String("Layer");
+        w.Key("tileset");
+        w.Uint64(0);
+        w.Key("data");
+        w.StartArray();
+        for (i64 i = 0; i < static_cast<i64>(size) * size; ++i)
+            w.Uint(static_cast<u32>((i / 7 + layer) % 512));
+        w.EndArray();
+        w.EndObject();
+    }
+    w.EndArray();
+    w.Key("comments");
+    w.StartArray();
+    w.EndArray();
+    w.Key("entities");
+    w.StartArray();
+    w.EndArray();
+    w.EndObject();
+
+    std::ofstream f(path, std::ios::binary);
+    f.write(s.GetString(), s.GetSize());
+}
+
+/// Copies the tiles of every layer out of a parsed map document.
+std::vector<std::vector<assets::Map::Tile>> get_document_tiles(TrackedDocument const& doc) {
+    std::vector<std::vector<assets::Map::Tile>> layers;
+    for (auto const& layer : doc["layers"].GetArray()) {
+        auto const& data = layer["data"].GetArray();
+        auto& tiles = layers.emplace_back();
+        tiles.reserve(data.Size());
+        for (auto const& id : data) tiles.push_back({id.GetUint()});
+    }
+    return layers;
+}
+
+struct Measurement {
+    double ms;
+    std::size_t peak_bytes;
+    u64 checksum;
+};
+
+/// Times load_func and measures the peak amount of memory allocated while it runs, including its
+/// result.
+template<typename F> Measurement measure(F&& load_func) {
+    Measurement m{};
+    m.ms = bench::time_ms([&]() {
+        const std::size_t base_bytes = allocated_bytes;
+        peak_allocated_bytes = base_bytes;
+        const auto layers = load_func();
+        m.peak_bytes = peak_allocated_bytes - base_bytes;
+        m.checksum = 0;
+        for (auto const& tiles : layers)
+            for (auto const& tile : tiles) m.checksum += tile.id;
+    });
+    return m;
+}
+
+int main() {
+    bench::print_title("Map parse", "Time and peak memory taken to read map files with 4 layers "
+                                    "stored as plain JSON arrays.");
+
+    const fs::path path = fs::temp_directory_path() / "arpiyi_bench_map.json";
+    std::printf("%-10s %10s %-22s %12s %16s\n", "Size", "File (MB)", "Method", "Time (ms)",
+                "Peak memory (MB)");
+    for (const i32 size : {128, 256, 512, 1024}) {
+        write_map_file(path, size);
+
+        const Measurement string_dom = measure([&]() {
+            std::ifstream f(path);
+            std::stringstream buffer;
+            buffer << f.rdbuf();
+            const std::string data = buffer.str();
+            TrackedDocument doc;
+            doc.Parse(data.c_str());
+            return get_document_tiles(doc);
+        });
+        // Same as assets::parse_json_file, with a tracked document
+        const Measurement stream_dom = measure([&]() {
+            std::FILE* file = std::fopen(path.generic_string().c_str(), "rb");
+            char buffer[64 * 1024];
+            rapidjson::FileReadStream stream(file, buffer, sizeof(buffer));
+            TrackedDocument doc;
+            doc.ParseStream(stream);
+            std::fclose(file);
+            return get_document_tiles(doc);
+        });
+        const Measurement stream_sax = measure([&]() {
+            auto prepared = assets::raw_prepare_load<assets::Map>({path});
+            std::vector<std::vector<assets::Map::Tile>> layers;
+            for (auto& layer : prepared.layers) layers.emplace_back(std::move(layer.tiles));
+            return layers;
+        });
+        if (string_dom.checksum != stream_sax.checksum ||
+            stream_dom.checksum != stream_sax.checksum) {
+            std::printf("Methods loaded different tiles.\n");
+            return -1;
+        }
+
+        char size_str[16];
+        std::snprintf(size_str, sizeof(size_str), "%ix%i", size, size);
+        const double file_mb = static_cast<double>(fs::file_size(path)) / (1024 * 1024);
+        for (auto const& [method, m] : {std::make_pair("string + DOM", string_dom),
+                                        std::make_pair("streamed DOM", stream_dom),
+                                        std::make_pair("streamed SAX", stream_sax)}) {
+            std::printf("%-10s %10.2f %-22s %12.2f %16.2f\n", size_str, file_mb, method, m.ms,
+                        static_cast<double>(m.peak_bytes) / (1024 * 1024));
+        }
+    }
+    fs::remove(path);
+}
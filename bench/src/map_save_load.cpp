@@ -0,0 +1,134 @@
+// Compares the file size, save time and load time of 1024x1024 maps with 4 layers, with their tile
+// data stored as:
+// - Plain JSON arrays of tile IDs: What saving maps used to do.
+// - Deflate-compressed runs of tiles encoded in base64: What saving maps does now.
+// Maps are tried with different contents, from layers with large areas of the same tile to random
+// noise, which is the worst case for run-length encoding. Both formats are loaded with
+// raw_prepare_load<Map>, and saving includes writing the file to disk.
+
+#include "assets/map.hpp"
+#include "bench.hpp"
+
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <random>
+#include <rapidjson/stringbuffer.h>
+#include <rapidjson/writer.h>
+#include <vector>
+
+using namespace arpiyi;
+
+constexpr i32 map_size = 1024;
+constexpr u32 layer_count = 4;
+
+/// Old raw_get_save_data<Map>, which wrote the ID of every tile as a JSON number.
+assets::RawSaveData get_json_array_save_data(assets::SaveSnapshot<assets::Map> const& map) {
+    rapidjson::StringBuffer s;
+    rapidjson::Writer<rapidjson::StringBuffer> w(s);
+    w.StartObject();
+    w.Key("name");
+    w.String(map.name.c_str());
+    w.Key("width");
+    w.Int64(map.width);
+    w.Key("height");
+    w.Int64(map.height);
+    w.Key("layers");
+    w.StartArray();
+    for (const auto& layer : map.layers) {
+        w.StartObject();
+        w.Key("name");
+        w.String(layer.name.c_str());
+        w.Key("tileset");
+        w.Uint64(layer.tileset_id);
+        w.Key("data");
+        w.StartArray();
+        for (const auto& tile : *layer.tiles) w.Uint(tile.id);
+        w.EndArray();
+        w.EndObject();
+    }
+    w.EndArray();
+    w.Key("comments");
+    w.StartArray();
+    w.EndArray();
+    w.Key("entities");
+    w.StartArray();
+    w.EndArray();
+    w.EndObject();
+
+    assets::RawSaveData data;
+    data.bytestream.write(s.GetString(), s.GetSize());
+    return data;
+}
+
+void write_file(fs::path const& path, assets::RawSaveData const& data) {
+    std::ofstream f(path, std::ios::binary);
+    f << data.bytestream.rdbuf();
+}
+
+/// Builds a map where every layer has the tiles returned by get_id(layer, x, y).
+template<typename F> assets::SaveSnapshot<assets::Map> make_map(F&& get_id) {
+    assets::SaveSnapshot<assets::Map> map{"Benchmark map", map_size, map_size, {}, {}, {}};
+    for (u32 layer = 0; layer < layer_count; ++layer) {
+        auto tiles = std::make_shared<std::vector<assets::Map::Tile>>();
+        tiles->reserve(static_cast<std::size_t>(map_size) * map_size);
+        for (i32 y = 0; y < map_size; ++y)
+            for (i32 x = 0; x < map_size; ++x) tiles->push_back({get_id(layer, x, y)});
+        map.layers.push_back({"Layer", 0, std::move(tiles)});
+    }
+    return map;
+}
+
+int main() {
+    bench::print_title("Map save/load", "File size, save time and load time of 1024x1024 maps "
+                                        "with 4 layers.");
+
+    std::mt19937 rng(42);
+    const auto noise = [&rng](u32, i32, i32) { return static_cast<u32>(rng() % 512); };
+    // Areas of 16x16 tiles, like terrain painted with the rectangle tool
+    const auto areas = [](u32 layer, i32 x, i32 y) {
+        return static_cast<u32>((x / 16 * 7 + y / 16 * 13 + layer) % 64);
+    };
+    // Upper layers are mostly empty, with a few decorations
+    const auto sparse = [](u32 layer, i32 x, i32 y) {
+        if (layer == 0)
+            return static_cast<u32>((x / 32 + y / 32) % 8);
+        return (x * 31 + y * 17 + static_cast<i32>(layer)) % 97 == 0 ? 100 + layer : 0u;
+    };
+
+    const fs::path path = fs::temp_directory_path() / "arpiyi_bench_map.json";
+    std::printf("%-10s %-14s %12s %12s %12s\n", "Contents", "Format", "Size (MB)", "Save (ms)",
+                "Load (ms)");
+    for (auto const& [contents, map] : {std::make_pair("areas", make_map(areas)),
+                                        std::make_pair("sparse", make_map(sparse)),
+                                        std::make_pair("noise", make_map(noise))}) {
+        u64 expected_checksum = 0;
+        for (auto const& layer : map.layers)
+            for (auto const& tile : *layer.tiles) expected_checksum += tile.id;
+
+        using SaveFunc = assets::RawSaveData (*)(assets::SaveSnapshot<assets::Map> const&);
+        for (auto const& [format, save] :
+             {std::make_pair("JSON array", &get_json_array_save_data),
+              std::make_pair("RLE + deflate",
+                             static_cast<SaveFunc>(&assets::raw_get_snapshot_save_data))}) {
+            const double save_ms =
+                bench::time_ms([&, save = save]() { write_file(path, save(map)); });
+            u64 checksum = 0;
+            const double load_ms = bench::time_ms([&]() {
+                const auto prepared = assets::raw_prepare_load<assets::Map>({path});
+                checksum = 0;
+                for (auto const& layer : prepared.layers)
+                    for (auto const& tile : layer.tiles) checksum += tile.id;
+            });
+            if (checksum != expected_checksum) {
+                std::printf("The %s map did not load back correctly.\n", format);
+                return -1;
+            }
+
+            std::printf("%-10s %-14s %12.2f %12.2f %12.2f\n", contents, format,
+                        static_cast<double>(fs::file_size(path)) / (1024 * 1024), save_ms,
+                        load_ms);
+        }
+    }
+    fs::remove(path);
+}
@@ -0,0 +1,25 @@
+#version 430 core
+
+// Draws a whole map layer on a single 0-1 quad. The ID of each tile is read from an integer texture
+// with one texel per tile, and then used to sample the tileset.
+
+in vec2 TexCoords;
+
+layout(location = 0) uniform sampler2D tileset;
+layout(binding = 1) uniform usampler2D tile_ids;
+// Size of the tileset, in tiles.
+layout(location = 3) uniform uvec2 tileset_size;
+
+out vec4 FragColor;
+
+void main() {
+    ivec2 map_size = textureSize(tile_ids, 0);
+    // Quad Y goes from the bottom of the map to the top, but tile rows go from top to bottom.
+    vec2 map_pos = vec2(TexCoords.x, 1.0 - TexCoords.y) * vec2(map_size);
+    ivec2 tile_pos = clamp(ivec2(floor(map_pos)), ivec2(0), map_size - 1);
+    uint id = texelFetch(tile_ids, tile_pos, 0).r;
+
+    vec2 tileset_pos = vec2(id % tileset_size.x, id / tileset_size.x);
+    vec2 uv = (tileset_pos + fract(map_pos)) / vec2(tileset_size);
+    FragColor = texture(tileset, uv).rgba;
+}
@@ -0,0 +1,27 @@
+#version 430 core
+
+// Expands a 0-1 unit quad into the tile given by the per-instance attributes. Positions are given
+// in tiles, so the model matrix must scale from tiles, not from the whole map.
+
+layout(location = 0) in vec2 iPos;
+layout(location = 1) in vec2 iTexCoords;
+layout(location = 2) in uvec2 iTilePos;
+layout(location = 3) in uint iTileID;
+
+layout(location = 1) uniform mat4 model;
+layout(location = 2) uniform mat4 projection;
+// Size of the tileset, in tiles.
+layout(location = 3) uniform uvec2 tileset_size;
+// Height of the map, in tiles.
+layout(location = 4) uniform uint map_height;
+
+out vec2 TexCoords;
+
+void main() {
+    // Tile rows go from top to bottom, but model Y goes from the bottom of the map to the top.
+    vec2 tile_pos = vec2(iTilePos.x, map_height - iTilePos.y - 1u);
+    vec2 tileset_pos = vec2(iTileID % tileset_size.x, iTileID / tileset_size.x);
+    TexCoords = (tileset_pos + vec2(iTexCoords.x, 1.0 - iTexCoords.y)) / vec2(tileset_size);
+
+    gl_Position = projection * model * vec4(tile_pos + iPos, 0, 1);
+}
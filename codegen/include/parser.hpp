@@ -21,11 +21,20 @@ struct Attribute {
     std::string scope;
 };
 
+/// A public non-static data member of a struct.
+struct Member {
+    std::vector<Attribute> attributes;
+    /// Type as written in the declaration, so it may be relative to the struct scope.
+    std::string type;
+    std::string name;
+};
+
 struct AttributedEntity {
     std::vector<Attribute> attributes;
     std::string name;
     // TODO: implement scope as well
     EntityType type;
+    std::vector<Member> members;
 };
 
 std::vector<AttributedEntity> parse_cpp_file(fs::path const& path);
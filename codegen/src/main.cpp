@@ -4,6 +4,7 @@
 #include <cassert>
 #include <filesystem>
 #include <fstream>
+#include <cstdlib>
 #include <iostream>
 #include <string>
 
@@ -11,6 +12,7 @@ namespace fs = std::filesystem;
 using namespace arpiyi::codegen;
 
 struct AssetWithDirName {
+    fs::path header_path;
     AttributedEntity asset_entity;
     Attribute dir_name_attribute;
 };
@@ -20,9 +22,82 @@ struct SerializableAsset {
     AttributedEntity asset_entity;
     /// Names of asset types that must be loaded before this one.
     std::vector<std::string> asset_load_dependencies;
+    /// Argument of the [[assets::binary_format]] attribute, or empty if the asset implements its
+    /// own save and load functions.
+    std::string binary_format_version;
+};
+
+struct LuaExposedAsset {
+    fs::path header_path;
+    AttributedEntity asset_entity;
+    /// Name of the usertype in Lua, quoted.
+    std::string lua_name;
 };
 
-void create_assets_codegen_file(std::vector<AssetWithDirName> const& assets_with_dir_name) {
+bool has_attribute(std::vector<Attribute> const& attributes,
+                   std::string_view scope,
+                   std::string_view name) {
+    return std::find_if(attributes.begin(), attributes.end(), [&](Attribute const& attr) {
+               return attr.scope == scope && attr.name == name;
+           }) != attributes.end();
+}
+
+/// Groups the given assets by dependency level: Assets only depend on assets of previous levels, so
+/// the ones in the same level can be loaded at the same time.
+std::vector<std::vector<SerializableAsset>>
+get_load_levels(std::vector<SerializableAsset> const& serializable_assets) {
+    std::vector<std::vector<SerializableAsset>> levels;
+    std::vector<std::string> leveled_assets;
+    const auto is_leveled = [&leveled_assets](std::string const& name) {
+        return std::find(leveled_assets.begin(), leveled_assets.end(), name) !=
+               leveled_assets.end();
+    };
+
+    while (leveled_assets.size() != serializable_assets.size()) {
+        std::vector<SerializableAsset> level;
+        for (const auto& asset : serializable_assets) {
+            if (is_leveled(asset.asset_entity.name))
+                continue;
+            const auto& dependencies = asset.asset_load_dependencies;
+            if (std::all_of(dependencies.begin(), dependencies.end(), is_leveled))
+                level.emplace_back(asset);
+        }
+        if (level.empty()) {
+            std::cerr << "Unresolvable assets::load_before dependencies" << std::endl;
+            std::exit(-1);
+        }
+        // Only add them once the whole level is known so that they don't depend on each other
+        for (const auto& asset : level) leveled_assets.emplace_back(asset.asset_entity.name);
+        levels.emplace_back(std::move(level));
+    }
+    return levels;
+}
+
+/// @returns The asset types with a directory name, in load order: Serializable types level by
+/// level, and then the rest.
+std::vector<AssetWithDirName>
+get_registered_assets(std::vector<AssetWithDirName> const& assets_with_dir_name,
+                      std::vector<std::vector<SerializableAsset>> const& load_levels) {
+    std::vector<AssetWithDirName> registered_assets;
+    const auto register_asset = [&](std::string const& name) {
+        const auto asset = std::find_if(
+            assets_with_dir_name.begin(), assets_with_dir_name.end(),
+            [&name](AssetWithDirName const& other) { return other.asset_entity.name == name; });
+        const auto registered = std::find_if(
+            registered_assets.begin(), registered_assets.end(),
+            [&name](AssetWithDirName const& other) { return other.asset_entity.name == name; });
+        if (asset != assets_with_dir_name.end() && registered == registered_assets.end())
+            registered_assets.emplace_back(*asset);
+    };
+    for (const auto& level : load_levels) {
+        for (const auto& asset : level) register_asset(asset.asset_entity.name);
+    }
+    for (const auto& asset : assets_with_dir_name) register_asset(asset.asset_entity.name);
+    return registered_assets;
+}
+
+void create_assets_codegen_file(std::vector<AssetWithDirName> const& registered_assets,
+                                std::vector<std::vector<SerializableAsset>> const& load_levels) {
     const fs::path assets_out_path = "build/shared/include/assets/asset_cg.hpp";
     fs::create_directories(assets_out_path.parent_path());
     auto out_f = std::ofstream(assets_out_path);
@@ -30,119 +105,207 @@ void create_assets_codegen_file(std::vector<AssetWithDirName> const& assets_with
           << "// Generated header for usage with the arpiyi shared library.\n"
           << "#ifndef ARPIYI_ASSET_CG_HPP\n"
           << "#define ARPIYI_ASSET_CG_HPP\n\n"
+          << "#include \"util/intdef.hpp\"\n"
+          << "#include \"util/type_list.hpp\"\n\n"
+          << "#include <cstddef>\n"
           << "#include <string_view>\n\n"
           << "namespace arpiyi::assets {\n";
 
-    for (const auto& asset_e : assets_with_dir_name) {
+    for (const auto& asset_e : registered_assets) {
         const auto asset_dir_name = asset_e.dir_name_attribute.arguments[0];
         out_f << "struct " << asset_e.asset_entity.name << ";\n"
               << "template<> struct AssetDirName<" << asset_e.asset_entity.name
               << "> { constexpr static std::string_view value = " << asset_dir_name << "; };\n\n";
     }
 
+    // Registry of every asset type, in load order
+    out_f << "using all_assets = util::type_list<";
+    for (std::size_t i = 0; i < registered_assets.size(); ++i)
+        out_f << (i ? ", " : "") << registered_assets[i].asset_entity.name;
+    out_f << ">;\n\n";
+
+    for (std::size_t i = 0; i < registered_assets.size(); ++i) {
+        const auto& name = registered_assets[i].asset_entity.name;
+        bool serialize = false;
+        std::size_t load_level = 0;
+        unsigned long long dependency_mask = 0;
+        for (std::size_t level = 0; level < load_levels.size(); ++level) {
+            for (const auto& asset : load_levels[level]) {
+                if (asset.asset_entity.name != name)
+                    continue;
+                serialize = true;
+                load_level = level;
+                for (std::size_t j = 0; j < registered_assets.size(); ++j) {
+                    const auto& dependencies = asset.asset_load_dependencies;
+                    if (std::find(dependencies.begin(), dependencies.end(),
+                                  registered_assets[j].asset_entity.name) != dependencies.end())
+                        dependency_mask |= 1ull << j;
+                }
+            }
+        }
+        /* clang-format off */
+        out_f << "template<> struct AssetInfo<" << name << "> {\n"
+              << "\tconstexpr static std::size_t index = " << i << ";\n"
+              << "\tconstexpr static bool serialize = " << (serialize ? "true" : "false") << ";\n"
+              << "\tconstexpr static u64 load_dependency_mask = " << dependency_mask << "ull;\n"
+              << "\tconstexpr static std::size_t load_level = " << load_level << ";\n"
+              << "};\n";
+        /* clang-format on */
+    }
+    out_f << "\n";
+
+    // Save and load functions of assets using the binary format, defined in serializer_cg.cpp
+    for (const auto& level : load_levels) {
+        for (const auto& asset : level) {
+            if (asset.binary_format_version.empty())
+                continue;
+            const auto& name = asset.asset_entity.name;
+            /* clang-format off */
+            out_f << "struct " << name << ";\n"
+                  << "template<> struct LoadParams<" << name << "> { fs::path path; };\n"
+                  << "template<> struct PreparedLoad<" << name << "> : BinaryPreparedLoad {};\n"
+                  << "template<> RawSaveData raw_get_save_data<" << name << ">(" << name << " const&);\n"
+                  << "template<> void raw_load<" << name << ">(" << name << "&, LoadParams<" << name << "> const&);\n"
+                  << "template<> PreparedLoad<" << name << "> raw_prepare_load<" << name << ">(LoadParams<" << name << "> const&);\n"
+                  << "template<> void raw_finish_load<" << name << ">(" << name << "&, PreparedLoad<" << name << ">&&);\n"
+                  << "template<> inline void raw_unload<" << name << ">(" << name << "&) {}\n\n";
+            /* clang-format on */
+        }
+    }
+
     out_f << "}\n"
           << "#endif // ARPIYI_ASSET_CG_HPP" << std::endl;
 
     std::cout << "Assets file written to " << assets_out_path << std::endl;
 }
 
-void create_serializer_codegen_file(std::vector<SerializableAsset> serializable_assets) {
+void create_all_assets_codegen_file(std::vector<AssetWithDirName> const& registered_assets) {
+    const fs::path all_assets_out_path = "build/shared/include/assets/all_assets_cg.hpp";
+    fs::create_directories(all_assets_out_path.parent_path());
+    auto out_f = std::ofstream(all_assets_out_path);
+    out_f << "// all_assets_cg.hpp\n"
+          << "// Generated header for usage with the arpiyi shared library.\n"
+          << "// Includes the definitions of every type in assets::all_assets.\n"
+          << "#ifndef ARPIYI_ALL_ASSETS_CG_HPP\n"
+          << "#define ARPIYI_ALL_ASSETS_CG_HPP\n\n";
+    for (const auto& asset : registered_assets) {
+        out_f << "#include \"" << asset.header_path.generic_string() << "\"\n";
+    }
+    out_f << "\n#endif // ARPIYI_ALL_ASSETS_CG_HPP" << std::endl;
+
+    std::cout << "All assets file written to " << all_assets_out_path << std::endl;
+}
+
+void create_reflection_codegen_file(std::vector<SerializableAsset> const& serializable_assets) {
+    const fs::path reflection_out_path = "build/shared/include/assets/reflection_cg.hpp";
+    fs::create_directories(reflection_out_path.parent_path());
+    auto out_f = std::ofstream(reflection_out_path);
+    out_f << "// reflection_cg.hpp\n"
+          << "// Generated header for usage with the arpiyi shared library.\n"
+          << "#ifndef ARPIYI_REFLECTION_CG_HPP\n"
+          << "#define ARPIYI_REFLECTION_CG_HPP\n\n"
+          << "#include \"assets/all_assets_cg.hpp\"\n"
+          << "#include \"util/intdef.hpp\"\n\n"
+          << "#include <string_view>\n"
+          << "#include <tuple>\n";
+
+    out_f << "\nnamespace arpiyi::reflection {\n\n";
+    for (const auto& asset : serializable_assets) {
+        const auto& name = asset.asset_entity.name;
+        /* clang-format off */
+        out_f << "template<> struct Reflection<assets::" << name << "> {\n"
+              << "\tconstexpr static std::string_view name = \"" << name << "\";\n"
+              << "\tconstexpr static u32 binary_format_version = "
+              << (asset.binary_format_version.empty() ? "0" : asset.binary_format_version) << ";\n"
+              << "\tconstexpr static auto fields = std::make_tuple(";
+        /* clang-format on */
+        bool first = true;
+        for (const auto& member : asset.asset_entity.members) {
+            const bool transient = has_attribute(member.attributes, "assets", "transient");
+            out_f << (first ? "\n" : ",\n") << "\t\tmake_field(\"" << member.name << "\", \""
+                  << member.type << "\", &assets::" << name << "::" << member.name << ", "
+                  << (transient ? "true" : "false") << ")";
+            first = false;
+        }
+        out_f << ");\n};\n\n";
+    }
+
+    out_f << "}\n"
+          << "#endif // ARPIYI_REFLECTION_CG_HPP" << std::endl;
+
+    std::cout << "Reflection file written to " << reflection_out_path << std::endl;
+}
+
+void create_serializer_codegen_file(std::vector<SerializableAsset> const& serializable_assets) {
     const fs::path serializer_out_path = "build/shared/src/serializer_cg.cpp";
     fs::create_directories(serializer_out_path.parent_path());
     auto out_f = std::ofstream(serializer_out_path);
     out_f << "// serializer_cg.cpp\n"
              "// Generated source file for usage with the arpiyi shared library.\n"
-             "#include <functional>\n"
-             "#include <filesystem>\n\n"
-             "#include \"serializer.hpp\"\n\n"
-             "namespace fs = std::filesystem;\n\n";
-    // Include asset header paths
-    for (const auto& asset : serializable_assets) {
-        out_f << "#include \"" << asset.header_path.generic_string() << "\"\n";
-    }
+             "#include \"assets/all_assets_cg.hpp\"\n"
+             "#include \"binary_serializer.hpp\"\n\n"
+             "namespace arpiyi::assets {\n\n";
 
-    /* clang-format off */
-    out_f
-        << "\nnamespace arpiyi::serializer {\n\n"
-           "/// The number of asset structs that are marked with the [[assets::serialize]] \n"
-           "/// attribute.\n"
-           "const std::size_t serializable_assets = " << serializable_assets.size() << ";\n\n"
-
-           "/// Loads one single asset type from a project folder and places the results in the \n"
-           "/// corresponding asset container. The \"One single asset type\" is useful for \n"
-           "/// simulating coroutines.\n"
-           "/// You can call this function with indices from 0 to <serializable_assets> to load \n"
-           "/// all assets.\n"
-           "void load_one_asset_type(std::size_t asset_type_index, fs::path project_path,\n"
-           "                 std::function<void(std::string_view /* progress string */, "
-           "float /* progress (0~1) */)>\n"
-           "                     per_step_func) {\n"
-           "\tswitch(asset_type_index) {\n";
-    /* clang-format on */
-
-    std::vector<SerializableAsset> loaded_assets;
-
-    const auto load_asset = [&out_f, &loaded_assets](SerializableAsset const& asset) {
+    // Save and load functions of assets using the binary format, declared in asset_cg.hpp
+    for (const auto& asset : serializable_assets) {
+        if (asset.binary_format_version.empty())
+            continue;
+        const auto& name = asset.asset_entity.name;
         /* clang-format off */
-        out_f << "\t\tcase " << loaded_assets.size() << ": "
-                 "load_assets<assets::" << asset.asset_entity.name << ">"
-                 "(project_path, per_step_func); break;\n";
+        out_f << "template<> RawSaveData raw_get_save_data<" << name << ">(" << name << " const& asset) {\n"
+                 "\treturn binary::get_save_data(asset);\n}\n"
+                 "template<> PreparedLoad<" << name << "> raw_prepare_load<" << name << ">(LoadParams<" << name << "> const& params) {\n"
+                 "\treturn {binary::prepare_load(params.path)};\n}\n"
+                 "template<> void raw_finish_load<" << name << ">(" << name << "& asset, PreparedLoad<" << name << ">&& prepared) {\n"
+                 "\tprepared.failed = !binary::finish_load(asset, prepared.data);\n}\n"
+                 "template<> void raw_load<" << name << ">(" << name << "& asset, LoadParams<" << name << "> const& params) {\n"
+                 "\traw_finish_load(asset, raw_prepare_load(params));\n}\n\n";
         /* clang-format on */
-        loaded_assets.emplace_back(asset);
-    };
+    }
 
-    while (loaded_assets.size() != serializable_assets.size()) {
-        for (const auto& asset : serializable_assets) {
-            if (std::find_if(loaded_assets.begin(), loaded_assets.end(),
-                             [&asset](const auto& other) -> bool {
-                                 return asset.asset_entity.name == other.asset_entity.name;
-                             }) != loaded_assets.end())
-                continue;
-            if (asset.asset_load_dependencies.empty())
-                load_asset(asset);
-            else {
-                // Use lambda so we can use return
-                const auto check_dependencies = [&]() {
-                    for (const auto& dependency : asset.asset_load_dependencies) {
-                        if (std::find_if(loaded_assets.begin(), loaded_assets.end(),
-                                         [&dependency](const auto& other) -> bool {
-                                             return dependency == other.asset_entity.name;
-                                         }) == loaded_assets.end())
-                            return;
-                    }
-                    load_asset(asset);
-                };
+    out_f << "}\n";
 
-                check_dependencies();
-            }
-        }
+    std::cout << "Assets file written to " << serializer_out_path << std::endl;
+}
+
+void create_lua_bindings_codegen_file(std::vector<LuaExposedAsset> const& exposed_assets) {
+    const fs::path bindings_out_path = "build/shared/include/api/lua_bindings_cg.hpp";
+    fs::create_directories(bindings_out_path.parent_path());
+    auto out_f = std::ofstream(bindings_out_path);
+    out_f << "// lua_bindings_cg.hpp\n"
+          << "// Generated header for usage with the arpiyi shared library.\n"
+          << "#ifndef ARPIYI_LUA_BINDINGS_CG_HPP\n"
+          << "#define ARPIYI_LUA_BINDINGS_CG_HPP\n\n"
+          << "#include \"api/api.hpp\"\n\n";
+    for (const auto& asset : exposed_assets) {
+        out_f << "#include \"" << asset.header_path.generic_string() << "\"\n";
     }
 
-    out_f
-        << "\t}\n}\n\n"
-           "/// Saves one single asset type from its container to a project folder.\n"
-           "/// The \"One single asset type\" is useful for simulating coroutines.\n"
-           "/// You can call this function with indices from 0 to <serializable_assets> to save \n"
-           "/// all assets.\n"
-           "void save_one_asset_type(std::size_t asset_type_index, fs::path project_path,\n"
-           "                 std::function<void(std::string_view /* progress string */, "
-           "float /* progress (0~1) */)>\n"
-           "                     per_step_func) {\n"
-           "\tswitch(asset_type_index) {\n";
-
-    std::size_t i = 0;
-    for (const auto& e : serializable_assets) {
+    out_f << "\nnamespace arpiyi::api {\n\n";
+    for (const auto& asset : exposed_assets) {
+        const auto& name = asset.asset_entity.name;
         /* clang-format off */
-        out_f << "\t\tcase " << i << ": "
-                 "save_assets<assets::" << e.asset_entity.name << ">"
-                 "(project_path, per_step_func); break;\n";
+        out_f << "template<> inline sol::usertype<assets::" << name << "> define_usertype<assets::"
+              << name << ">(sol::table& table) {\n"
+              << "\treturn table.new_usertype<assets::" << name << ">(" << asset.lua_name;
         /* clang-format on */
-        ++i;
+        for (const auto& member : asset.asset_entity.members) {
+            if (has_attribute(member.attributes, "lua", "hidden"))
+                continue;
+            const std::string member_ptr = "&assets::" + name + "::" + member.name;
+            out_f << ",\n\t\t\"" << member.name << "\", ";
+            if (has_attribute(member.attributes, "lua", "readonly"))
+                out_f << "sol::readonly(" << member_ptr << ")";
+            else
+                out_f << member_ptr;
+        }
+        out_f << ");\n}\n\n";
     }
 
-    out_f << "\t}\n}\n}\n";
+    out_f << "}\n"
+          << "#endif // ARPIYI_LUA_BINDINGS_CG_HPP" << std::endl;
 
-    std::cout << "Assets file written to " << serializer_out_path << std::endl;
+    std::cout << "Lua bindings file written to " << bindings_out_path << std::endl;
 }
 
 int main() {
@@ -151,19 +314,22 @@ int main() {
 
     std::vector<AssetWithDirName> assets_with_dir_name;
     std::vector<SerializableAsset> serializable_assets;
+    std::vector<LuaExposedAsset> lua_exposed_assets;
 
     for (auto const& entry : fs::directory_iterator(assets_path)) {
         const auto entities = arpiyi::codegen::parse_cpp_file(entry.path());
         for (const auto& e : entities) {
             SerializableAsset serializable_asset;
             std::vector<std::string> load_dependencies;
+            std::string binary_format_version;
             bool do_serialize = false;
 
             for (const auto& attr : e.attributes) {
                 if (attr.scope == "meta") {
                     if (attr.name == "dir_name") {
                         assert(!attr.arguments.empty());
-                        assets_with_dir_name.emplace_back(AssetWithDirName{e, attr});
+                        assets_with_dir_name.emplace_back(AssetWithDirName{
+                            fs::relative(entry.path(), "shared/include"), e, attr});
                     } else {
                         std::cerr << "Unrecognized attribute name: meta::" << attr.name
                                   << std::endl;
@@ -173,20 +339,40 @@ int main() {
                         do_serialize = true;
                     } else if (attr.name == "load_before") {
                         load_dependencies.emplace_back(attr.arguments[0]);
+                    } else if (attr.name == "binary_format") {
+                        assert(!attr.arguments.empty());
+                        binary_format_version = attr.arguments[0];
                     } else {
                         std::cerr << "Unrecognized attribute name: assets::" << attr.name
                                   << std::endl;
                     }
+                } else if (attr.scope == "lua") {
+                    if (attr.name == "expose") {
+                        lua_exposed_assets.emplace_back(LuaExposedAsset{
+                            fs::relative(entry.path(), "shared/include"), e,
+                            attr.arguments.empty() ? '"' + e.name + '"' : attr.arguments[0]});
+                    } else {
+                        std::cerr << "Unrecognized attribute name: lua::" << attr.name
+                                  << std::endl;
+                    }
                 }
             }
 
             if (do_serialize) {
                 serializable_assets.emplace_back(SerializableAsset{
-                    fs::relative(entry.path(), "shared/include"), e, load_dependencies});
+                    fs::relative(entry.path(), "shared/include"), e, load_dependencies,
+                    binary_format_version});
             }
         }
     }
 
-    create_assets_codegen_file(assets_with_dir_name);
+    const auto load_levels = get_load_levels(serializable_assets);
+    const auto registered_assets = get_registered_assets(assets_with_dir_name, load_levels);
+    // Load dependencies are stored as u64 masks
+    assert(registered_assets.size() <= 64);
+    create_assets_codegen_file(registered_assets, load_levels);
+    create_all_assets_codegen_file(registered_assets);
+    create_reflection_codegen_file(serializable_assets);
     create_serializer_codegen_file(serializable_assets);
+    create_lua_bindings_codegen_file(lua_exposed_assets);
 }
\ No newline at end of file
@@ -3,6 +3,7 @@
 #include <iostream>
 #include <sstream>
 #include <string_view>
+#include <algorithm>
 #include <cctype>
 
 namespace arpiyi::codegen {
@@ -71,6 +72,192 @@ Attribute parse_attribute(std::string_view& view) {
     return attribute;
 }
 
+bool next_token_is_attribute(std::string_view view);
+
+/// Removes all comments from the given source, leaving string and character literals untouched.
+std::string strip_comments(std::string_view source) {
+    std::string result;
+    result.reserve(source.size());
+    for (std::size_t i = 0; i < source.size(); ++i) {
+        if (source[i] == '"' || source[i] == '\'') {
+            const char quote = source[i];
+            result += source[i];
+            for (++i; i < source.size() && source[i] != quote; ++i) {
+                result += source[i];
+                if (source[i] == '\\' && i + 1 < source.size())
+                    result += source[++i];
+            }
+            if (i < source.size())
+                result += source[i];
+        } else if (source.substr(i, 2) == "//") {
+            i = std::min(source.find('\n', i), source.size()) - 1;
+        } else if (source.substr(i, 2) == "/*") {
+            i = std::min(source.find("*/", i + 2), source.size() - 2) + 1;
+            // Keep tokens on both sides of the comment apart
+            result += ' ';
+        } else {
+            result += source[i];
+        }
+    }
+    return result;
+}
+
+std::string_view trim(std::string_view view) {
+    view = consume_spaces(view);
+    while (!view.empty() && std::isspace(view.back())) view.remove_suffix(1);
+    return view;
+}
+
+bool is_identifier_char(char c) { return std::isalnum(c) || c == '_'; }
+
+/// @returns The index of the bracket closing the one at the given index.
+std::size_t find_closing_bracket(std::string_view view, std::size_t open_index) {
+    const char open = view[open_index];
+    const char close = open == '{' ? '}' : open == '(' ? ')' : open == '<' ? '>' : ']';
+    int depth = 0;
+    for (std::size_t i = open_index; i < view.size(); ++i) {
+        if (view[i] == open)
+            ++depth;
+        else if (view[i] == close && --depth == 0)
+            return i;
+    }
+    return view.size();
+}
+
+/// @returns The index of the first of the given characters that is not inside any brackets.
+std::size_t find_first_outside_brackets(std::string_view view, std::string_view chars) {
+    int depth = 0;
+    for (std::size_t i = 0; i < view.size(); ++i) {
+        if (depth == 0 && chars.find(view[i]) != std::string_view::npos)
+            return i;
+        if (view[i] == '<' || view[i] == '(' || view[i] == '{' || view[i] == '[')
+            ++depth;
+        else if (view[i] == '>' || view[i] == ')' || view[i] == '}' || view[i] == ']')
+            --depth;
+    }
+    return std::string_view::npos;
+}
+
+/// Splits a declarator like "name[4] = {}" into its name and the array part of its type.
+std::pair<std::string, std::string> parse_declarator(std::string_view declarator) {
+    declarator = trim(declarator.substr(0, find_first_outside_brackets(declarator, "={")));
+    std::string array_suffix;
+    if (const auto array_start = declarator.find('['); array_start != std::string_view::npos) {
+        array_suffix = declarator.substr(array_start);
+        declarator = trim(declarator.substr(0, array_start));
+    }
+    return {std::string(declarator), array_suffix};
+}
+
+/// Parses a statement of a struct body into the data members it declares. Anything else
+/// (Functions, static members, type declarations...) declares none.
+std::vector<Member> parse_member_declaration(std::string_view statement) {
+    std::vector<Attribute> attributes;
+    statement = trim(statement);
+    while (next_token_is_attribute(statement)) {
+        attributes.emplace_back(parse_attribute(statement));
+        statement = trim(statement);
+    }
+
+    const std::string_view first_word =
+        statement.substr(0, std::find_if_not(statement.begin(), statement.end(),
+                                             is_identifier_char) - statement.begin());
+    for (const auto non_member_keyword : {"static", "constexpr", "using", "typedef", "friend",
+                                          "template", "class", "struct", "union", "virtual",
+                                          "explicit", "inline", "operator"}) {
+        if (first_word == non_member_keyword)
+            return {};
+    }
+
+    std::string type;
+    std::string_view declarators;
+    if (first_word == "enum") {
+        // enum class Name {...} member;
+        const auto body_start = statement.find('{');
+        if (body_start == std::string_view::npos)
+            return {};
+        std::string_view name = trim(statement.substr(4, body_start - 4));
+        if (name.substr(0, 6) == "class " || name.substr(0, 7) == "struct ")
+            name = trim(name.substr(name.find(' ')));
+        type = trim(name.substr(0, name.find(':')));
+        declarators = statement.substr(find_closing_bracket(statement, body_start) + 1);
+    } else {
+        const auto initializer_start = find_first_outside_brackets(statement, "={,");
+        // Functions and constructors
+        if (statement.substr(0, initializer_start).find('(') != std::string_view::npos)
+            return {};
+        // The name is the last identifier before the initializer or the next declarator
+        std::string_view first_declaration = trim(statement.substr(0, initializer_start));
+        if (!first_declaration.empty() && first_declaration.back() == ']')
+            first_declaration = trim(first_declaration.substr(0, first_declaration.find('[')));
+        std::size_t name_start = first_declaration.size();
+        while (name_start > 0 && is_identifier_char(first_declaration[name_start - 1]))
+            --name_start;
+        type = trim(first_declaration.substr(0, name_start));
+        declarators = statement.substr(name_start);
+    }
+
+    std::vector<Member> members;
+    if (type.empty())
+        return members;
+    while (!trim(declarators).empty()) {
+        const auto declarator_end = find_first_outside_brackets(declarators, ",");
+        auto [name, array_suffix] = parse_declarator(declarators.substr(0, declarator_end));
+        if (!name.empty())
+            members.emplace_back(Member{attributes, type + array_suffix, name});
+        if (declarator_end == std::string_view::npos)
+            break;
+        declarators = declarators.substr(declarator_end + 1);
+    }
+    return members;
+}
+
+/// Parses the public data members of the struct whose definition begins at the given view.
+std::vector<Member> parse_struct_members(std::string_view view) {
+    const auto body_start = view.find_first_of("{;");
+    if (body_start == std::string_view::npos || view[body_start] == ';')
+        return {};
+    const std::string_view body =
+        view.substr(body_start + 1, find_closing_bracket(view, body_start) - body_start - 1);
+
+    std::vector<Member> members;
+    bool is_public = true;
+    std::size_t statement_start = 0;
+    for (std::size_t i = 0; i < body.size(); ++i) {
+        if (body[i] == '"' || body[i] == '\'') {
+            const char quote = body[i];
+            for (++i; i < body.size() && body[i] != quote; ++i) {
+                if (body[i] == '\\')
+                    ++i;
+            }
+        } else if (body[i] == '(') {
+            i = find_closing_bracket(body, i);
+        } else if (body[i] == '{') {
+            const std::string_view statement = body.substr(statement_start, i - statement_start);
+            i = find_closing_bracket(body, i);
+            // A function body ends the declaration without a semicolon
+            if (find_first_outside_brackets(statement, "=(") != std::string_view::npos &&
+                statement[find_first_outside_brackets(statement, "=(")] == '(')
+                statement_start = i + 1;
+        } else if (body[i] == ':' && body.substr(i, 2) != "::" &&
+                   (i == 0 || body[i - 1] != ':')) {
+            const std::string_view label = trim(body.substr(statement_start, i - statement_start));
+            if (label == "public" || label == "private" || label == "protected") {
+                is_public = label == "public";
+                statement_start = i + 1;
+            }
+        } else if (body[i] == ';') {
+            if (is_public) {
+                for (auto& member : parse_member_declaration(
+                         body.substr(statement_start, i - statement_start)))
+                    members.emplace_back(std::move(member));
+            }
+            statement_start = i + 1;
+        }
+    }
+    return members;
+}
+
 bool next_token_is_attribute(std::string_view view) {
     return view.substr(0, 2) == "[[";
 }
@@ -85,7 +272,7 @@ std::vector<AttributedEntity> parse_cpp_file(fs::path const& path) {
     std::ifstream f(path);
     std::stringstream buffer;
     buffer << f.rdbuf();
-    std::string file_str = buffer.str();
+    std::string file_str = strip_comments(buffer.str());
     std::string_view file_view = file_str;
     std::vector<Attribute> attribute_queue;
     EntityType type_read = EntityType::none;
@@ -105,7 +292,10 @@ std::vector<AttributedEntity> parse_cpp_file(fs::path const& path) {
             if(!attribute_queue.empty()) {
                 std::string_view entity_name_view = file_view.substr(entity_name_start_index, entity_name_length);
 
-                result.emplace_back(AttributedEntity{attribute_queue, std::string(entity_name_view), type_read});
+                result.emplace_back(AttributedEntity{
+                    attribute_queue, std::string(entity_name_view), type_read,
+                    parse_struct_members(
+                        file_view.substr(entity_name_start_index + entity_name_length))});
                 attribute_queue.clear();
             }
             file_view = file_view.substr(entity_name_start_index + entity_name_length);
@@ -0,0 +1,14 @@
+#ifndef ARPIYI_LOAD_PROFILE_WINDOW_HPP
+#define ARPIYI_LOAD_PROFILE_WINDOW_HPP
+
+namespace arpiyi::load_profile_window {
+
+void init();
+void render(bool* p_show);
+
+/// Whether project loads should be profiled. Toggled from the window.
+[[nodiscard]] bool is_profiling_enabled();
+
+} // namespace arpiyi::load_profile_window
+
+#endif // ARPIYI_LOAD_PROFILE_WINDOW_HPP
@@ -27,9 +27,13 @@ template<typename AssetT> fs::path get_asset_save_path(u64 handle_id) {
 
 } // namespace detail
 
-void start_save();
+/// Saves the project in the background. If a save is already in progress, another one is started
+/// once it finishes.
+/// @param on_saved Called once this save has been written to disk.
+void start_save(std::function<void()> on_saved = nullptr);
 void start_load(fs::path project_path, bool ignore_editor_version = false);
-/// Sets the function called for when saving/loading finishes.
+/// Sets the function called for when saving/loading finishes. Prefer the argument of start_save()
+/// for saves, since it is only called once that save in particular finishes.
 void set_callback(std::function<void()>);
 
 } // namespace arpiyi::serializing_manager
@@ -93,8 +93,8 @@ void render() {
             ImGui::EndMenu();
         }
         if(ImGui::MenuItem("Play")) {
-            serializing_manager::start_save();
-            serializing_manager::set_callback([]() {
+            // Launch the player only once the latest changes are on disk
+            serializing_manager::start_save([]() {
               util::execute_process(fs::path(ARPIYI_PLAYER_EXECUTABLE_NAME), fs::absolute(project_manager::get_project_path()).generic_string());
             });
         }
@@ -0,0 +1,98 @@
+#include "load_profile_window.hpp"
+#include "window_list_menu.hpp"
+
+#include "load_profiler.hpp"
+
+#include "util/icons_material_design.hpp"
+
+#include <noc_file_dialog.h>
+
+#include <imgui.h>
+
+#include <algorithm>
+
+namespace arpiyi::load_profile_window {
+
+static bool profiling_enabled = false;
+
+void init() { window_list_menu::add_entry({"Load Profile", &render, false}); }
+
+bool is_profiling_enabled() { return profiling_enabled; }
+
+static void stage_columns_header(const char* first_column_name) {
+    ImGui::Columns(2 + static_cast<int>(load_profiler::Stage::count));
+    ImGui::TextUnformatted(first_column_name);
+    ImGui::NextColumn();
+    ImGui::TextUnformatted("total");
+    ImGui::NextColumn();
+    for (const auto stage_name : load_profiler::stage_names) {
+        ImGui::TextUnformatted(stage_name.data());
+        ImGui::NextColumn();
+    }
+    ImGui::Separator();
+}
+
+static void stage_columns(load_profiler::StageTimes const& stage_ms) {
+    for (const double ms : stage_ms) {
+        ImGui::Text("%.2f", ms);
+        ImGui::NextColumn();
+    }
+}
+
+void render(bool* p_show) {
+    if (ImGui::Begin(ICON_MD_TIMER " Load Profile", p_show)) {
+        ImGui::Checkbox("Profile project loads", &profiling_enabled);
+        if (load_profiler::is_recording()) {
+            ImGui::TextUnformatted("Loading...");
+            ImGui::End();
+            return;
+        }
+
+        const auto type_times = load_profiler::get_type_times();
+        if (type_times.empty()) {
+            ImGui::TextDisabled("No project load has been profiled yet.");
+            ImGui::End();
+            return;
+        }
+
+        ImGui::Text("Last load took %.2fms. All times are in milliseconds.",
+                    load_profiler::get_session_ms());
+        ImGui::SameLine();
+        if (ImGui::Button("Save report...")) {
+            if (const char* path = noc_file_dialog_open(NOC_FILE_DIALOG_SAVE, "JSON\0*.json\0",
+                                                        nullptr, "load_profile.json"))
+                load_profiler::write_json_report(path);
+        }
+
+        if (ImGui::CollapsingHeader("By asset type", ImGuiTreeNodeFlags_DefaultOpen)) {
+            stage_columns_header("type");
+            for (auto const& type : type_times) {
+                ImGui::Text("%s (%zu)", type.type_name.c_str(), type.asset_count);
+                ImGui::NextColumn();
+                ImGui::Text("%.2f", type.total_ms);
+                ImGui::NextColumn();
+                stage_columns(type.stage_ms);
+            }
+            ImGui::Columns(1);
+        }
+
+        if (ImGui::CollapsingHeader("Slowest assets", ImGuiTreeNodeFlags_DefaultOpen)) {
+            constexpr std::size_t max_shown_assets = 20;
+            const auto asset_times = load_profiler::get_asset_times();
+            stage_columns_header("asset");
+            for (std::size_t i = 0; i < std::min(max_shown_assets, asset_times.size()); ++i) {
+                auto const& asset = asset_times[i];
+                ImGui::Text("%s/%llu", asset.type_name.c_str(),
+                            static_cast<unsigned long long>(asset.id));
+                ImGui::NextColumn();
+                ImGui::Text("%.2f", asset.total_ms);
+                ImGui::NextColumn();
+                stage_columns(asset.stage_ms);
+            }
+            ImGui::Columns(1);
+        }
+    }
+    ImGui::End();
+}
+
+} // namespace arpiyi::load_profile_window
@@ -8,12 +8,14 @@
 #include <imgui_impl_glfw.h>
 #include <imgui_impl_opengl3.h>
 
+#include "assets/texture.hpp"
 #include "editor/editor_style.hpp"
 #include "editor/editor_renderer.hpp"
 #include "editor/editor_lua_wrapper.hpp"
 #include "tileset_manager.hpp"
 #include "window_manager.hpp"
 #include "plugin_manager.hpp"
+#include "load_profile_window.hpp"
 #include "map_manager.hpp"
 #include "startup_dialog.hpp"
 #include "sprite_manager.hpp"
@@ -34,6 +36,8 @@ static void key_callback(GLFWwindow* window, int key, int scancode, int action,
 }
 
 int main() {
+    // Textures are saved back with the contents of the files they were loaded from
+    assets::keep_texture_encoded_data() = true;
     if (!window_manager::init())
         return -1;
     tileset_manager::init();
@@ -45,6 +49,7 @@ int main() {
     sprite_manager::init();
     // plugin_manager::load_plugins("data/plugins");
     widgets::inspector::init();
+    load_profile_window::init();
     startup_dialog::init();
 
     glfwSetKeyCallback(window_manager::get_window(), key_callback);
@@ -3,6 +3,7 @@
 #include <algorithm>
 #include <array>
 #include <cmath>
+#include <optional>
 #include <vector>
 
 #include "assets/entity.hpp"
@@ -30,6 +31,8 @@ namespace arpiyi::map_manager {
 Handle<assets::Map> current_map;
 Handle<assets::Shader> tile_shader;
 Handle<assets::Shader> grid_shader;
+Handle<assets::Shader> tilemap_shader;
+Handle<assets::Shader> instanced_tile_shader;
 Handle<assets::Mesh> quad_mesh;
 aml::Matrix4 proj_mat;
 Handle<assets::Map::Layer> current_layer_selected;
@@ -37,6 +40,7 @@ ImVec2 map_scroll{0, 0};
 std::array<float, 5> zoom_levels = {.2f, .5f, 1.f, 2.f, 5.f};
 int current_zoom_level = 2;
 static bool show_grid = true;
+static auto layer_render_mode = assets::Map::Layer::RenderMode::mesh;
 enum class EditMode { tile, comment, entity } edit_mode = EditMode::tile;
 
 constexpr const char* map_view_strid = ICON_MD_TERRAIN " Map View";
@@ -72,6 +76,7 @@ static void show_add_layer_window(bool* p_open) {
             assets::Map::Layer layer{current_map.get()->width, current_map.get()->height, tileset};
             layer.name = name;
             current_map.get()->layers.emplace_back(asset_manager::put(layer));
+            current_map.mark_dirty();
             *p_open = false;
         }
     }
@@ -104,7 +109,19 @@ static void show_edit_layer_window(bool* p_open, Handle<assets::Map::Layer> _l)
         ImGui::SameLine();
         if (ImGui::Button("OK", valid)) {
             layer.name = name;
-            layer.tileset = tileset;
+            if (!(layer.tileset == tileset)) {
+                // The shapes of the autotiles depend on the layout of the tileset, so they have to
+                // be recomputed when switching between autotile tilesets. Any other tiles are
+                // left as they are.
+                auto old_tileset = layer.tileset.get();
+                const bool recompute = old_tileset && !old_tileset->autotile_rules.empty() &&
+                                       !tileset.get()->autotile_rules.empty();
+                layer.tileset = tileset;
+                if (recompute)
+                    assets::recompute_autotiles(layer, {{0, 0}, layer.get_size()});
+            }
+            // Layers are saved as part of their map
+            current_map.mark_dirty();
             *p_open = false;
         }
     }
@@ -185,6 +202,7 @@ static void show_edit_map_window(bool* p_open, Handle<assets::Map> _m) {
         ImGui::SameLine();
         if (ImGui::Button("OK")) {
             map.name = name;
+            _m.mark_dirty();
             *p_open = false;
         }
     }
@@ -261,6 +279,7 @@ static void show_map_layer_list() {
                         std::remove(map->layers.begin(), map->layers.end(), layer_to_delete),
                         map->layers.end());
                     layer_to_delete.unload();
+                    current_map.mark_dirty();
                 }
             }
         } else {
@@ -290,10 +309,10 @@ static void show_map_list() {
             }
             ImGui::EndMenuBar();
         }
-        if (detail::AssetContainer<assets::Map>::get_instance().map.empty())
+        if (detail::AssetContainer<assets::Map>::get_instance().storage.empty())
             ImGui::TextDisabled("No maps");
         else
-            for (auto& [_id, _m] : detail::AssetContainer<assets::Map>::get_instance().map) {
+            for (auto& [_id, _m] : detail::AssetContainer<assets::Map>::get_instance().storage) {
                 ImGui::TextDisabled("%zu", _id);
                 ImGui::SameLine();
                 if (ImGui::Selectable(_m.name.c_str(), _id == current_map.get_id())) {
@@ -376,11 +395,23 @@ static void draw_map_callback(const ImDrawList* parent_list, const ImDrawCmd* cm
                                             callback_data.map_render_pos.y / clip_rect_height,
                                             0});    // Put model in given position
     model = model * aml::scale({1, -1, 1}); // Flip model from its Y axis
+    const float tile_size = global_tile_size::get() * get_map_zoom();
+    // The instanced renderer gives positions in tiles instead of normalized to the map size
+    aml::Matrix4 tile_model =
+        model * aml::scale({tile_size / clip_rect_width, tile_size / clip_rect_height, 1});
     model = model * aml::scale({map_total_width / clip_rect_width,
                                         map_total_height / clip_rect_height, 1});
 
     if (!map.layers.empty()) {
-        glUseProgram(tile_shader.get()->handle);
+        // Only draw the tiles that are visible through the clip rect
+        const math::IRect2D tile_view{
+            {static_cast<i32>(std::floor(-callback_data.map_render_pos.x / tile_size)),
+             static_cast<i32>(std::floor(-callback_data.map_render_pos.y / tile_size))},
+            {static_cast<i32>(
+                 std::ceil((clip_rect_width - callback_data.map_render_pos.x) / tile_size)),
+             static_cast<i32>(
+                 std::ceil((clip_rect_height - callback_data.map_render_pos.y) / tile_size))}};
+
         glActiveTexture(GL_TEXTURE0);
         // Draw each layer
         for (auto& _l : current_map.get()->layers) {
@@ -388,14 +419,46 @@ static void draw_map_callback(const ImDrawList* parent_list, const ImDrawCmd* cm
             if (!layer->visible)
                 continue;
 
-            glBindVertexArray(layer->get_mesh().get()->vao);
             glBindTexture(GL_TEXTURE_2D, layer->tileset.get()->texture.get()->handle);
 
-            glUniformMatrix4fv(1, 1, GL_FALSE, model.get_raw());
-            glUniformMatrix4fv(2, 1, GL_FALSE, proj_mat.get_raw());
-
-            constexpr int quad_verts = 2 * 3;
-            glDrawArrays(GL_TRIANGLES, 0, map.width * map.height * quad_verts);
+            const math::IVec2D tileset_size = layer->tileset.get()->get_size_in_tiles();
+            switch (layer_render_mode) {
+                case assets::Map::Layer::RenderMode::mesh: {
+                    glUseProgram(tile_shader.get()->handle);
+                    glUniformMatrix4fv(1, 1, GL_FALSE, model.get_raw());
+                    glUniformMatrix4fv(2, 1, GL_FALSE, proj_mat.get_raw());
+
+                    layer->draw_chunks(tile_view);
+                } break;
+
+                case assets::Map::Layer::RenderMode::instanced: {
+                    glUseProgram(instanced_tile_shader.get()->handle);
+                    glUniformMatrix4fv(1, 1, GL_FALSE, tile_model.get_raw());
+                    glUniformMatrix4fv(2, 1, GL_FALSE, proj_mat.get_raw());
+                    glUniform2ui(3, tileset_size.x, tileset_size.y);
+                    glUniform1ui(4, map.height);
+
+                    layer->draw_instanced_chunks(tile_view);
+                } break;
+
+                case assets::Map::Layer::RenderMode::tile_texture: {
+                    layer->update_tile_texture();
+                    glUseProgram(tilemap_shader.get()->handle);
+                    glActiveTexture(GL_TEXTURE1);
+                    glBindTexture(GL_TEXTURE_2D, layer->get_tile_texture());
+                    glActiveTexture(GL_TEXTURE0);
+                    glBindVertexArray(quad_mesh.get()->vao);
+
+                    glUniformMatrix4fv(1, 1, GL_FALSE, model.get_raw());
+                    glUniformMatrix4fv(2, 1, GL_FALSE, proj_mat.get_raw());
+                    glUniform2ui(3, tileset_size.x, tileset_size.y);
+
+                    constexpr int quad_verts = 2 * 3;
+                    glDrawArrays(GL_TRIANGLES, 0, quad_verts);
+                } break;
+
+                default: ARPIYI_UNREACHABLE(); break;
+            }
         }
     }
     if (show_grid) {
@@ -420,70 +483,38 @@ static void place_tile_on_pos(assets::Map& map,
         return;
 
     const auto selection = tileset_manager::get_selection();
+    // Tiles are only placed when the selected tileset is the one of the layer, but the IDs and the
+    // autotile rules must come from the same one anyway
+    auto& layer = *current_layer_selected.get();
+    const auto& tileset = *layer.tileset.get();
 
-    switch (selection.tileset.get()->auto_type) {
+    switch (tileset.auto_type) {
         case (assets::Tileset::AutoType::none): {
-            int start_my = pos.y;
-            for (int tx = selection.selection_start.x; tx <= selection.selection_end.x; tx++) {
-                for (int ty = selection.selection_start.y; ty <= selection.selection_end.y; ty++) {
-                    if (!(pos.x >= 0 && pos.y >= 0 && pos.x < map.width && pos.y < map.height))
-                        continue;
-                    auto layer = current_layer_selected.get();
-                    layer->set_tile(pos, {layer->tileset.get()->get_id({tx, ty})});
-                    pos.y++;
+            const math::IRect2D rect{
+                pos, {pos.x + selection.selection_end.x + 1 - selection.selection_start.x,
+                      pos.y + selection.selection_end.y + 1 - selection.selection_start.y}};
+            std::vector<assets::Map::Tile> tiles;
+            tiles.reserve(rect.width() * rect.height());
+            for (int ty = selection.selection_start.y; ty <= selection.selection_end.y; ty++) {
+                for (int tx = selection.selection_start.x; tx <= selection.selection_end.x; tx++) {
+                    tiles.emplace_back(assets::Map::Tile{tileset.get_id({tx, ty})});
                 }
-                pos.x++;
-                pos.y = start_my;
             }
+            // Tiles outside of the map are clipped by set_tiles
+            layer.set_tiles(rect, tiles);
         } break;
 
-        case (assets::Tileset::AutoType::rpgmaker_a2): {
-            auto& layer = *current_layer_selected.get();
-            const auto& tileset = *selection.tileset.get();
-            const auto are_tiles_of_same_type = [&tileset](u32 id1, u32 id2) -> bool {
-                return tileset.get_x_index_from_auto_id(id1) ==
-                       tileset.get_x_index_from_auto_id(id2);
-            };
-
-            const auto update_auto_id = [&](math::IVec2D pos) {
-                u8 surroundings = 0xFF;
-                u8 bit = 0;
-                const assets::Map::Tile self_tile = layer.get_tile(pos);
-                for (int iy = -1; iy <= 1; ++iy) {
-                    for (int ix = -1; ix <= 1; ++ix) {
-                        if (ix == 0 && iy == 0)
-                            continue;
-                        math::IVec2D neighbour_pos{pos.x + ix, pos.y + iy};
-                        if (!layer.is_pos_valid(neighbour_pos)) {
-                            bit++;
-                            continue;
-                        }
-                        assets::Map::Tile neighbour = layer.get_tile(neighbour_pos);
-                        bool is_neighbour_of_same_type =
-                            are_tiles_of_same_type(neighbour.id, self_tile.id);
-                        surroundings ^= is_neighbour_of_same_type << bit;
-                        bit++;
-                    }
-                }
-                layer.set_tile(pos,
-                               {tileset.get_id_auto(tileset.get_x_index_from_auto_id(self_tile.id),
-                                                    surroundings)});
-            };
+        case (assets::Tileset::AutoType::rpgmaker_a2):
+        case (assets::Tileset::AutoType::rpgmaker_a3):
+        case (assets::Tileset::AutoType::rpgmaker_a4): {
+            const u32 x_index = selection.selection_start.x;
             // Set the tile below the cursor and don't worry about the surroundings; we'll update
             // them later
-            layer.set_tile(pos, {tileset.get_id_auto(selection.selection_start.x, 0)});
+            layer.set_tile(pos, {tileset.get_id_auto(x_index, 0)});
             // Update autoID of tile placed and all others near it
-            for (int iy = -1; iy <= 1; ++iy) {
-                for (int ix = -1; ix <= 1; ++ix) {
-                    const math::IVec2D ipos = {pos.x + ix, pos.y + iy};
-                    if (!layer.is_pos_valid(ipos))
-                        continue;
-                    if (!update_neighbours_of_different_type &&
-                        !are_tiles_of_same_type(layer.get_tile(pos).id, layer.get_tile(ipos).id))
-                        continue;
-                    update_auto_id(ipos);
-                }
-            }
+            assets::recompute_autotiles(
+                layer, {{pos.x - 1, pos.y - 1}, {pos.x + 2, pos.y + 2}},
+                update_neighbours_of_different_type ? std::nullopt : std::optional<u32>(x_index));
         } break;
 
         default: ARPIYI_UNREACHABLE(); break;
@@ -639,6 +670,7 @@ static void process_map_input(assets::Map& map,
                         comment.pos = mouse_tile_pos;
 
                         map.comments.emplace_back(asset_manager::put(comment));
+                        current_map.mark_dirty();
                     }
                 }
             } else if (auto comment = comment_hovering.get()) {
@@ -648,6 +680,8 @@ static void process_map_input(assets::Map& map,
                 if (io.MouseDown[ImGuiMouseButton_Left]) {
                     comment->pos.x = static_cast<float>(mouse_tile_pos.x);
                     comment->pos.y = static_cast<float>(mouse_tile_pos.y);
+                    // Comments are saved as part of their map
+                    current_map.mark_dirty();
                 } else {
                     comment_hovering = nullptr;
                 }
@@ -674,6 +708,7 @@ static void process_map_input(assets::Map& map,
                                      get_map_zoom())};
                         }
                         map.entities.emplace_back(asset_manager::put(entity));
+                        current_map.mark_dirty();
                     }
                 }
             } else if (auto entity = entity_hovering.get()) {
@@ -692,6 +727,7 @@ static void process_map_input(assets::Map& map,
                             (io.MousePos.y - map_render_pos.y - abs_content_start_pos.y) /
                             static_cast<float>(global_tile_size::get() * get_map_zoom());
                     }
+                    entity_hovering.mark_dirty();
                 } else {
                     entity_hovering = nullptr;
                 }
@@ -709,6 +745,7 @@ static void process_map_input(assets::Map& map,
                 if (auto layer = current_layer_selected.get()) {
                     if (layer->is_pos_valid(mouse_tile_pos)) {
                         place_tile_on_pos(map, mouse_tile_pos, !ImGui::GetIO().KeyShift);
+                        current_map.mark_dirty();
                     }
                 }
             }
@@ -719,6 +756,10 @@ static void process_map_input(assets::Map& map,
 void init() {
     tile_shader = asset_manager::load<assets::Shader>({"data/tile.vert", "data/tile.frag"});
     grid_shader = asset_manager::load<assets::Shader>({"data/grid.vert", "data/grid.frag"});
+    tilemap_shader =
+        asset_manager::load<assets::Shader>({"data/tile.vert", "data/tilemap.frag"});
+    instanced_tile_shader =
+        asset_manager::load<assets::Shader>({"data/tile_instanced.vert", "data/tile.frag"});
     quad_mesh = asset_manager::put<assets::Mesh>(assets::Mesh::generate_quad());
 
     proj_mat = aml::orthographic_rh(0.0f, 1.0f, 1.0f, 0.0f, -10000.f, 10000.f);
@@ -734,6 +775,19 @@ void render(bool* p_show) {
         if (map) {
             if (ImGui::BeginMenuBar()) {
                 ImGui::Checkbox("Grid", &show_grid);
+                if (ImGui::BeginMenu("Renderer")) {
+                    using RenderMode = assets::Map::Layer::RenderMode;
+                    if (ImGui::MenuItem("Tile meshes", nullptr,
+                                        layer_render_mode == RenderMode::mesh))
+                        layer_render_mode = RenderMode::mesh;
+                    if (ImGui::MenuItem("Instanced tiles", nullptr,
+                                        layer_render_mode == RenderMode::instanced))
+                        layer_render_mode = RenderMode::instanced;
+                    if (ImGui::MenuItem("Tile ID textures", nullptr,
+                                        layer_render_mode == RenderMode::tile_texture))
+                        layer_render_mode = RenderMode::tile_texture;
+                    ImGui::EndMenu();
+                }
 
                 const auto draw_edit_mode = [](EditMode mode, const char* icon,
                                                const char* tooltip) {
@@ -881,7 +935,7 @@ Handle<assets::Map> get_current_map() { return current_map; }
 
 std::vector<Handle<assets::Map>> get_maps() {
     std::vector<Handle<assets::Map>> maps;
-    for (const auto& [id, map] : detail::AssetContainer<assets::Map>::get_instance().map) {
+    for (const auto& [id, map] : detail::AssetContainer<assets::Map>::get_instance().storage) {
         maps.emplace_back(id);
     }
     return maps;
@@ -65,6 +65,7 @@ void render(bool* p_show) {
                     for(int i = 0; i < static_cast<int>(TriggerType::count); ++i) {
                         if(ImGui::Selectable(trigger_type_name(static_cast<TriggerType>(i)).data())) {
                             script->trigger_type = static_cast<TriggerType>(i);
+                            selected_script.mark_dirty();
                         }
 
                         if (script->trigger_type == static_cast<TriggerType>(i))
@@ -81,6 +82,7 @@ void render(bool* p_show) {
             if (editor.IsTextChanged()) {
                 check_for_errors_in_editor_script();
                 script->source = editor.GetText();
+                selected_script.mark_dirty();
             }
         } else {
             ImGui::TextDisabled("No script selected");
@@ -95,15 +97,16 @@ void render(bool* p_show) {
                 asset_manager::put<assets::Script>(
                     {"Script " +
                      std::to_string(
-                         detail::AssetContainer<assets::Script>::get_instance().next_id_to_use)});
+                         detail::AssetContainer<assets::Script>::get_instance().storage.next_id())});
             }
             ImGui::EndMenuBar();
         }
-        if (detail::AssetContainer<assets::Script>::get_instance().map.empty())
+        if (detail::AssetContainer<assets::Script>::get_instance().storage.empty())
             ImGui::TextDisabled("No scripts");
         else {
             u64 id_to_delete = -1;
-            for (auto& [_id, _s] : detail::AssetContainer<assets::Script>::get_instance().map) {
+            for (auto& [_id, _s] :
+                 detail::AssetContainer<assets::Script>::get_instance().storage) {
                 ImGui::TextDisabled("%zu", _id);
                 ImGui::SameLine();
                 {
@@ -133,7 +136,7 @@ void render(bool* p_show) {
             }
 
             if (id_to_delete != -1) {
-                detail::AssetContainer<assets::Script>::get_instance().map.erase(id_to_delete);
+                Handle<assets::Script>(id_to_delete).unload();
             }
         }
     }
@@ -1,6 +1,8 @@
 #include "serializing_manager.hpp"
 
 #include "global_tile_size.hpp"
+#include "load_profile_window.hpp"
+#include "load_profiler.hpp"
 #include "project_info.hpp"
 #include "project_manager.hpp"
 #include "script_manager.hpp"
@@ -14,10 +16,15 @@
 #include <noc_file_dialog.h>
 
 #include <algorithm>
+#include <chrono>
 #include <cstdint>
 #include <filesystem>
 #include <functional>
+#include <future>
 #include <iostream>
+#include <memory>
+#include <mutex>
+#include <vector>
 
 namespace fs = std::filesystem;
 
@@ -99,51 +106,65 @@ float task_progress = 0;
 static fs::path project_path;
 std::string task_status;
 std::function<void()> task_end_callback;
+/// Guards task_progress and task_status while the project is being written in the background.
+static std::mutex task_status_mutex;
+
+using SaveTasks = std::vector<std::unique_ptr<serializer::SaveTask>>;
+/// Assets captured by the save in progress while their snapshots are being completed. Handed over
+/// to save_writer afterwards.
+static SaveTasks save_tasks;
+/// Writes the completed save tasks to disk, and gives them back so that they are destroyed on the
+/// main thread.
+static std::future<SaveTasks> save_writer;
+/// Called once the save in progress has been written.
+static std::function<void()> save_callback;
+/// Set if a save was requested while another one was in progress. It is started once the current
+/// one finishes, so that it captures every change made until then.
+static bool save_queued = false;
+/// Called once the queued save has been written.
+static std::function<void()> queued_save_callback;
+
+static void end_task() {
+    if (task_end_callback) {
+        task_end_callback();
+        task_end_callback = nullptr;
+    }
+}
 
-enum class TaskType { saving, loading };
-template<TaskType task_type> void task_renderer(bool*) {
-    constexpr std::string_view task_type_str = task_type == TaskType::saving ? "Saving" : "Loading";
-    static long asset_type_index = -1;
+static void load_task_renderer(bool*) {
+    static long load_level = -1;
 
-    if (asset_type_index == -1) {
+    if (load_level == -1) {
         task_progress = 0.f;
-        task_status = std::string(task_type_str) + " project file...";
-        if constexpr (task_type == TaskType::saving)
-            save_project_file(project_path);
-        else
-            load_project_file(project_path);
+        task_status = "Loading project file...";
+        if (load_profile_window::is_profiling_enabled())
+            load_profiler::begin_session();
+        load_project_file(project_path);
         // Proceed loading assets
-        ++asset_type_index;
-    } else if (asset_type_index == serializer::serializable_assets) {
+        ++load_level;
+    } else if (load_level == static_cast<long>(serializer::load_levels)) {
         task_progress = 1.f;
         task_status = "Done!";
-        window_list_menu::delete_entry(&task_renderer<task_type>);
+        window_list_menu::delete_entry(&load_task_renderer);
+        load_profiler::end_session();
         // Reset state for next time
-        asset_type_index = -1;
-        if (task_end_callback) {
-            task_end_callback();
-            task_end_callback = nullptr;
-        }
+        load_level = -1;
+        end_task();
     } else {
-        const auto set_progress_vars = [task_type_str](std::string_view progress_str,
-                                                       float progress) {
+        const auto set_progress_vars = [](std::string_view progress_str, float progress) {
             task_progress = progress;
-            task_status = std::string(task_type_str) + " " + std::string(progress_str) + "...";
+            task_status = "Loading " + std::string(progress_str) + "...";
         };
 
-        if constexpr (task_type == TaskType::saving)
-            serializer::save_one_asset_type(static_cast<std::size_t>(asset_type_index),
-                                            project_path, set_progress_vars);
-        else
-            serializer::load_one_asset_type(static_cast<std::size_t>(asset_type_index),
-                                            project_path, set_progress_vars);
+        serializer::load_one_level(static_cast<std::size_t>(load_level), project_path,
+                                   set_progress_vars);
 
-        ++asset_type_index;
+        ++load_level;
     }
 
-    ImGui::OpenPopup(task_type_str.data());
+    ImGui::OpenPopup("Loading");
     ImGui::SetNextWindowSize(ImVec2{300, 0}, ImGuiCond_Appearing);
-    if (ImGui::BeginPopupModal(task_type_str.data(), nullptr,
+    if (ImGui::BeginPopupModal("Loading", nullptr,
                                ImGuiWindowFlags_NoMove | ImGuiWindowFlags_NoResize)) {
         ImGui::TextUnformatted(task_status.c_str());
         ImGui::ProgressBar(task_progress);
@@ -151,7 +172,87 @@ template<TaskType task_type> void task_renderer(bool*) {
     }
 }
 
-void start_save() {
+/// Writes the project file and captures all the assets in the same frame, so that the saved
+/// project is consistent.
+static void snapshot_project() {
+    task_progress = 0.f;
+    task_status = "Saving project file...";
+    save_project_file(project_path);
+    save_tasks = serializer::snapshot_all_assets(project_path);
+}
+
+/// Completes the snapshots taken by start_save() and writes them in a background thread, so that
+/// the project can keep being edited while it is saved.
+static void save_task_renderer(bool*) {
+    if (!save_writer.valid()) {
+        bool complete = true;
+        for (auto& task : save_tasks) complete &= task->poll();
+        if (complete) {
+            save_writer = std::async(std::launch::async, [tasks = std::move(save_tasks)]() mutable {
+                for (std::size_t i = 0; i < tasks.size(); ++i) {
+                    tasks[i]->write([i, count = tasks.size()](std::string_view progress_str,
+                                                              float progress) {
+                        std::lock_guard lock(task_status_mutex);
+                        task_progress =
+                            (static_cast<float>(i) + progress) / static_cast<float>(count);
+                        task_status = "Saving " + std::string(progress_str) + "...";
+                    });
+                }
+                return std::move(tasks);
+            });
+            save_tasks.clear();
+        }
+    } else if (save_writer.wait_for(std::chrono::seconds(0)) == std::future_status::ready) {
+        save_writer.get();
+        save_writer = {};
+        if (auto callback = std::move(save_callback)) {
+            save_callback = nullptr;
+            callback();
+        }
+        if (save_queued) {
+            // Keep this window open for the next save
+            save_queued = false;
+            save_callback = std::move(queued_save_callback);
+            queued_save_callback = nullptr;
+            snapshot_project();
+        } else {
+            task_progress = 1.f;
+            task_status = "Done!";
+            window_list_menu::delete_entry(&save_task_renderer);
+            end_task();
+            return;
+        }
+    }
+
+    ImGui::SetNextWindowSize(ImVec2{300, 0}, ImGuiCond_Appearing);
+    if (ImGui::Begin("Saving", nullptr,
+                     ImGuiWindowFlags_NoResize | ImGuiWindowFlags_NoCollapse |
+                         ImGuiWindowFlags_NoSavedSettings)) {
+        std::lock_guard lock(task_status_mutex);
+        ImGui::TextUnformatted(task_status.c_str());
+        ImGui::ProgressBar(task_progress);
+        if (save_queued)
+            ImGui::TextUnformatted("The project will be saved again after this.");
+    }
+    ImGui::End();
+}
+
+void start_save(std::function<void()> on_saved) {
+    if (!save_tasks.empty() || save_writer.valid()) {
+        // Changes made after the current save started would be missing from it
+        save_queued = true;
+        if (on_saved && queued_save_callback) {
+            queued_save_callback = [first = std::move(queued_save_callback),
+                                    second = std::move(on_saved)]() {
+                first();
+                second();
+            };
+        } else if (on_saved) {
+            queued_save_callback = std::move(on_saved);
+        }
+        return;
+    }
+
     if (project_path.empty() || !fs::is_directory(project_path)) {
         if (const char* c_path =
                 noc_file_dialog_open(NOC_FILE_DIALOG_DIR, nullptr, nullptr, nullptr)) {
@@ -163,7 +264,9 @@ void start_save() {
             return;
     }
 
-    window_list_menu::add_entry({"", &task_renderer<TaskType::saving>, true, false});
+    save_callback = std::move(on_saved);
+    snapshot_project();
+    window_list_menu::add_entry({"", &save_task_renderer, true, false});
 }
 
 void start_load(fs::path _project_path, bool ignore_editor_version) {
@@ -174,7 +277,7 @@ void start_load(fs::path _project_path, bool ignore_editor_version) {
     global_tile_size::set(data.tile_size);
 
     project_path = _project_path;
-    window_list_menu::add_entry({"", &task_renderer<TaskType::loading>, true, false});
+    window_list_menu::add_entry({"", &load_task_renderer, true, false});
 }
 void set_callback(std::function<void()> cb) { task_end_callback = cb; }
 
@@ -72,7 +72,7 @@ void render(bool* p_show) {
         }
 
         for (const auto& [_id, sprite] :
-             detail::AssetContainer<assets::Sprite>::get_instance().map) {
+             detail::AssetContainer<assets::Sprite>::get_instance().storage) {
             ImGui::TextDisabled("%zu", _id);
             ImGui::SameLine();
             ImGui::Selectable(sprite.name.c_str());
@@ -3,9 +3,15 @@
 #include "window_manager.hpp"
 
 #include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <future>
 #include <imgui.h>
 #include <imgui_internal.h>
+#include <memory>
 #include <noc_file_dialog.h>
+#include <optional>
 #include <vector>
 
 #include "assets/map.hpp"
@@ -13,6 +19,7 @@
 #include "util/defs.hpp"
 #include "util/icons_material_design.hpp"
 #include "util/math.hpp"
+#include "util/thread_pool.hpp"
 
 #include "assets/shader.hpp"
 
@@ -25,7 +32,6 @@ namespace arpiyi::tileset_manager {
 
 Handle<assets::Shader> tile_shader;
 Handle<assets::Shader> grid_shader;
-Handle<assets::Shader> uv_tile_shader;
 Handle<assets::Mesh> quad_mesh;
 
 unsigned int grid_framebuffer;
@@ -77,218 +83,232 @@ static void update_grid_texture() {
     glBindFramebuffer(GL_FRAMEBUFFER, 0);
 }
 
-Handle<assets::Texture>
-calculate_rpgmaker_a2_auto_tileset_texture(assets::Texture const& source_tex) {
-    // The format RPGMaker uses for auto-tiling is pretty simple.
-    // It consists of 6 tiles (Each one composed by 2x2 minitiles):
-    // -----------------------------------------
-    // display_tile         all_external_corners
-    // upper-left corner    upper-right corner
-    // lower-left corner    lower-right corner
-    // -----------------------------------------
-    // display_tile is actually not used in the calculations; it's just the tile that RPGMaker shows
-    // in the editor.
-    // For more information, check out
-    // https://blog.rpgmakerweb.com/tutorials/anatomy-of-an-autotile/
-
-    const math::IVec2D rpgmaker_tileset_size_in_tiles{
-        static_cast<i32>(source_tex.w) / static_cast<i32>(global_tile_size::get()),
-        static_cast<i32>(source_tex.h) / static_cast<i32>(global_tile_size::get())};
-    const math::IVec2D rpgmaker_tileset_size_in_tilesets{rpgmaker_tileset_size_in_tiles.x / 2,
-                                                         rpgmaker_tileset_size_in_tiles.y / 3};
-    const i32 rpgmaker_tileset_number_of_tilesets =
-        rpgmaker_tileset_size_in_tilesets.x * rpgmaker_tileset_size_in_tilesets.y;
-    aml::Matrix4 tex_mat = aml::orthographic_rh(0.0f, 1.0f, 0.0f, 1.0f, -1.f, 1.f);
-
-    // 64 tiles are needed to cache all possible combinations of corners.
+namespace {
+
+/// Directory where generated autotile textures are cached, relative to the working directory like
+/// imgui.ini.
+const fs::path autotile_cache_dir = "cache/autotiles";
+
+/// FNV-1a. Only used for naming cache files, so it doesn't need to be a strong hash.
+u64 hash_bytes(void const* data, std::size_t size, u64 hash = 0xcbf29ce484222325) {
+    auto bytes = static_cast<u8 const*>(data);
+    for (std::size_t i = 0; i < size; ++i) {
+        hash ^= bytes[i];
+        hash *= 0x100000001b3;
+    }
+    return hash;
+}
+
+/// RGBA8 pixels, row by row, in the same order as they are uploaded to textures.
+struct Pixels {
+    u32 w = 0, h = 0;
+    std::vector<u8> data;
+};
+
+/// Pixels owned by someone else, like the decoded image of a PreparedLoad<Texture>.
+struct PixelsView {
+    u32 w = 0, h = 0;
+    u8 const* data = nullptr;
+};
+
+/// Decoded pixels of the image shown in the new tileset window. Kept after uploading them so that
+/// generating an autotile texture from the image doesn't need to decode it again.
+assets::PreparedLoad<assets::Texture> preview_pixels;
+
+/// Worker threads used for generating autotile textures. Created on first use and shared by all
+/// the imports.
+util::ThreadPool& get_autotile_thread_pool() {
+    static util::ThreadPool pool;
+    return pool;
+}
+
+/// Loads an image for the new tileset window, keeping its decoded pixels in preview_pixels.
+Handle<assets::Texture> load_preview_texture(fs::path const& path) {
+    preview_pixels = assets::raw_prepare_load<assets::Texture>({path});
+    if (!preview_pixels.data)
+        return Handle<assets::Texture>();
+
+    // Upload the pixels without handing their ownership over, so they are still there afterwards
+    assets::PreparedLoad<assets::Texture> upload;
+    upload.data = preview_pixels.data;
+    upload.w = preview_pixels.w;
+    upload.h = preview_pixels.h;
+    upload.filter = preview_pixels.filter;
+    upload.encoded_data = preview_pixels.encoded_data;
+    assets::Texture texture;
+    assets::raw_finish_load(texture, std::move(upload));
+    return asset_manager::put(texture);
+}
+
+/// @returns The amount of autotile blocks (And so columns of the generated texture) in an image of
+/// the given size.
+u32 get_autotile_block_count(autotile::Layout const& layout, u32 w, u32 h, u32 tile_size) {
+    return (w / (layout.get_block_width() * tile_size)) *
+           (h / (layout.get_group_height() * tile_size)) * layout.band_count;
+}
+
+fs::path get_autotile_cache_path(std::vector<u8> const& encoded_source,
+                                 u32 tile_size,
+                                 assets::Tileset::AutoType auto_type) {
+    u64 hash = hash_bytes(encoded_source.data(), encoded_source.size());
+    hash = hash_bytes(&tile_size, sizeof(tile_size), hash);
+    hash = hash_bytes(&auto_type, sizeof(auto_type), hash);
+    char name[32];
+    std::snprintf(name, sizeof(name), "%016llx.rgba", static_cast<unsigned long long>(hash));
+    return autotile_cache_dir / name;
+}
+
+/// Cache files contain the width and height of the image followed by its pixels. Files of any
+/// other size than the expected one are ignored.
+std::optional<Pixels> read_cached_pixels(fs::path const& path, u32 expected_w, u32 expected_h) {
+    std::ifstream f(path, std::ios::binary);
+    if (!f)
+        return std::nullopt;
+    Pixels pixels;
+    f.read(reinterpret_cast<char*>(&pixels.w), sizeof(pixels.w));
+    f.read(reinterpret_cast<char*>(&pixels.h), sizeof(pixels.h));
+    if (!f || pixels.w != expected_w || pixels.h != expected_h)
+        return std::nullopt;
+    pixels.data.resize(static_cast<std::size_t>(pixels.w) * pixels.h * 4);
+    f.read(reinterpret_cast<char*>(pixels.data.data()),
+           static_cast<std::streamsize>(pixels.data.size()));
+    if (f.gcount() != static_cast<std::streamsize>(pixels.data.size()))
+        return std::nullopt;
+    return pixels;
+}
+
+void write_cached_pixels(fs::path const& path, Pixels const& pixels) {
+    // The cache is only an optimization, so failing to write it is not an error
+    std::error_code ec;
+    fs::create_directories(path.parent_path(), ec);
+    std::ofstream f(path, std::ios::binary);
+    f.write(reinterpret_cast<const char*>(&pixels.w), sizeof(pixels.w));
+    f.write(reinterpret_cast<const char*>(&pixels.h), sizeof(pixels.h));
+    f.write(reinterpret_cast<const char*>(pixels.data.data()),
+            static_cast<std::streamsize>(pixels.data.size()));
+}
+
+/// Generates every tile of one of the autotile blocks of the source image, and places them in the
+/// given column of the target image.
+void blit_autotile_block(PixelsView const& source,
+                         Pixels& target,
+                         autotile::Layout const& layout,
+                         autotile::CompiledRules const& rules,
+                         u32 column,
+                         u32 tile_size) {
+    const u32 blocks_per_row = source.w / (layout.get_block_width() * tile_size);
+    const u32 band = column % layout.band_count;
+    const u32 block_x = (column / layout.band_count) % blocks_per_row;
+    const u32 group = column / (layout.band_count * blocks_per_row);
+    const u32 source_block_x = block_x * layout.get_block_width() * tile_size;
+    const u32 source_block_y =
+        (group * layout.get_group_height() + layout.get_band_offset(band)) * tile_size;
+
+    // Minitiles are half a tile wide and tall. The position of a minitile is given in minitiles,
+    // so with odd tile sizes the ones on the right or bottom half of a tile are a pixel bigger.
+    const auto minitile_offset = [tile_size](u32 pos) -> u32 {
+        return (pos / 2) * tile_size + (pos % 2) * (tile_size / 2);
+    };
+    const auto minitile_size = [tile_size](u32 pos) -> u32 {
+        return pos % 2 ? tile_size - tile_size / 2 : tile_size / 2;
+    };
+
+    for (u32 row = 0; row < rules.get_shape_count(column); ++row) {
+        const auto sources = autotile::get_minitile_sources(*layout.band_rules[band],
+                                                            rules.get_surroundings(column, row));
+        for (u32 minitile = 0; minitile < sources.size(); minitile++) {
+            const u32 source_x = source_block_x + minitile_offset(sources[minitile].x);
+            const u32 source_y = source_block_y + minitile_offset(sources[minitile].y);
+            const u32 target_x = column * tile_size + minitile_offset(minitile % 2);
+            const u32 target_y = row * tile_size + minitile_offset(minitile / 2);
+            const std::size_t row_bytes = minitile_size(minitile % 2) * 4;
+            for (u32 y = 0; y < minitile_size(minitile / 2); ++y) {
+                std::memcpy(&target.data[((target_y + y) * target.w + target_x) * 4],
+                            &source.data[((source_y + y) * source.w + source_x) * 4], row_bytes);
+            }
+        }
+    }
+}
+
+/// @param block_count Result of get_autotile_block_count() for the source image. Can't be 0.
+Pixels generate_autotile_pixels(PixelsView const& source,
+                                autotile::Layout const& layout,
+                                u32 tile_size,
+                                u32 block_count) {
+    assert(block_count > 0);
+    const autotile::CompiledRules rules(layout);
+
+    // 64 tiles are needed to cache all possible combinations of corners of floors.
     // HOWEVER, some of them are equal. RPGMaker-style texture only uses corner textures when there
     // aren't sides next to them. By doing some math, we end with the conclusion that only *47*
-    // tiles are needed. Since 47 can't be nicely split into a square/rectangle texture, we'll just
-    // do a 1*tileset_n*global_tile_size::get() x 47*global_tile_size::get() texture.
-    unsigned int temp_fb;
-    glGenFramebuffers(1, &temp_fb);
+    // tiles are needed (16 for walls, which have no corners). Since 47 can't be nicely split into a
+    // square/rectangle texture, we'll just do a block_count*tile_size x 47*tile_size texture.
+    Pixels generated;
+    generated.w = tile_size * block_count;
+    generated.h = rules.get_row_count() * tile_size;
+    generated.data.resize(static_cast<std::size_t>(generated.w) * generated.h * 4);
+
+    // Each block is written to its own column of the generated image, so they can be generated in
+    // parallel
+    std::vector<std::future<void>> tasks;
+    for (u32 column = 0; column < block_count; column++) {
+        tasks.emplace_back(get_autotile_thread_pool().submit([&, column]() {
+            blit_autotile_block(source, generated, layout, rules, column, tile_size);
+        }));
+    }
+    for (auto& task : tasks) task.get();
+    return generated;
+}
+
+/// Generates the autotile texture of the image in preview_pixels.
+/// @returns The generated texture, or an empty handle if the image is too small to contain any
+/// autotile.
+Handle<assets::Texture> calculate_auto_tileset_texture(assets::Tileset::AutoType auto_type) {
+    const auto layout = assets::Tileset::get_autotile_layout(auto_type);
+    assert(layout);
+    assert(preview_pixels.data && preview_pixels.encoded_data &&
+           "Autotile source image must be loaded without flipping");
+
+    const u32 tile_size = static_cast<u32>(global_tile_size::get());
+    const PixelsView source{static_cast<u32>(preview_pixels.w),
+                            static_cast<u32>(preview_pixels.h), preview_pixels.data};
+    const u32 block_count = get_autotile_block_count(*layout, source.w, source.h, tile_size);
+    if (block_count == 0)
+        return Handle<assets::Texture>();
+
+    // Cache entries are looked up by the contents of the image file, so nothing needs to be
+    // read back from the GPU or encoded to check them
+    const fs::path cache_path =
+        get_autotile_cache_path(*preview_pixels.encoded_data, tile_size, auto_type);
+    std::optional<Pixels> generated =
+        read_cached_pixels(cache_path, block_count * tile_size,
+                           autotile::CompiledRules(*layout).get_row_count() * tile_size);
+    if (!generated) {
+        generated = generate_autotile_pixels(source, *layout, tile_size, block_count);
+        write_cached_pixels(cache_path, *generated);
+    }
+
     assets::Texture generated_texture;
     glGenTextures(1, &generated_texture.handle);
     glBindTexture(GL_TEXTURE_2D, generated_texture.handle);
-    generated_texture.w = global_tile_size::get() * rpgmaker_tileset_number_of_tilesets;
-    generated_texture.h = 47 * global_tile_size::get();
+    generated_texture.w = generated->w;
+    generated_texture.h = generated->h;
     glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, generated_texture.w, generated_texture.h, 0, GL_RGBA,
-                 GL_UNSIGNED_BYTE, nullptr);
+                 GL_UNSIGNED_BYTE, generated->data.data());
     // Disable filtering
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-    // Attach the generated texture to the framebuffer
-    glBindFramebuffer(GL_FRAMEBUFFER, temp_fb);
-    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D,
-                           generated_texture.handle, 0);
-    glClearColor(0, 0, 0, 0);
-    glClear(GL_COLOR_BUFFER_BIT);
-
-    // Set up
-    glUseProgram(uv_tile_shader.get()->handle);
-    glBindVertexArray(quad_mesh.get()->vao);
-    glActiveTexture(GL_TEXTURE0);
-    glBindTexture(GL_TEXTURE_2D, source_tex.handle);
-    glViewport(0.f, 0.f, generated_texture.w, generated_texture.h);
-
-    enum tile_sides {
-        upper_left_corner = 1 << 0,
-        upper_middle_side = 1 << 1,
-        upper_right_corner = 1 << 2,
-        middle_left_side = 1 << 3,
-        middle_right_side = 1 << 4,
-        lower_left_corner = 1 << 5,
-        lower_middle_side = 1 << 6,
-        lower_right_corner = 1 << 7
-    };
-
-    for (i32 tileset_i = 0;
-         tileset_i < rpgmaker_tileset_size_in_tilesets.x * rpgmaker_tileset_size_in_tilesets.y;
-         tileset_i++) {
-        u8 tile_index = 0;
-        // Calculate each corner variation texture and draw it to the framebuffer.
-        for (u8 corner_variation = 0; corner_variation < 0xFF; corner_variation++) {
-            // For each bit of corner_variation, 1 is "tile of same type adjacent in that
-            // corner/side", 0 is the opposite.
-
-            if ((corner_variation & upper_left_corner) &&
-                ((corner_variation & upper_middle_side) || (corner_variation & middle_left_side)))
-                continue;
-            if ((corner_variation & upper_right_corner) &&
-                ((corner_variation & upper_middle_side) || (corner_variation & middle_right_side)))
-                continue;
-            if ((corner_variation & lower_left_corner) &&
-                ((corner_variation & lower_middle_side) || (corner_variation & middle_left_side)))
-                continue;
-            if ((corner_variation & lower_right_corner) &&
-                ((corner_variation & lower_middle_side) || (corner_variation & middle_right_side)))
-                continue;
-
-            constexpr u8 minitile_count = 4;
-            // Let's first go through each one of the minitiles in the corner variation.
-            for (u8 minitile = 0; minitile < minitile_count; minitile++) {
-                // "case" is used here to identify the type of minitile. Check out:
-                // https://dat5n5oxdq-flywheel.netdna-ssl.com/wp-content/uploads/2012/01/AT-Organization.png
-                // Or alternatively, the image at
-                // https://blog.rpgmakerweb.com/tutorials/anatomy-of-an-autotile/ Which binds each
-                // minitile to a number and letter.
-                // A minitile can be represented with a letter and a number. The letters go from A
-                // to D and the numbers go from 1 to 5. The letters represent the location of the
-                // minitile relative to the parent tile; The numbers represent the corner variation
-                // of that minitile.
-                // "A" minitiles represent those placed in the upper left part of the tile.
-                // "B" minitiles represent those placed in the upper right part of the tile.
-                // "C" minitiles represent those placed in the lower left part of the tile.
-                // "D" minitiles represent those placed in the lower right part of the tile.
-                // "1" minitiles represent those with two adjacent tiles (On both sides of the
-                // minitile)
-                // "2" minitiles represent those with no adjacent tiles (On both sides of the
-                // minitile)
-                // "3" minitiles represent those with every adjacent tile (On both sides of the
-                // minitile & on the corner)
-                // "4" minitiles represent those with an adjacent tile in their left or right,
-                // depending on the minitile.
-                // "5" minitiles represent those with an adjacent tile above or below, depending on
-                // the minitile.
-
-                // Represents the adjacent tiles for this minitile.
-                bool has_corner{};
-                bool has_vert_side{};
-                bool has_horz_side{};
-
-                switch (minitile) {
-                    case 0: // Upper left minitile ("A" case)
-                        has_corner = corner_variation & upper_left_corner;
-                        has_vert_side = corner_variation & upper_middle_side;
-                        has_horz_side = corner_variation & middle_left_side;
-                        break;
-                    case 1: // Upper right minitile ("B" case)
-                        has_corner = corner_variation & upper_right_corner;
-                        has_vert_side = corner_variation & upper_middle_side;
-                        has_horz_side = corner_variation & middle_right_side;
-                        break;
-                    case 2: // Lower left minitile ("C" case)
-                        has_corner = corner_variation & lower_left_corner;
-                        has_vert_side = corner_variation & lower_middle_side;
-                        has_horz_side = corner_variation & middle_left_side;
-                        break;
-                    case 3: // Lower right minitile ("D" case)
-                        has_corner = corner_variation & lower_right_corner;
-                        has_vert_side = corner_variation & lower_middle_side;
-                        has_horz_side = corner_variation & middle_right_side;
-                        break;
-                    default: ARPIYI_UNREACHABLE();
-                }
-
-                const float source_tile_uv_size_x =
-                                1.f / static_cast<float>(rpgmaker_tileset_size_in_tiles.x),
-                            source_tile_uv_size_y =
-                                1.f / static_cast<float>(rpgmaker_tileset_size_in_tiles.y);
-
-                float source_minitile_relative_x, source_minitile_relative_y;
-                if (!has_vert_side && !has_horz_side && has_corner) { // "1" case
-                    source_minitile_relative_x =
-                        source_tile_uv_size_x / 2.f * static_cast<float>((minitile % 2) + 2);
-                    source_minitile_relative_y =
-                        source_tile_uv_size_y / 2.f * static_cast<float>(minitile / 2);
-                } else { // Any other case ("2" to "5")
-                    enum MinitileFacing { right = 0b01, down = 0b10 };
-
-                    float minitile_pos_x = static_cast<float>(
-                              (minitile % 2) +
-                              (has_horz_side ? ((minitile & MinitileFacing::right) ? 2 : 0)
-                                             : ((minitile & MinitileFacing::right) ? 0 : 2))),
-                          minitile_pos_y = static_cast<float>(
-                              (minitile / 2) + (has_vert_side
-                                                    ? ((minitile & MinitileFacing::down) ? 2 : 0)
-                                                    : ((minitile & MinitileFacing::down) ? 0 : 2)));
-
-                    source_minitile_relative_x = source_tile_uv_size_x / 2.f * minitile_pos_x;
-                    source_minitile_relative_y = source_tile_uv_size_y / 2.f * (minitile_pos_y + 2);
-                }
-
-                source_minitile_relative_x += 1.f / rpgmaker_tileset_size_in_tilesets.x *
-                                              (tileset_i % rpgmaker_tileset_size_in_tilesets.x);
-                source_minitile_relative_y += 1.f / rpgmaker_tileset_size_in_tilesets.y *
-                                              (tileset_i / rpgmaker_tileset_size_in_tilesets.x);
-
-                const float target_tile_uv_x_scale =
-                    1.f / static_cast<float>(rpgmaker_tileset_number_of_tilesets);
-                constexpr float target_tile_uv_y_scale = 1.f / 47.f;
-                const float target_minitile_x =
-                                target_tile_uv_x_scale * (static_cast<float>(tileset_i) +
-                                                          static_cast<float>(minitile % 2) / 2.f),
-                            target_minitile_y =
-                                target_tile_uv_y_scale * (static_cast<float>(tile_index) +
-                                                          static_cast<float>(minitile / 2) / 2.f);
-                aml::Matrix4 model = aml::Matrix4::identity;
-                model = model * aml::translate({target_minitile_x, target_minitile_y, 0});
-                model = model *
-                        aml::scale({target_tile_uv_x_scale / 2.f, target_tile_uv_y_scale / 2.f, 1});
-                glUniformMatrix4fv(1, 1, GL_FALSE, model.get_raw());
-                glUniformMatrix4fv(2, 1, GL_FALSE, tex_mat.get_raw());
-                glUniform2f(3, source_minitile_relative_x, source_minitile_relative_y); // UV start
-                glUniform2f(4, source_minitile_relative_x + source_tile_uv_size_x / 2.f,
-                            source_minitile_relative_y + source_tile_uv_size_y / 2.f); // UV end
-                constexpr int quad_verts = 2 * 3;
-                glDrawArrays(GL_TRIANGLES, 0, quad_verts);
-            }
-            tile_index++;
-        }
-    }
-
-    glBindFramebuffer(GL_FRAMEBUFFER, 0);
-    glDeleteFramebuffers(1, &temp_fb);
 
     return asset_manager::put(generated_texture);
 }
 
+} // namespace
+
 void init() {
     glGenFramebuffers(1, &grid_framebuffer);
 
     tile_shader = asset_manager::load<assets::Shader>({"data/basic.vert", "data/basic.frag"});
     grid_shader = asset_manager::load<assets::Shader>({"data/grid.vert", "data/grid.frag"});
-    uv_tile_shader = asset_manager::load<assets::Shader>({"data/tile.vert", "data/tile_uv.frag"});
     quad_mesh = asset_manager::put<assets::Mesh>(assets::Mesh::generate_quad());
 
     proj_mat = aml::orthographic_rh(0.0f, 1.0f, 1.0f, 0.0f, -10000.f, 10000.f);
@@ -429,11 +449,12 @@ void render(bool* p_show) {
             }
             ImGui::EndMenuBar();
         }
-        if (detail::AssetContainer<assets::Tileset>::get_instance().map.empty())
+        if (detail::AssetContainer<assets::Tileset>::get_instance().storage.empty())
             ImGui::TextDisabled("No tilesets");
         else {
-            int id_to_delete = -1;
-            for (auto& [_id, _t] : detail::AssetContainer<assets::Tileset>::get_instance().map) {
+            u64 id_to_delete = Handle<assets::Tileset>::noid;
+            for (auto& [_id, _t] :
+                 detail::AssetContainer<assets::Tileset>::get_instance().storage) {
                 ImGui::TextDisabled("%zu", _id);
                 ImGui::SameLine();
                 std::string selectable_strid = _t.name;
@@ -454,9 +475,8 @@ void render(bool* p_show) {
                 }
             }
 
-            if (id_to_delete != -1) {
+            if (id_to_delete != Handle<assets::Tileset>::noid) {
                 Handle<assets::Tileset>(id_to_delete).unload();
-                detail::AssetContainer<assets::Tileset>::get_instance().map.erase(id_to_delete);
             }
         }
     }
@@ -470,7 +490,7 @@ void render(bool* p_show) {
                                          ImGuiInputTextFlags_EnterReturnsTrue)) {
                 preview_texture.unload();
                 if (fs::is_regular_file(path_selected))
-                    preview_texture = asset_manager::load<assets::Texture>({path_selected});
+                    preview_texture = load_preview_texture(path_selected);
             }
             ImGui::SameLine();
             if (ImGui::Button("Explore...")) {
@@ -482,14 +502,16 @@ void render(bool* p_show) {
                 if (noc_path_selected && fs::is_regular_file(noc_path_selected)) {
                     strcpy(path_selected, noc_path_selected);
                     preview_texture.unload();
-                    preview_texture = asset_manager::load<assets::Texture>({path_selected});
+                    preview_texture = load_preview_texture(path_selected);
                 }
             }
             bool valid = preview_texture.get();
 
             static auto auto_type = assets::Tileset::AutoType::none;
-            static const char* auto_type_bindings[] = {"Normal", "RPGMaker A2 Tileset"};
-            constexpr u32 auto_type_bindings_count = 2;
+            static const char* auto_type_bindings[] = {"Normal", "RPGMaker A2 Tileset",
+                                                       "RPGMaker A3 Tileset",
+                                                       "RPGMaker A4 Tileset"};
+            constexpr u32 auto_type_bindings_count = 4;
             static_assert(auto_type_bindings_count == (u32)assets::Tileset::AutoType::count);
             if (ImGui::BeginCombo("Type", auto_type_bindings[static_cast<u32>(auto_type)])) {
                 for (u32 i = 0; i < auto_type_bindings_count; i++) {
@@ -503,7 +525,7 @@ void render(bool* p_show) {
 
             static int input_tile_size = global_tile_size::get();
             bool can_modify_tile_size =
-                detail::AssetContainer<assets::Tileset>::get_instance().map.empty();
+                detail::AssetContainer<assets::Tileset>::get_instance().storage.empty();
             if (!can_modify_tile_size)
                 input_tile_size = global_tile_size::get();
             if (can_modify_tile_size) {
@@ -536,15 +558,21 @@ void render(bool* p_show) {
                     ImGui::PopStyleColor();
                     valid = false;
                 }
-                if (auto_type == assets::Tileset::AutoType::rpgmaker_a2) {
-                    if (tex->w % (2 * input_tile_size) != 0 ||
-                        tex->h % (3 * input_tile_size) != 0) {
+                if (const auto layout = assets::Tileset::get_autotile_layout(auto_type)) {
+                    const u32 block_width = layout->get_block_width();
+                    const u32 group_height = layout->get_group_height();
+                    if (tex->w < block_width * input_tile_size ||
+                        tex->h < group_height * input_tile_size ||
+                        tex->w % (block_width * input_tile_size) != 0 ||
+                        tex->h % (group_height * input_tile_size) != 0) {
                         ImGui::PushStyleColor(ImGuiCol_Text, {1, .1f, .1f, 1});
                         ImGui::TextWrapped(
                             ICON_MD_ERROR
-                            " This image doesn't look like a proper RPGMaker A2 tileset.\nRPGMaker "
-                            "A2 tilesets must have a width that is multiple of 2 * tilesize and a "
-                            "height that is multiple of 3 * tilesize.");
+                            " This image doesn't look like a proper %s.\nThese tilesets must have "
+                            "a width that is multiple of %u * tilesize and a height that is "
+                            "multiple of %u * tilesize.",
+                            auto_type_bindings[static_cast<u32>(auto_type)], block_width,
+                            group_height);
                         ImGui::PopStyleColor();
                         valid = false;
                     }
@@ -576,10 +604,12 @@ void render(bool* p_show) {
                         tileset.texture = preview_texture;
                         break;
 
-                    case (assets::Tileset::AutoType::rpgmaker_a2): {
-                        tileset.texture =
-                            calculate_rpgmaker_a2_auto_tileset_texture(*preview_texture.get());
+                    case (assets::Tileset::AutoType::rpgmaker_a2):
+                    case (assets::Tileset::AutoType::rpgmaker_a3):
+                    case (assets::Tileset::AutoType::rpgmaker_a4): {
+                        tileset.texture = calculate_auto_tileset_texture(auto_type);
                         preview_texture.unload();
+                        preview_pixels = assets::PreparedLoad<assets::Texture>();
                         break;
                     }
 
@@ -587,6 +617,7 @@ void render(bool* p_show) {
                         assert(false); // not implemented, outta here
                         break;
                 }
+                tileset.compile_autotile_rules();
                 selection.tileset = asset_manager::put(tileset);
                 update_grid_texture();
                 show_new_tileset = false;
@@ -602,7 +633,8 @@ void render(bool* p_show) {
 
 std::vector<Handle<assets::Tileset>> get_tilesets() {
     std::vector<Handle<assets::Tileset>> tilesets;
-    for (const auto& [id, tileset] : detail::AssetContainer<assets::Tileset>::get_instance().map) {
+    for (const auto& [id, tileset] :
+         detail::AssetContainer<assets::Tileset>::get_instance().storage) {
         tilesets.emplace_back(id);
     }
     return tilesets;
@@ -3,6 +3,7 @@
 #include "widgets/pickers.hpp"
 #include <algorithm>
 
+#include "map_manager.hpp"
 #include "script_manager.hpp"
 #include "util/icons_material_design.hpp"
 #include "window_list_menu.hpp"
@@ -17,8 +18,10 @@ struct SelectedAsset {
     enum class Type { entity, comment } type;
 } static selection;
 
-void draw_entity_inspector(assets::Entity& entity) {
+/// @returns True if the entity was modified.
+bool draw_entity_inspector(assets::Entity& entity) {
     static bool show_sprite_selector = false;
+    bool modified = false;
 
     char buf[assets::Entity::name_length_limit];
     strcpy(buf, entity.name.c_str());
@@ -43,8 +46,10 @@ void draw_entity_inspector(assets::Entity& entity) {
     ImGui::SameLine();
     ImGui::TextUnformatted("Sprite");
 
-    if (ImGui::InputText("Name", buf, 32))
+    if (ImGui::InputText("Name", buf, 32)) {
         entity.name = buf;
+        modified = true;
+    }
 
     ImGui::TextUnformatted("Scripts");
     ImGui::PushStyleVar(ImGuiStyleVar_ChildBorderSize, 1.f);
@@ -75,13 +80,15 @@ void draw_entity_inspector(assets::Entity& entity) {
     if (script_to_erase.get()) {
         entity.scripts.erase(
             std::remove(entity.scripts.begin(), entity.scripts.end(), script_to_erase));
+        modified = true;
     }
 
     if (ImGui::BeginCombo(ICON_MD_ADD, "")) {
-        for (auto& [id, script] : detail::AssetContainer<assets::Script>::get_instance().map) {
+        for (auto& [id, script] : detail::AssetContainer<assets::Script>::get_instance().storage) {
             std::string selectable_strid = std::to_string(id) + " " + script.name;
             if (ImGui::Selectable(selectable_strid.c_str())) {
                 entity.scripts.emplace_back(Handle<assets::Script>(id));
+                modified = true;
             }
         }
         ImGui::EndCombo();
@@ -92,18 +99,25 @@ void draw_entity_inspector(assets::Entity& entity) {
 
     if (show_sprite_selector) {
         if (ImGui::Begin(ICON_MD_ADD "Sprite Selector", &show_sprite_selector)) {
-            if(widgets::sprite_picker::show(entity.sprite))
+            if(widgets::sprite_picker::show(entity.sprite)) {
                 show_sprite_selector = false;
+                modified = true;
+            }
         }
         ImGui::End();
     }
+    return modified;
 }
 
-void draw_comment_inspector(assets::Map::Comment& comment) {
+/// @returns True if the comment was modified.
+bool draw_comment_inspector(assets::Map::Comment& comment) {
     char buf[256];
     strcpy(buf, comment.text.c_str());
-    if (ImGui::InputTextMultiline("Text", buf, 256))
+    if (ImGui::InputTextMultiline("Text", buf, 256)) {
         comment.text = buf;
+        return true;
+    }
+    return false;
 }
 
 void init() { window_list_menu::add_entry({"Inspector", &render}); }
@@ -117,7 +131,8 @@ void render(bool* p_open) {
                     ImGui::SameLine();
                     ImGui::TextDisabled("ID %zu", selection.id);
 
-                    draw_entity_inspector(*e);
+                    if (draw_entity_inspector(*e))
+                        selection.get_entity().mark_dirty();
                 }
             } break;
 
@@ -127,7 +142,9 @@ void render(bool* p_open) {
                     ImGui::SameLine();
                     ImGui::TextDisabled("ID %zu", selection.id);
 
-                    draw_comment_inspector(*c);
+                    // Comments are saved as part of their map
+                    if (draw_comment_inspector(*c))
+                        map_manager::get_current_map().mark_dirty();
                 }
             } break;
         }
@@ -30,7 +30,8 @@ bool show(Handle<assets::Sprite>& spr) {
     bool changed = false;
     std::size_t column = 0;
     std::size_t columns_to_render = ImGui::GetWindowWidth() / 60;
-    for (const auto& [id, sprite] : detail::AssetContainer<assets::Sprite>::get_instance().map) {
+    for (const auto& [id, sprite] :
+         detail::AssetContainer<assets::Sprite>::get_instance().storage) {
         ImGui::BeginGroup();
         assert(sprite.texture.get());
         // ImageButtons use the texture ID as their own ID for some bizarre reasons, so we need to
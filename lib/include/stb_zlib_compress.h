@@ -0,0 +1,11 @@
+#ifndef ARPIYI_STB_ZLIB_COMPRESS_H
+#define ARPIYI_STB_ZLIB_COMPRESS_H
+
+/// Compresses data into a zlib stream with the compressor of stb_image_write, which its header
+/// doesn't declare. quality is the size of the hash table buckets used to find matches; 8 is what
+/// stb_image_write uses for PNGs.
+/// @returns The compressed data, which must be freed with stb_zlib_free().
+unsigned char* stb_zlib_compress(unsigned char* data, int data_len, int* out_len, int quality);
+void stb_zlib_free(unsigned char* data);
+
+#endif // ARPIYI_STB_ZLIB_COMPRESS_H
@@ -1,2 +1,10 @@
 #define STB_IMAGE_WRITE_IMPLEMENTATION
-#include <stb_image_write.h>
\ No newline at end of file
+#include <stb_image_write.h>
+
+#include "stb_zlib_compress.h"
+
+unsigned char* stb_zlib_compress(unsigned char* data, int data_len, int* out_len, int quality) {
+    return stbi_zlib_compress(data, data_len, out_len, quality);
+}
+
+void stb_zlib_free(unsigned char* data) { STBIW_FREE(data); }
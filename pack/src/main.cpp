@@ -0,0 +1,158 @@
+#include "assets/texture.hpp"
+#include "pack.hpp"
+#include "serializer.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <rapidjson/document.h>
+#include <string>
+#include <vector>
+
+namespace fs = std::filesystem;
+using namespace arpiyi;
+
+struct PackEntry {
+    pack::TocEntry toc_entry;
+    std::vector<char> data;
+};
+
+static std::vector<char> read_file(fs::path const& path) {
+    std::ifstream f(path, std::ios::binary);
+    return std::vector<char>(std::istreambuf_iterator<char>(f), std::istreambuf_iterator<char>());
+}
+
+static u64 align(u64 offset, u64 alignment) {
+    return (offset + alignment - 1) / alignment * alignment;
+}
+
+static bool make_entry(std::string_view type_name, u64 id, std::vector<char> data, PackEntry& entry) {
+    if (type_name.size() > sizeof(entry.toc_entry.type_name)) {
+        std::cerr << "Asset type name \"" << type_name << "\" is too long to be packed."
+                  << std::endl;
+        return false;
+    }
+    entry.toc_entry = {};
+    std::memcpy(entry.toc_entry.type_name, type_name.data(), type_name.size());
+    entry.toc_entry.id = id;
+    entry.data = std::move(data);
+    return true;
+}
+
+/// Decodes a texture file so that the player can upload its pixels without any processing.
+static bool decode_texture(std::vector<char>& data) {
+    int w, h, channels;
+    unsigned char* pixels =
+        stbi_load_from_memory(reinterpret_cast<unsigned char const*>(data.data()),
+                              static_cast<int>(data.size()), &w, &h, &channels, 4);
+    if (!pixels)
+        return false;
+
+    const pack::TexturePayloadHeader header{static_cast<u32>(w), static_cast<u32>(h)};
+    const std::size_t pixels_size = static_cast<std::size_t>(w) * h * 4;
+    data.assign(pack::payload_alignment + pixels_size, 0);
+    std::memcpy(data.data(), &header, sizeof(header));
+    std::memcpy(data.data() + pack::payload_alignment, pixels, pixels_size);
+    stbi_image_free(pixels);
+    return true;
+}
+
+int main(int argc, const char* argv[]) {
+    if (argc != 3) {
+        std::cerr << "Usage: arpiyi-pack <project folder> <output pack file>" << std::endl;
+        return -1;
+    }
+    const fs::path project_path = fs::absolute(argv[1]);
+    const fs::path out_path = fs::absolute(argv[2]);
+    if (!fs::is_regular_file(project_path / "project.json")) {
+        std::cerr << "Path given is not an arpiyi project folder." << std::endl;
+        return -1;
+    }
+
+    const auto start_time = std::chrono::steady_clock::now();
+    namespace pfd = serializer::detail::project_file_definitions;
+    namespace mfd = serializer::detail::meta_file_definitions;
+
+    std::vector<PackEntry> entries;
+    entries.emplace_back();
+    make_entry(pack::project_file_type_name, 0, read_file(project_path / "project.json"),
+               entries.back());
+
+    // Every meta file lists the assets of one type, named after the type's directory
+    for (auto const& meta_entry : fs::directory_iterator(project_path / pfd::metadata_path)) {
+        if (meta_entry.path().extension() != ".json")
+            continue;
+        const std::string type_name = meta_entry.path().stem().generic_string();
+        const bool is_texture = type_name == assets::AssetDirName<assets::Texture>::value;
+
+        const std::vector<char> meta_data = read_file(meta_entry.path());
+        rapidjson::Document doc;
+        doc.Parse(meta_data.data(), meta_data.size());
+        if (doc.HasParseError() || !doc.IsArray()) {
+            std::cerr << "Could not parse " << meta_entry.path().generic_string() << std::endl;
+            return -1;
+        }
+
+        for (auto const& asset_meta : doc.GetArray()) {
+            const u64 id = asset_meta.GetObject()[mfd::id_json_key.data()].GetUint64();
+            const fs::path asset_path =
+                project_path / asset_meta.GetObject()[mfd::path_json_key.data()].GetString();
+            std::vector<char> data = read_file(asset_path);
+            if (is_texture && !decode_texture(data)) {
+                std::cerr << "Could not decode texture " << asset_path.generic_string()
+                          << std::endl;
+                return -1;
+            }
+
+            entries.emplace_back();
+            if (!make_entry(type_name, id, std::move(data), entries.back()))
+                return -1;
+        }
+    }
+
+    std::sort(entries.begin(), entries.end(), [](PackEntry const& a, PackEntry const& b) {
+        return std::make_pair(a.toc_entry.get_type_name(), a.toc_entry.id) <
+               std::make_pair(b.toc_entry.get_type_name(), b.toc_entry.id);
+    });
+
+    pack::Header header{};
+    std::memcpy(header.magic, pack::magic, sizeof(pack::magic));
+    header.version = pack::format_version;
+    header.toc_count = static_cast<u32>(entries.size());
+    header.toc_offset = align(sizeof(pack::Header), alignof(pack::TocEntry));
+
+    u64 offset = header.toc_offset + sizeof(pack::TocEntry) * entries.size();
+    for (auto& entry : entries) {
+        offset = align(offset, pack::payload_alignment);
+        entry.toc_entry.offset = offset;
+        entry.toc_entry.size = entry.data.size();
+        offset += entry.data.size();
+    }
+
+    std::ofstream out(out_path, std::ios::binary);
+    if (!out) {
+        std::cerr << "Could not open " << out_path.generic_string() << " for writing." << std::endl;
+        return -1;
+    }
+    const auto pad_to = [&out](u64 pos) {
+        while (static_cast<u64>(out.tellp()) < pos) out.put('\0');
+    };
+    out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    pad_to(header.toc_offset);
+    for (auto const& entry : entries)
+        out.write(reinterpret_cast<const char*>(&entry.toc_entry), sizeof(pack::TocEntry));
+    for (auto const& entry : entries) {
+        pad_to(entry.toc_entry.offset);
+        out.write(entry.data.data(), static_cast<std::streamsize>(entry.data.size()));
+    }
+    out.close();
+
+    const auto elapsed = std::chrono::duration<float>(std::chrono::steady_clock::now() - start_time);
+    std::cout << "Packed " << entries.size() - 1 << " assets into " << out_path.generic_string()
+              << " (" << offset / 1024 << " KiB) in " << elapsed.count() << "s." << std::endl;
+    return 0;
+}
@@ -1,10 +1,21 @@
 #ifndef ARPIYI_DEFAULT_API_IMPLS_HPP
 #define ARPIYI_DEFAULT_API_IMPLS_HPP
 
+#include "assets/map.hpp"
+#include "renderer/sprite_batch.hpp"
+
 namespace arpiyi::default_api_impls {
 
 void init();
 
+void set_layer_render_mode(assets::Map::Layer::RenderMode mode);
+[[nodiscard]] assets::Map::Layer::RenderMode get_layer_render_mode();
+
+/// Returns the statistics of the last entity sprite batch drawn.
+[[nodiscard]] renderer::SpriteBatch::Stats const& get_sprite_batch_stats();
+/// Returns the amount of atlas textures all sprites were packed into.
+[[nodiscard]] std::size_t get_sprite_atlas_count();
+
 }
 
 #endif // ARPIYI_DEFAULT_API_IMPLS_HPP
@@ -0,0 +1,30 @@
+#ifndef ARPIYI_MAP_LOADER_HPP
+#define ARPIYI_MAP_LOADER_HPP
+
+#include "asset_manager.hpp"
+#include "assets/map.hpp"
+#include "assets/script.hpp"
+#include "serializer.hpp"
+
+#include <memory>
+
+namespace arpiyi::map_loader {
+
+/// Enables lazy loading: From now on, only the current map and the assets it uses are kept loaded,
+/// and they are loaded from the given source when changing maps.
+void init(std::unique_ptr<serializer::AssetSource> source);
+[[nodiscard]] bool is_lazy();
+
+/// Loads a script that must stay loaded regardless of the current map, like the startup script.
+/// Does nothing if not in lazy mode.
+void keep_loaded(Handle<assets::Script> script);
+
+/// Makes the given map the current one. In lazy mode, the map is loaded along with its layers'
+/// tilesets and textures and its entities' sprites, textures and scripts, and the assets only used
+/// by the previous map are unloaded.
+/// @returns False if there is no map with that ID. The current map is left unchanged then.
+bool change_map(Handle<assets::Map> map);
+
+} // namespace arpiyi::map_loader
+
+#endif // ARPIYI_MAP_LOADER_HPP
@@ -4,13 +4,19 @@
 #include <glad/glad.h>
 #include <GLFW/glfw3.h>
 /* clang-format on */
+#include <cmath>
 #include <iostream>
 #include "assets/map.hpp"
 #include "assets/shader.hpp"
 #include "asset_manager.hpp"
+#include "default_api_impls.hpp"
 #include "game_data_manager.hpp"
 #include "window_manager.hpp"
 #include "global_tile_size.hpp"
+#include "map_loader.hpp"
+#include "renderer/sprite_atlas.hpp"
+#include "renderer/sprite_batch.hpp"
+#include "util/defs.hpp"
 
 #include <anton/math/matrix4.hpp>
 #include <anton/math/transform.hpp>
@@ -18,34 +24,44 @@
 namespace aml = anton::math;
 
 static arpiyi::Handle<arpiyi::assets::Shader> sprite_shader;
-static arpiyi::Handle<arpiyi::assets::Shader> tile_shader;
+static arpiyi::Handle<arpiyi::assets::Shader> tilemap_shader;
+static arpiyi::Handle<arpiyi::assets::Shader> instanced_tile_shader;
 static arpiyi::Handle<arpiyi::assets::Mesh> quad_mesh;
 static aml::Matrix4 proj_mat;
+static arpiyi::renderer::SpriteBatch sprite_batch;
+static arpiyi::renderer::SpriteAtlas sprite_atlas;
+static arpiyi::assets::Map::Layer::RenderMode layer_render_mode =
+    arpiyi::assets::Map::Layer::RenderMode::mesh;
 
 namespace arpiyi::default_api_impls {
 
 void init() {
     quad_mesh = asset_manager::put<assets::Mesh>(assets::Mesh::generate_quad());
     sprite_shader = asset_manager::load<assets::Shader>({"data/basic.vert", "data/basic.frag"});
-    tile_shader = asset_manager::load<assets::Shader>({"data/basic.vert", "data/tile_uv.frag"});
+    tilemap_shader =
+        asset_manager::load<assets::Shader>({"data/basic.vert", "data/tilemap.frag"});
+    instanced_tile_shader =
+        asset_manager::load<assets::Shader>({"data/tile_instanced.vert", "data/basic.frag"});
+    // Sprites don't change while playing, so pack them now so that entities can be batched
+    // together regardless of what texture their sprite came from
+    sprite_atlas.build();
 }
 
+void set_layer_render_mode(assets::Map::Layer::RenderMode mode) { layer_render_mode = mode; }
+assets::Map::Layer::RenderMode get_layer_render_mode() { return layer_render_mode; }
+
+renderer::SpriteBatch::Stats const& get_sprite_batch_stats() { return sprite_batch.get_stats(); }
+std::size_t get_sprite_atlas_count() { return sprite_atlas.get_atlas_count(); }
+
 } // namespace arpiyi::default_api_impls
 
 namespace arpiyi::api {
 
 void render_map_layer(assets::Map const& map, assets::Map::Layer& layer) {
-    if (!layer.get_mesh().get()) {
-        layer.regenerate_mesh();
-    }
-    assert(layer.get_mesh().get());
     glBindFramebuffer(GL_FRAMEBUFFER, 0);
     glActiveTexture(GL_TEXTURE0);
     glBindTexture(GL_TEXTURE_2D, layer.tileset.get()->texture.get()->handle);
 
-    glUseProgram(sprite_shader.get()->handle);
-    glBindVertexArray(layer.get_mesh().get()->vao);
-
     const auto& cam = game_data_manager::get_game_data().cam;
 
     const float map_total_width = map.width * global_tile_size::get() * cam->zoom;
@@ -57,62 +73,99 @@ void render_map_layer(assets::Map const& map, assets::Map::Layer& layer) {
     model *= aml::translate({0, map_total_height, 0});
     // Translate by camera vector
     model *= aml::translate(aml::Vector3(-cam->pos.x, -cam->pos.y, 0) * global_tile_size::get() * cam->zoom);
+    // The instanced renderer gives positions in tiles instead of normalized to the map size
+    const float tile_size = global_tile_size::get() * cam->zoom;
+    aml::Matrix4 tile_model = model * aml::scale(aml::Vector3{tile_size, -tile_size, 1});
     // Scale accordingly
     model *= aml::scale(aml::Vector3{map_total_width, -map_total_height, 1});
 
-    glUniformMatrix4fv(1, 1, GL_FALSE, model.get_raw());
-    glUniformMatrix4fv(2, 1, GL_FALSE, proj_mat.get_raw());
-
-    constexpr int quad_verts = 2 * 3;
-    glDrawArrays(GL_TRIANGLES, 0, map.width * map.height * quad_verts);
+    // The projection is centered on the camera, so calculate which tiles fall inside the screen
+    const math::IVec2D output_size = window_manager::get_framebuf_size();
+    const float half_view_width = static_cast<float>(output_size.x) / (2.f * tile_size);
+    const float half_view_height = static_cast<float>(output_size.y) / (2.f * tile_size);
+    const math::IRect2D tile_view{
+        {static_cast<i32>(std::floor(cam->pos.x - half_view_width)),
+         static_cast<i32>(std::floor(cam->pos.y - half_view_height))},
+        {static_cast<i32>(std::ceil(cam->pos.x + half_view_width)) + 1,
+         static_cast<i32>(std::ceil(cam->pos.y + half_view_height)) + 1}};
+
+    const math::IVec2D tileset_size = layer.tileset.get()->get_size_in_tiles();
+    switch (layer_render_mode) {
+        case assets::Map::Layer::RenderMode::mesh: {
+            glUseProgram(sprite_shader.get()->handle);
+            glUniformMatrix4fv(1, 1, GL_FALSE, model.get_raw());
+            glUniformMatrix4fv(2, 1, GL_FALSE, proj_mat.get_raw());
+
+            layer.draw_chunks(tile_view);
+        } break;
+
+        case assets::Map::Layer::RenderMode::instanced: {
+            glUseProgram(instanced_tile_shader.get()->handle);
+            glUniformMatrix4fv(1, 1, GL_FALSE, tile_model.get_raw());
+            glUniformMatrix4fv(2, 1, GL_FALSE, proj_mat.get_raw());
+            glUniform2ui(3, tileset_size.x, tileset_size.y);
+            glUniform1ui(4, map.height);
+
+            layer.draw_instanced_chunks(tile_view);
+        } break;
+
+        case assets::Map::Layer::RenderMode::tile_texture: {
+            layer.update_tile_texture();
+            glUseProgram(tilemap_shader.get()->handle);
+            glActiveTexture(GL_TEXTURE1);
+            glBindTexture(GL_TEXTURE_2D, layer.get_tile_texture());
+            glActiveTexture(GL_TEXTURE0);
+            glBindVertexArray(quad_mesh.get()->vao);
+
+            glUniformMatrix4fv(1, 1, GL_FALSE, model.get_raw());
+            glUniformMatrix4fv(2, 1, GL_FALSE, proj_mat.get_raw());
+            glUniform2ui(3, tileset_size.x, tileset_size.y);
+
+            constexpr int quad_verts = 2 * 3;
+            glDrawArrays(GL_TRIANGLES, 0, quad_verts);
+        } break;
+
+        default: ARPIYI_UNREACHABLE(); break;
+    }
 }
 
 void render_map_entities(assets::Map const& map) {
     const auto& cam = game_data_manager::get_game_data().cam;
 
-    const float map_total_width = map.width * global_tile_size::get() * cam->zoom;
-    const float map_total_height = map.height * global_tile_size::get() * cam->zoom;
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    glActiveTexture(GL_TEXTURE0);
+    glUseProgram(sprite_shader.get()->handle);
+    // Sprite vertices are already given in screen space
+    aml::Matrix4 model = aml::Matrix4::identity;
+    glUniformMatrix4fv(1, 1, GL_FALSE, model.get_raw());
+    glUniformMatrix4fv(2, 1, GL_FALSE, proj_mat.get_raw());
 
+    const float tile_size = global_tile_size::get() * cam->zoom;
+    sprite_batch.begin();
     for (const auto& entity_handle : map.entities) {
         assert(entity_handle.get());
         if (auto entity = entity_handle.get()) {
             if (auto sprite = entity->sprite.get()) {
                 assert(sprite->texture.get());
-                glBindFramebuffer(GL_FRAMEBUFFER, 0);
-                glActiveTexture(GL_TEXTURE0);
-                glBindTexture(GL_TEXTURE_2D, sprite->texture.get()->handle);
-
-                glUseProgram(tile_shader.get()->handle);
-                glBindVertexArray(quad_mesh.get()->vao);
-
                 const auto size_in_pixels = sprite->get_size_in_pixels();
-                float sprite_total_width = size_in_pixels.x * cam->zoom;
-                float sprite_total_height = size_in_pixels.y * cam->zoom;
-
-                aml::Matrix4 model = aml::Matrix4::identity;
-
-                // Apply sprite pivot
-                model *= aml::translate(aml::Vector3(-sprite->pivot) /
-                                        aml::Vector3(map_total_width, map_total_height, 1));
-                // Translate by position of entity
-                model *=
-                    aml::translate(aml::Vector3(entity->pos) * global_tile_size::get() * cam->zoom);
-                // Translate by camera vector
-                model *=
-                    aml::translate(aml::Vector3(-cam->pos) * global_tile_size::get() * cam->zoom);
-                // Scale accordingly
-                model *= aml::scale(aml::Vector3{sprite_total_width, sprite_total_height, 1});
-
-                glUniformMatrix4fv(1, 1, GL_FALSE, model.get_raw());
-                glUniformMatrix4fv(2, 1, GL_FALSE, proj_mat.get_raw());
-                glUniform2f(3, sprite->uv_min.x, sprite->uv_min.y);
-                glUniform2f(4, sprite->uv_max.x, sprite->uv_max.y);
-
-                constexpr int quad_verts = 2 * 3;
-                glDrawArrays(GL_TRIANGLES, 0, quad_verts);
+                const aml::Vector2 sprite_size{size_in_pixels.x * cam->zoom,
+                                               size_in_pixels.y * cam->zoom};
+                // Translate by position of entity and camera vector, then apply sprite pivot
+                const aml::Vector2 sprite_pos{
+                    (entity->pos.x - cam->pos.x) * tile_size - sprite->pivot.x * sprite_size.x,
+                    (entity->pos.y - cam->pos.y) * tile_size - sprite->pivot.y * sprite_size.y};
+
+                if (const auto region = sprite_atlas.find(entity->sprite)) {
+                    sprite_batch.draw(region->texture, sprite_pos, sprite_size, region->uv_min,
+                                      region->uv_max);
+                } else {
+                    sprite_batch.draw(sprite->texture.get()->handle, sprite_pos, sprite_size,
+                                      sprite->uv_min, sprite->uv_max);
+                }
             }
         }
     }
+    sprite_batch.end();
 }
 
 void map_screen_layer_render_cb() {
@@ -129,6 +182,15 @@ void map_screen_layer_render_cb() {
     }
 }
 
+bool change_map(Handle<assets::Map> map) {
+    if (!map_loader::change_map(map))
+        return false;
+    // The sprites loaded may have changed along with the map
+    if (map_loader::is_lazy())
+        sprite_atlas.build();
+    return true;
+}
+
 KeyState get_key_state(InputKey key) {
     // TODO: Implement just_pressed and just_released
     return {glfwGetKey(window_manager::get_window(), static_cast<int>(key)) == GLFW_PRESS, false,
@@ -8,17 +8,24 @@
 #include <imgui_impl_opengl3.h>
 #include <sol/sol.hpp>
 
+#include "load_profiler.hpp"
+#include "pack.hpp"
 #include "serializer.hpp"
 #include "util/defs.hpp"
 #include "api/api.hpp"
 #include "assets/script.hpp"
 #include "game_data_manager.hpp"
+#include "map_loader.hpp"
 #include "window_manager.hpp"
 #include "default_api_impls.hpp"
 #include "global_tile_size.hpp"
 
+#include <chrono>
 #include <filesystem>
 #include <iostream>
+#include <iterator>
+#include <memory>
+#include <string_view>
 
 namespace fs = std::filesystem;
 using namespace arpiyi;
@@ -92,14 +99,7 @@ struct ProjectFileData {
     Handle<assets::Script> startup_script;
 };
 
-static ProjectFileData load_project_file(fs::path base_dir) {
-    std::ifstream f(base_dir / "project.json");
-    std::stringstream buffer;
-    buffer << f.rdbuf();
-
-    rapidjson::Document doc;
-    doc.Parse(buffer.str().data());
-
+static ProjectFileData load_project_file(rapidjson::Document const& doc) {
     ProjectFileData file_data;
 
     using namespace ::detail::project_file_definitions;
@@ -118,26 +118,77 @@ static ProjectFileData load_project_file(fs::path base_dir) {
 }
 
 static bool show_state_inspector = false;
+static bool show_render_stats = false;
+
+static void draw_render_stats(float frame_time_ms, bool* p_open) {
+    ImGui::SetNextWindowBgAlpha(0.6f);
+    if (ImGui::Begin("Render Stats", p_open, ImGuiWindowFlags_AlwaysAutoResize)) {
+        const auto& batch_stats = default_api_impls::get_sprite_batch_stats();
+        ImGui::Text("Frame time: %.2f ms (%.0f FPS)", frame_time_ms,
+                    frame_time_ms > 0 ? 1000.f / frame_time_ms : 0.f);
+        ImGui::Text("Entity sprites: %llu", static_cast<unsigned long long>(batch_stats.sprites));
+        ImGui::Text("Entity draw calls: %llu",
+                    static_cast<unsigned long long>(batch_stats.draw_calls));
+        ImGui::Text("Entity batch submit time: %.3f ms", batch_stats.submit_time_ms);
+        ImGui::Text("Sprite atlases: %zu", default_api_impls::get_sprite_atlas_count());
+    }
+    ImGui::End();
+}
 
 static void key_callback(GLFWwindow* window, int key, int scancode, int action, int mods) {
     if (mods & GLFW_MOD_CONTROL && key == GLFW_KEY_K && action & GLFW_PRESS) {
         show_state_inspector = !show_state_inspector;
     }
+    if (mods & GLFW_MOD_CONTROL && key == GLFW_KEY_P && action & GLFW_PRESS) {
+        show_render_stats = !show_render_stats;
+    }
+    if (mods & GLFW_MOD_CONTROL && key == GLFW_KEY_L && action & GLFW_PRESS) {
+        using RenderMode = assets::Map::Layer::RenderMode;
+        constexpr const char* mode_names[] = {"tile meshes", "instanced tiles",
+                                              "tile ID textures"};
+        static_assert(std::size(mode_names) == static_cast<std::size_t>(RenderMode::count));
+        const auto mode = static_cast<RenderMode>(
+            (static_cast<int>(default_api_impls::get_layer_render_mode()) + 1) %
+            static_cast<int>(RenderMode::count));
+        default_api_impls::set_layer_render_mode(mode);
+        std::cout << "Map layers now rendered with " << mode_names[static_cast<int>(mode)]
+                  << std::endl;
+    }
     ImGui_ImplGlfw_KeyCallback(window, key, scancode, action, mods);
 }
 
 int main(int argc, const char* argv[]) {
-    if (argc != 2) {
-        std::cerr << "No arguments given. You must supply a valid arpiyi project path to load."
+    // Usage: arpiyi-player [--lazy] [--profile-load] [--exit-after-load]
+    //                      <project folder or pack file>
+    // --exit-after-load quits right after printing the load time, for comparing load times of
+    // different project formats (See scripts/compare_load_times.sh).
+    bool lazy = false;
+    bool profile_load = false;
+    bool exit_after_load = false;
+    const char* path_arg = nullptr;
+    for (int i = 1; i < argc; ++i) {
+        if (std::string_view(argv[i]) == "--lazy")
+            lazy = true;
+        else if (std::string_view(argv[i]) == "--profile-load")
+            profile_load = true;
+        else if (std::string_view(argv[i]) == "--exit-after-load")
+            exit_after_load = true;
+        else
+            path_arg = argv[i];
+    }
+    if (!path_arg) {
+        std::cerr << "No arguments given. You must supply a valid arpiyi project path or pack file "
+                     "to load."
                   << std::endl;
         return -1;
     }
-    fs::path project_path = fs::absolute(argv[1]);
+    fs::path project_path = fs::absolute(path_arg);
     std::cout << project_path.generic_string() << std::endl;
-    if (!fs::is_directory(project_path)) {
-        std::cerr
-            << "Path given is not a folder. You must supply a valid arpiyi project path to load."
-            << std::endl;
+    const bool is_pack = fs::is_regular_file(project_path);
+    if (!is_pack && !fs::is_directory(project_path)) {
+        std::cerr << "Path given is not a folder nor a file. You must supply a valid arpiyi "
+                     "project path or pack file to load."
+                  << std::endl;
         return -1;
     }
 
@@ -149,11 +200,64 @@ int main(int argc, const char* argv[]) {
                   << (progress * 100) << "%)" << std::endl;
     };
 
-    ProjectFileData project_data = load_project_file(project_path);
-    global_tile_size::set(project_data.tile_size);
-    for (std::size_t i = 0; i < serializer::serializable_assets; ++i)
-        serializer::load_one_asset_type(i, project_path, callback);
-    std::cout << "Finished loading." << std::endl;
+    const auto load_start = std::chrono::steady_clock::now();
+    if (profile_load)
+        load_profiler::begin_session();
+    ProjectFileData project_data;
+    if (lazy) {
+        // Only read the asset index for now; Assets are loaded along with the maps that use them
+        auto source = std::make_unique<serializer::AssetSource>(project_path);
+        if (!source->is_open()) {
+            std::cerr << "Could not open project." << std::endl;
+            return -1;
+        }
+        project_data = load_project_file(source->read_project_file());
+        global_tile_size::set(project_data.tile_size);
+        map_loader::init(std::move(source));
+        map_loader::keep_loaded(project_data.startup_script);
+    } else if (is_pack) {
+        // The pack is only needed while loading; textures are uploaded straight from the mapping.
+        pack::PackFile pack(project_path);
+        auto const* project_entry = pack.is_open() ?
+            pack.find(pack::project_file_type_name, 0) : nullptr;
+        if (!project_entry) {
+            std::cerr << "Could not open pack file." << std::endl;
+            return -1;
+        }
+        project_data = load_project_file(assets::parse_json_data(pack.get_data(*project_entry)));
+        global_tile_size::set(project_data.tile_size);
+        serializer::load_all_packed_parallel(pack, callback);
+    } else {
+        project_data = load_project_file(assets::parse_json_file(project_path / "project.json"));
+        global_tile_size::set(project_data.tile_size);
+        serializer::load_all_parallel(project_path, callback);
+    }
+    // debug: set current map to 0
+    if (!map_loader::change_map(Handle<assets::Map>((u64)0))) {
+        std::cerr << "Could not load map 0. Exiting." << std::endl;
+        return -1;
+    }
+    if (profile_load) {
+        // Layer meshes would be generated on the first frame otherwise
+        auto& map = game_data_manager::get_game_data().current_map;
+        load_profiler::AssetScope profile(assets::AssetDirName<assets::Map>::value, map.get_id());
+        for (auto& layer : map.get()->layers) layer.get()->update_mesh();
+    }
+    std::cout << "Finished loading in "
+              << std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() -
+                                                          load_start)
+                     .count()
+              << "ms." << std::endl;
+    if (profile_load) {
+        load_profiler::end_session();
+        load_profiler::print_summary(std::cout);
+        load_profiler::write_json_report("load_profile.json");
+        std::cout << "Load profile written to load_profile.json" << std::endl;
+    }
+    if (exit_after_load) {
+        glfwTerminate();
+        return 0;
+    }
 
     default_api_impls::init();
     arpiyi::api::define_api(game_data_manager::get_game_data(), lua);
@@ -175,13 +279,14 @@ int main(int argc, const char* argv[]) {
         return -1;
     }
 
-    // debug: set current map to 0
-    game_data_manager::get_game_data().current_map = Handle<assets::Map>((u64)0);
-
-    assert(game_data_manager::get_game_data().current_map.get());
-
     glfwSetKeyCallback(window_manager::get_window(), key_callback);
+    float last_frame_time_ms = 0;
+    auto last_frame_start = std::chrono::steady_clock::now();
     while (!glfwWindowShouldClose(window_manager::get_window())) {
+        const auto frame_start = std::chrono::steady_clock::now();
+        last_frame_time_ms =
+            std::chrono::duration<float, std::milli>(frame_start - last_frame_start).count();
+        last_frame_start = frame_start;
         glfwPollEvents();
 
         // Start the ImGui frame
@@ -228,7 +333,7 @@ int main(int argc, const char* argv[]) {
                 assert(auto_obj.parent_entity.get());
                 sol::function f = main_coroutine_thread.state().load(a_s->source);
                 sol::environment script_env(main_coroutine_thread.state(), sol::create, lua.globals());
-                script_env["entity"] = auto_obj.parent_entity;
+                script_env["entity"] = api::LuaHandle<assets::Entity>(auto_obj.parent_entity);
                 main_coroutine = f;
                 script_env.set_on(main_coroutine);
             } else {
@@ -244,6 +349,8 @@ int main(int argc, const char* argv[]) {
 
         if (show_state_inspector)
             DrawLuaStateInspector(lua.lua_state(), &show_state_inspector);
+        if (show_render_stats)
+            draw_render_stats(last_frame_time_ms, &show_render_stats);
 
         ImGui::Render();
         ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
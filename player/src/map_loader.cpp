@@ -0,0 +1,112 @@
+#include "map_loader.hpp"
+
+#include "assets/entity.hpp"
+#include "assets/sprite.hpp"
+#include "assets/texture.hpp"
+#include "assets/tileset.hpp"
+#include "game_data_manager.hpp"
+
+#include <tuple>
+#include <type_traits>
+#include <unordered_set>
+
+namespace arpiyi::map_loader {
+
+namespace {
+
+template<typename AssetT> struct IdSet {
+    std::unordered_set<u64> ids;
+};
+
+/// IDs of the assets a map needs loaded, by type.
+using Closure = std::tuple<IdSet<assets::Map>,
+                           IdSet<assets::Entity>,
+                           IdSet<assets::Sprite>,
+                           IdSet<assets::Script>,
+                           IdSet<assets::Tileset>,
+                           IdSet<assets::Texture>>;
+
+std::unique_ptr<serializer::AssetSource> source;
+/// Assets used by the current map.
+Closure current_closure;
+/// Assets that are never unloaded.
+Closure pinned_closure;
+
+/// Adds an asset to a closure, loading it if it isn't loaded yet.
+template<typename AssetT> Expected<AssetT> require(Closure& closure, Handle<AssetT> handle) {
+    if (handle.get_id() == Handle<AssetT>::noid)
+        return nullptr;
+    std::get<IdSet<AssetT>>(closure).ids.insert(handle.get_id());
+    return source->load<AssetT>(handle.get_id()).get();
+}
+
+/// Unloads the assets of the old closure that are in neither the new one nor the pinned one.
+template<typename AssetT> void unload_unused(Closure const& old_closure, Closure const& new_closure) {
+    auto const& new_ids = std::get<IdSet<AssetT>>(new_closure).ids;
+    auto const& pinned_ids = std::get<IdSet<AssetT>>(pinned_closure).ids;
+    for (const u64 id : std::get<IdSet<AssetT>>(old_closure).ids) {
+        if (new_ids.count(id) || pinned_ids.count(id))
+            continue;
+        Handle<AssetT> handle(id);
+        if constexpr (std::is_same_v<AssetT, assets::Tileset>) {
+            // Unloading a tileset also unloads its texture, but textures may be shared with other
+            // tilesets or sprites; Those are unloaded on their own below if they are unused
+            if (auto tileset = handle.get())
+                tileset->texture = nullptr;
+        }
+        handle.unload();
+    }
+}
+
+} // namespace
+
+void init(std::unique_ptr<serializer::AssetSource> _source) { source = std::move(_source); }
+bool is_lazy() { return source != nullptr; }
+
+void keep_loaded(Handle<assets::Script> script) {
+    if (!is_lazy())
+        return;
+    require(pinned_closure, script);
+}
+
+bool change_map(Handle<assets::Map> map_handle) {
+    if (!is_lazy()) {
+        if (!map_handle.get())
+            return false;
+        game_data_manager::get_game_data().current_map = map_handle;
+        return true;
+    }
+
+    // Load everything the new map needs before unloading anything, so that assets shared with
+    // the previous map are kept loaded instead of being reloaded.
+    Closure closure;
+    auto map = require(closure, map_handle);
+    if (!map)
+        return false;
+    for (auto& layer : map->layers) {
+        assert(layer.get());
+        if (auto tileset = require(closure, layer.get()->tileset))
+            require(closure, tileset->texture);
+    }
+    for (auto const& entity_handle : map->entities) {
+        if (auto entity = require(closure, entity_handle)) {
+            if (auto sprite = require(closure, entity->sprite))
+                require(closure, sprite->texture);
+            for (auto const& script : entity->scripts) require(closure, script);
+        }
+    }
+
+    // Maps go first since they own their layers, and textures last since tilesets refer to them
+    unload_unused<assets::Map>(current_closure, closure);
+    unload_unused<assets::Entity>(current_closure, closure);
+    unload_unused<assets::Sprite>(current_closure, closure);
+    unload_unused<assets::Script>(current_closure, closure);
+    unload_unused<assets::Tileset>(current_closure, closure);
+    unload_unused<assets::Texture>(current_closure, closure);
+    current_closure = std::move(closure);
+
+    game_data_manager::get_game_data().current_map = map_handle;
+    return true;
+}
+
+} // namespace arpiyi::map_loader
@@ -0,0 +1,56 @@
+#!/usr/bin/env bash
+# Compares how long the player takes to load a project from its folder and from a pack made out of
+# it, both with cold and warm file caches.
+# Usage: scripts/compare_load_times.sh <build folder> <project folder> [runs]
+# Caches can only be dropped on Linux when running as root. Otherwise, the cold numbers are those
+# of the first run of each format, which may be warm too if the files were read recently.
+set -euo pipefail
+
+if [ $# -lt 2 ]; then
+    echo "Usage: $0 <build folder> <project folder> [runs]" >&2
+    exit 1
+fi
+
+bin_dir="$1/editor"
+project="$2"
+runs="${3:-5}"
+pack_file="$(mktemp -t arpiyi-XXXXXX.pack)"
+trap 'rm -f "$pack_file"' EXIT
+
+"$bin_dir/arpiyi-pack" "$project" "$pack_file" > /dev/null
+
+drop_caches() {
+    sync
+    if [ -w /proc/sys/vm/drop_caches ]; then
+        echo 3 > /proc/sys/vm/drop_caches
+        return 0
+    fi
+    return 1
+}
+
+# Prints the load time reported by the player, in milliseconds.
+load_time() {
+    "$bin_dir/arpiyi-player" --exit-after-load "$1" |
+        sed -n 's/^Finished loading in \(.*\)ms\.$/\1/p'
+}
+
+# Prints the average of the numbers given.
+average() {
+    printf '%s\n' "$@" | awk '{ sum += $1 } END { printf "%.1f", sum / NR }'
+}
+
+cold_note=""
+drop_caches || cold_note=" (Could not drop caches; first run)"
+
+printf '%-8s %14s %14s\n' "Format" "Cold (ms)" "Warm (ms)"
+for format in folder pack; do
+    if [ "$format" = folder ]; then path="$project"; else path="$pack_file"; fi
+
+    drop_caches || true
+    cold="$(load_time "$path")"
+    warm=()
+    for ((i = 0; i < runs; i++)); do warm+=("$(load_time "$path")"); done
+    printf '%-8s %14s %14s\n' "$format" "$cold" "$(average "${warm[@]}")"
+done
+[ -z "$cold_note" ] || echo "Cold times$cold_note."
+echo "Warm times are the average of $runs runs."
@@ -67,8 +67,40 @@ struct GamePlayData {
     std::vector<std::shared_ptr<ScreenLayer>> screen_layers;
 };
 
+/// Handle to an asset for Lua scripts. Looking up the asset of a Handle on every field access
+/// adds up in scripts that access many assets per frame, so the pointer to the asset is kept and
+/// only looked up again once assets have been added to or removed from its container. Assets are
+/// never moved in memory while they are in their container, so the pointer stays valid until then.
+template<typename AssetT> class LuaHandle {
+public:
+    LuaHandle(Handle<AssetT> handle) noexcept : handle(handle) {}
+
+    [[nodiscard]] AssetT* get() const noexcept {
+        auto& container = detail::AssetContainer<AssetT>::get_instance();
+        if (cached_epoch != container.membership_epoch) {
+            cached_asset = container.storage.find(handle.get_id());
+            cached_epoch = container.membership_epoch;
+        }
+        return cached_asset;
+    }
+
+    [[nodiscard]] Handle<AssetT> get_handle() const noexcept { return handle; }
+
+private:
+    Handle<AssetT> handle;
+    mutable AssetT* cached_asset = nullptr;
+    /// Membership epoch of the container when cached_asset was looked up.
+    mutable u64 cached_epoch = static_cast<u64>(-1);
+};
+
 void define_api(GamePlayData& data, sol::state_view& s);
 
+/// Registers the usertype of an asset struct in the given table. Generated for every struct marked
+/// with [[lua::expose]] (See api/lua_bindings_cg.hpp), binding all of its public data members
+/// except the ones marked with [[lua::hidden]]. Members marked with [[lua::readonly]] can't be
+/// assigned from Lua.
+template<typename T> sol::usertype<T> define_usertype(sol::table& table);
+
 // Implementation-defined functions
 
 /// The render callback of the screen layer added when the GamePlayData::add_default_map_layer
@@ -78,6 +110,10 @@ extern void map_screen_layer_render_cb();
 /// The implementation for the input.get_key_state function.
 extern KeyState get_key_state(InputKey key);
 
+/// The implementation for the game.change_map function. Makes the given map the current one.
+/// @returns False if there is no map with that ID.
+extern bool change_map(Handle<assets::Map> map);
+
 } // namespace arpiyi::api
 
 namespace sol {
@@ -92,6 +128,15 @@ template<typename T> struct unique_usertype_traits<arpiyi::Handle<T>> {
         return val ? const_cast<type*>(&*val) : nullptr;
     }
 };
+
+template<typename T> struct unique_usertype_traits<arpiyi::api::LuaHandle<T>> {
+    typedef T type;
+    typedef arpiyi::api::LuaHandle<T> actual_type;
+    static const bool value = true;
+
+    static bool is_null(const actual_type& ptr) { return !ptr.get(); }
+    static type* get(const actual_type& ptr) { return ptr.get(); }
+};
 } // namespace sol
 
 #endif // ARPIYI_API_HPP
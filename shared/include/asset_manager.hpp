@@ -4,18 +4,227 @@
 #include "assets/asset.hpp"
 
 #include "util/intdef.hpp"
+#include <algorithm>
+#include <atomic>
 #include <cassert>
 #include <cmath>
+#include <deque>
 #include <fstream>
-#include <unordered_map>
+#include <optional>
+#include <vector>
 
 namespace arpiyi {
 
 namespace detail {
 
+/// Generational slot map used as the backing storage of asset containers.
+/// IDs given out by it store a slot index in their lower 32 bits and the generation of that slot
+/// in their upper 32 bits, so looking an asset up is just a bounds check and a generation compare.
+/// Erased slots are reused with a bumped generation, which means stale IDs never alias newer
+/// assets. Assets are constructed in place and never move while alive (Expected<T> hands out raw
+/// pointers), and a dense list of live slots is kept aside for iteration.
+template<typename T> class SlotMap {
+public:
+    struct Entry {
+        u64 id;
+        T asset;
+    };
+
+private:
+    struct Slot {
+        u32 generation = 0;
+        /// Position of this slot in the live slot list. Only meaningful if entry is not null.
+        u32 live_index = 0;
+        /// Points into the entry pool while the slot is alive.
+        Entry* entry = nullptr;
+        /// Value of the modification epoch the last time the asset on this slot was changed. Kept
+        /// here instead of in Entry so that entries still decompose into [id, asset].
+        u64 modification_epoch = 0;
+    };
+
+    template<typename SlotsT, typename EntryT> class Iterator {
+    public:
+        Iterator(SlotsT* slots, std::vector<u32>::const_iterator it) : slots(slots), it(it) {}
+
+        EntryT& operator*() const { return *(*slots)[*it].entry; }
+        EntryT* operator->() const { return &operator*(); }
+        Iterator& operator++() {
+            ++it;
+            return *this;
+        }
+        bool operator==(Iterator const& other) const { return it == other.it; }
+        bool operator!=(Iterator const& other) const { return it != other.it; }
+
+    private:
+        SlotsT* slots;
+        std::vector<u32>::const_iterator it;
+    };
+
+public:
+    SlotMap() = default;
+    // Slots point into the pool of their own map
+    SlotMap(SlotMap const&) = delete;
+    SlotMap& operator=(SlotMap const&) = delete;
+
+    using iterator = Iterator<std::vector<Slot>, Entry>;
+    using const_iterator = Iterator<const std::vector<Slot>, const Entry>;
+
+    static constexpr u64 make_id(u32 index, u32 generation) noexcept {
+        return (static_cast<u64>(generation) << 32) | index;
+    }
+    static constexpr u32 index_of(u64 id) noexcept { return static_cast<u32>(id); }
+    static constexpr u32 generation_of(u64 id) noexcept { return static_cast<u32>(id >> 32); }
+
+    Entry* find_entry(u64 id) noexcept {
+        const u32 index = index_of(id);
+        if (index >= slots.size())
+            return nullptr;
+        Slot& slot = slots[index];
+        if (!slot.entry || slot.generation != generation_of(id))
+            return nullptr;
+        return slot.entry;
+    }
+    const Entry* find_entry(u64 id) const noexcept {
+        return const_cast<SlotMap*>(this)->find_entry(id);
+    }
+    T* find(u64 id) noexcept {
+        Entry* entry = find_entry(id);
+        return entry ? &entry->asset : nullptr;
+    }
+    const T* find(u64 id) const noexcept { return const_cast<SlotMap*>(this)->find(id); }
+
+    /// @returns The modification epoch set for the asset with the given ID, or 0 if there is none.
+    [[nodiscard]] u64 get_modification_epoch(u64 id) const noexcept {
+        return find_entry(id) ? slots[index_of(id)].modification_epoch : 0;
+    }
+    /// Records that the asset with the given ID was changed at the given modification epoch. Does
+    /// nothing if there is no such asset.
+    void set_modification_epoch(u64 id, u64 epoch) noexcept {
+        if (find_entry(id))
+            slots[index_of(id)].modification_epoch = epoch;
+    }
+
+    /// @returns The ID that the next call to emplace(T) will give to its asset.
+    [[nodiscard]] u64 next_id() const noexcept {
+        for (auto it = free_slots.rbegin(); it != free_slots.rend(); ++it) {
+            if (!slots[*it].entry)
+                return make_id(*it, slots[*it].generation);
+        }
+        return make_id(static_cast<u32>(slots.size()), 0);
+    }
+
+    /// Places an asset on a free slot, reusing erased ones before growing.
+    Entry& emplace(T&& asset) {
+        // The free list is cleaned lazily: emplace_at() may have taken some of its slots.
+        while (!free_slots.empty() && slots[free_slots.back()].entry) free_slots.pop_back();
+        if (free_slots.empty()) {
+            const u32 index = static_cast<u32>(slots.size());
+            slots.emplace_back();
+            pool.emplace_back();
+            return place(index, std::move(asset));
+        }
+
+        const u32 index = free_slots.back();
+        free_slots.pop_back();
+        return place(index, std::move(asset));
+    }
+
+    /// Highest slot index + 1 that emplace_at() will grow the map to. Every slot up to the index of
+    /// the ID is allocated, so this keeps corrupt IDs from taking up all memory.
+    static constexpr u32 max_emplace_slot_count = 1u << 20;
+
+    /// @returns Why emplace_at() can't place an asset with the given ID, or null if it can.
+    [[nodiscard]] const char* get_emplace_error(u64 id) const noexcept {
+        const u32 index = index_of(id);
+        if (index >= slots.size())
+            return index >= max_emplace_slot_count ? "its index is too large" : nullptr;
+        Slot const& slot = slots[index];
+        if (slot.entry && slot.entry->id != id)
+            return "its slot is being used by another asset";
+        if (!slot.entry && generation_of(id) < slot.generation)
+            return "it is stale";
+        return nullptr;
+    }
+
+    /// Places an asset so it can be found by the given ID. Used for IDs that come from serialized
+    /// data. If there already is an asset with that ID, that one is kept and returned instead.
+    /// @returns The entry of the asset, or null if the ID can't be used (See get_emplace_error()).
+    Entry* emplace_at(u64 id, T&& asset) {
+        if (get_emplace_error(id))
+            return nullptr;
+        const u32 index = index_of(id);
+        if (index >= slots.size()) {
+            // Gaps left behind are not offered to emplace(T): they may be referenced by IDs that
+            // haven't been loaded yet, or by ones that were deleted long ago.
+            slots.resize(static_cast<std::size_t>(index) + 1);
+            pool.resize(slots.size());
+        } else if (slots[index].entry) {
+            return slots[index].entry;
+        }
+
+        slots[index].generation = generation_of(id);
+        return &place(index, std::move(asset));
+    }
+
+    /// Destroys the asset with the given ID, if any. The slot it was on is left free for reuse.
+    bool erase(u64 id) {
+        if (!find(id))
+            return false;
+        const u32 index = index_of(id);
+        Slot& slot = slots[index];
+        pool[index].reset();
+        slot.entry = nullptr;
+        ++slot.generation;
+
+        // Swap & pop the live slot list
+        const u32 moved_index = live_slots.back();
+        live_slots[slot.live_index] = moved_index;
+        slots[moved_index].live_index = slot.live_index;
+        live_slots.pop_back();
+
+        free_slots.emplace_back(index);
+        return true;
+    }
+
+    [[nodiscard]] std::size_t size() const noexcept { return live_slots.size(); }
+    [[nodiscard]] bool empty() const noexcept { return live_slots.empty(); }
+
+    iterator begin() { return {&slots, live_slots.cbegin()}; }
+    iterator end() { return {&slots, live_slots.cend()}; }
+    const_iterator begin() const { return {&slots, live_slots.cbegin()}; }
+    const_iterator end() const { return {&slots, live_slots.cend()}; }
+
+private:
+    Entry& place(u32 index, T&& asset) {
+        Slot& slot = slots[index];
+        slot.live_index = static_cast<u32>(live_slots.size());
+        live_slots.emplace_back(index);
+        slot.entry = &pool[index].emplace(Entry{make_id(index, slot.generation), std::move(asset)});
+        return *slot.entry;
+    }
+
+    /// Kept small and contiguous so lookups touch as little memory as possible.
+    std::vector<Slot> slots;
+    /// Storage for the entries themselves, indexed like slots. std::deque never relocates its
+    /// elements when growing, unlike std::vector.
+    std::deque<std::optional<Entry>> pool;
+    std::vector<u32> live_slots;
+    std::vector<u32> free_slots;
+};
+
+/// Global counter bumped every time any asset is modified, added or removed. Comparing it against
+/// a value stored earlier tells whether something changed since then. Atomic so that it can be
+/// read and bumped from any thread, like the ones serializing assets.
+inline std::atomic<u64>& modification_epoch() {
+    static std::atomic<u64> epoch{0};
+    return epoch;
+}
+
 template<typename AssetT> struct AssetContainer {
-    std::unordered_map<std::size_t, AssetT> map;
-    u64 next_id_to_use;
+    SlotMap<AssetT> storage;
+    /// Value of the modification epoch the last time an asset was added to or removed from the
+    /// container.
+    u64 membership_epoch = 0;
 
     static AssetContainer& get_instance() {
         static AssetContainer<AssetT> instance;
@@ -62,21 +271,19 @@ public:
         if (id == noid)
             return nullptr;
         auto& container = detail::AssetContainer<AssetT>::get_instance();
-        auto asset_it = container.map.find(id);
-        if (asset_it == container.map.end())
-            return nullptr;
+        if (auto asset = container.storage.find(id))
+            return asset;
         else
-            return &asset_it->second;
+            return nullptr;
     }
     Expected<const AssetT> get() const noexcept {
         if (id == noid)
             return nullptr;
-        auto& container = detail::AssetContainer<AssetT>::get_instance();
-        auto asset_it = container.map.find(id);
-        if (asset_it == container.map.end())
-            return nullptr;
+        const auto& container = detail::AssetContainer<AssetT>::get_instance();
+        if (auto asset = container.storage.find(id))
+            return asset;
         else
-            return &asset_it->second;
+            return nullptr;
     }
 
     void save(fs::path path) const {
@@ -89,16 +296,24 @@ public:
         if (id == noid)
             return;
         auto& container = detail::AssetContainer<AssetT>::get_instance();
-        auto asset_it = container.map.find(id);
-        if (asset_it == container.map.end())
-            return;
-        else {
-            assets::raw_unload(asset_it->second);
-            container.map.erase(asset_it);
+        if (auto asset = container.storage.find(id)) {
+            assets::raw_unload(*asset);
+            container.storage.erase(id);
+            container.membership_epoch = ++detail::modification_epoch();
             id = noid;
         }
     }
 
+    /// Flags the asset as modified so it is written on the next project save. Must be called
+    /// after changing anything that gets serialized.
+    void mark_dirty() noexcept {
+        if (id == noid)
+            return;
+        auto& container = detail::AssetContainer<AssetT>::get_instance();
+        if (container.storage.find(id))
+            container.storage.set_modification_epoch(id, ++detail::modification_epoch());
+    }
+
     [[nodiscard]] bool operator==(Handle const& h) const noexcept { return id == h.id; }
 
     [[nodiscard]] u64 get_id() const noexcept { return id; }
@@ -107,41 +322,52 @@ private:
     u64 id;
 };
 
+namespace detail {
+
+/// Marks a newly placed asset and the membership of its container as modified.
+template<typename AssetT> Handle<AssetT> on_asset_placed(typename SlotMap<AssetT>::Entry& entry) {
+    auto& container = AssetContainer<AssetT>::get_instance();
+    container.membership_epoch = ++modification_epoch();
+    container.storage.set_modification_epoch(entry.id, container.membership_epoch);
+    return Handle<AssetT>(entry.id);
+}
+
+} // namespace detail
+
 } // namespace arpiyi
 
 namespace arpiyi::asset_manager {
 
 template<typename AssetT> Handle<AssetT> load(assets::LoadParams<AssetT> const& load_params) {
     auto& container = detail::AssetContainer<AssetT>::get_instance();
-    u64 id_to_use = container.next_id_to_use++;
-    AssetT& asset = container.map.emplace(id_to_use, AssetT{}).first->second;
-    assets::raw_load(asset, load_params);
-    return Handle<AssetT>(id_to_use);
+    auto& entry = container.storage.emplace(AssetT{});
+    assets::raw_load(entry.asset, load_params);
+    return detail::on_asset_placed<AssetT>(entry);
 }
 
+/// @returns A null handle if the ID can't be used (See SlotMap::get_emplace_error()).
 template<typename AssetT>
 Handle<AssetT> load(assets::LoadParams<AssetT> const& load_params, u64 id_to_use) {
     auto& container = detail::AssetContainer<AssetT>::get_instance();
-    AssetT& asset = container.map.emplace(id_to_use, AssetT{}).first->second;
-    assets::raw_load(asset, load_params);
-    return Handle<AssetT>(id_to_use);
+    auto* entry = container.storage.emplace_at(id_to_use, AssetT{});
+    if (!entry)
+        return {};
+    assets::raw_load(entry->asset, load_params);
+    return detail::on_asset_placed<AssetT>(*entry);
 }
 
 template<typename AssetT> Handle<AssetT> put(AssetT const& asset) {
     auto& container = detail::AssetContainer<AssetT>::get_instance();
-    u64 id_to_use = container.next_id_to_use++;
-    container.map.emplace(id_to_use, std::move(asset));
-    return Handle<AssetT>(id_to_use);
+    return detail::on_asset_placed<AssetT>(container.storage.emplace(AssetT(asset)));
 }
 
-template<typename AssetT, bool update_next_id_to_use = true>
-Handle<AssetT> put(AssetT const& asset, u64 id_to_use) {
+/// @returns A null handle if the ID can't be used (See SlotMap::get_emplace_error()).
+template<typename AssetT> Handle<AssetT> put(AssetT const& asset, u64 id_to_use) {
     auto& container = detail::AssetContainer<AssetT>::get_instance();
-    if constexpr (update_next_id_to_use) {
-        container.next_id_to_use = std::max(id_to_use + 1, container.next_id_to_use);
-    }
-    container.map.emplace(id_to_use, std::move(asset));
-    return Handle<AssetT>(id_to_use);
+    auto* entry = container.storage.emplace_at(id_to_use, AssetT(asset));
+    if (!entry)
+        return {};
+    return detail::on_asset_placed<AssetT>(*entry);
 }
 
 } // namespace arpiyi::asset_manager
@@ -2,18 +2,76 @@
 #define ARPIYI_ASSET_HPP
 #include <sstream>
 #include <filesystem>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <utility>
 
 namespace fs = std::filesystem;
 
 namespace arpiyi::assets {
 template<typename T> struct LoadParams;
 
+namespace detail {
+template<typename T, typename = void> struct has_failed_flag : std::false_type {};
+template<typename T>
+struct has_failed_flag<T, std::void_t<decltype(std::declval<T const&>().failed)>>
+    : std::true_type {};
+} // namespace detail
+
 template<typename AssetT>
 void raw_load(AssetT&, LoadParams<AssetT> const& params);
 
 template<typename AssetT>
 void raw_unload(AssetT&);
 
+/// Result of the part of loading an asset that doesn't need to be done in the main thread, like
+/// reading and parsing its file. Preparing an asset must not make any GL calls nor touch any
+/// asset container, since it can be done from worker threads.
+/// By default nothing is prepared in advance, and the whole asset is loaded with raw_load() when
+/// finishing.
+template<typename AssetT> struct PreparedLoad {
+    LoadParams<AssetT> params;
+};
+
+template<typename AssetT>
+PreparedLoad<AssetT> raw_prepare_load(LoadParams<AssetT> const& params) {
+    return {params};
+}
+
+/// Finishes loading an asset from the data given by raw_prepare_load(). Always called from the
+/// main thread.
+template<typename AssetT>
+void raw_finish_load(AssetT& asset, PreparedLoad<AssetT>&& prepared) {
+    raw_load(asset, prepared.params);
+}
+
+/// Prepared load data of assets stored in the binary format generated for
+/// [[assets::binary_format]] structs (See binary_serializer.hpp): The whole file is read in
+/// advance and decoded when finishing.
+struct BinaryPreparedLoad {
+    std::string data;
+    /// Set by raw_finish_load if the data could not be loaded.
+    bool failed = false;
+};
+
+/// @returns Whether loading an asset failed, once its prepared load has been finished. Only
+/// prepared loads with a `failed` member (Like BinaryPreparedLoad) can fail; Assets that fail to
+/// load must not be placed in their container.
+template<typename PreparedT> bool load_failed(PreparedT const& prepared) {
+    if constexpr (detail::has_failed_flag<PreparedT>::value)
+        return prepared.failed;
+    else
+        return false;
+}
+
+/// Loads an asset using the binary format from a file without its header, written before the
+/// asset switched to it. Specialize it for assets that used to be stored in another format.
+/// @returns Whether the asset could be loaded. By default no data can.
+template<typename AssetT> bool raw_load_legacy(AssetT&, std::string_view /* data */) {
+    return false;
+}
+
 struct RawSaveData {
     std::stringstream bytestream;
 };
@@ -21,8 +79,46 @@ struct RawSaveData {
 template<typename AssetT>
 RawSaveData raw_get_save_data(AssetT const&);
 
+/// State of an asset captured at some point for saving it later, possibly from another thread
+/// while the asset keeps being edited. By default it is a plain copy of the asset, which is enough
+/// for assets whose save data doesn't depend on GL objects nor on other asset containers.
+template<typename AssetT> struct SaveSnapshot {
+    AssetT asset;
+};
+
+/// Captures the state of an asset for saving. Always called from the main thread.
+template<typename AssetT>
+SaveSnapshot<AssetT> raw_make_save_snapshot(AssetT const& asset) {
+    return {asset};
+}
+
+/// Completes the parts of a snapshot that couldn't be captured at once, like GPU readbacks.
+/// Returns true once the snapshot is complete. Always called from the main thread, once per frame
+/// until it returns true.
+template<typename AssetT>
+bool raw_poll_save_snapshot(SaveSnapshot<AssetT>&) {
+    return true;
+}
+
+/// Returns the save data of a complete snapshot. Can be called from any thread.
+template<typename AssetT>
+RawSaveData raw_get_snapshot_save_data(SaveSnapshot<AssetT> const& snapshot) {
+    return raw_get_save_data(snapshot.asset);
+}
+
 template<typename T> struct AssetDirName { /* constexpr static std::string_view value */ };
 
+/// Generated for every type in all_assets (See asset_cg.hpp) with:
+/// - constexpr static std::size_t index: Position of the type in all_assets.
+/// - constexpr static bool serialize: Whether the type is marked with [[assets::serialize]].
+/// - constexpr static u64 load_dependency_mask: Bit i is set if the type must be loaded after the
+///   i-th type of all_assets ([[assets::load_before]]).
+/// - constexpr static std::size_t load_level: Dependency level of the type. Types only depend on
+///   types of previous levels.
+/// all_assets lists the serializable types in load order, so iterating it in order respects
+/// load dependencies.
+template<typename T> struct AssetInfo;
+
 }
 
 #include "assets/asset_cg.hpp" // codegen
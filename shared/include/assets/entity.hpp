@@ -3,6 +3,7 @@
 
 #include "asset.hpp"
 #include "asset_manager.hpp"
+#include "json_asset.hpp"
 #include "script.hpp"
 #include "sprite.hpp"
 
@@ -17,12 +18,12 @@ namespace aml = anton::math;
 
 namespace arpiyi::assets {
 
-struct [[assets::serialize]] [[assets::load_before(Script)]] [[meta::dir_name("entities")]] Entity {
+struct [[assets::serialize]] [[assets::load_before(Script)]] [[lua::expose]] [[meta::dir_name("entities")]] Entity {
     std::string name;
     Handle<Sprite> sprite;
     /// Position of this entity (measured in tiles).
     aml::Vector2 pos;
-    std::vector<Handle<assets::Script>> scripts;
+    [[lua::hidden]] std::vector<Handle<assets::Script>> scripts;
 
     [[nodiscard]] aml::Vector2 get_left_corner_pos() const {
         if (auto s = sprite.get()) {
@@ -43,6 +44,10 @@ template<> struct LoadParams<Entity> { fs::path path; };
 
 template<> RawSaveData raw_get_save_data<Entity>(Entity const&);
 template<> void raw_load<Entity>(Entity&, LoadParams<Entity> const& params);
+template<> struct PreparedLoad<Entity> : JsonPreparedLoad {};
+template<> PreparedLoad<Entity> raw_prepare_load<Entity>(LoadParams<Entity> const& params);
+template<> void raw_finish_load<Entity>(Entity&, PreparedLoad<Entity>&& prepared);
+template<> inline void raw_unload<Entity>(Entity&) {}
 
 } // namespace arpiyi_editor::assets
 
@@ -0,0 +1,43 @@
+#ifndef ARPIYI_JSON_ASSET_HPP
+#define ARPIYI_JSON_ASSET_HPP
+
+#include "asset.hpp"
+#include "load_profiler.hpp"
+
+#include <cstdio>
+#include <rapidjson/document.h>
+#include <rapidjson/filereadstream.h>
+#include <string_view>
+
+namespace arpiyi::assets {
+
+/// Prepared load data of assets stored as a single JSON document: The whole document is read and
+/// parsed in advance.
+struct JsonPreparedLoad {
+    rapidjson::Document doc;
+};
+
+/// Parses a JSON file, reading it in small blocks instead of copying all of it into memory first.
+inline rapidjson::Document parse_json_file(fs::path const& path) {
+    load_profiler::StageTimer profile(load_profiler::Stage::parse);
+    rapidjson::Document doc;
+    std::FILE* file = std::fopen(path.generic_string().c_str(), "rb");
+    if (!file)
+        return doc;
+    char buffer[64 * 1024];
+    rapidjson::FileReadStream stream(file, buffer, sizeof(buffer));
+    doc.ParseStream(stream);
+    std::fclose(file);
+    return doc;
+}
+
+inline rapidjson::Document parse_json_data(std::string_view data) {
+    load_profiler::StageTimer profile(load_profiler::Stage::parse);
+    rapidjson::Document doc;
+    doc.Parse(data.data(), data.size());
+    return doc;
+}
+
+} // namespace arpiyi::assets
+
+#endif // ARPIYI_JSON_ASSET_HPP
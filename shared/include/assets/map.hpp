@@ -2,7 +2,10 @@
 #define ARPIYI_MAP_HPP
 
 #include <cstdint>
+#include <memory>
+#include <optional>
 #include <string>
+#include <string_view>
 #include <unordered_map>
 #include <vector>
 
@@ -24,12 +27,40 @@ struct [[assets::serialize]] [[assets::load_before(Tileset)]] [[assets::load_bef
 
     class Layer {
     public:
+        enum class RenderMode {
+            /// Draw a mesh with a quad for each tile. See draw_chunks().
+            mesh,
+            /// Draw an instance of a shared unit quad for each tile, with only the tile position
+            /// and ID as per-instance data. See draw_instanced_chunks().
+            instanced,
+            /// Draw a single quad that looks up tile IDs in an integer texture. See
+            /// update_tile_texture().
+            tile_texture,
+            count
+        };
+
+        /// Size in tiles of the side of each of the square chunks the layer mesh is split into.
+        static constexpr i64 chunk_size = 32;
+
         Layer() = delete;
         Layer(i64 width, i64 height, Handle<assets::Tileset> tileset);
 
         [[nodiscard]] Tile get_tile(math::IVec2D pos) const {
             assert(is_pos_valid(pos));
-            return tiles[pos.x + pos.y * width];
+            return (*tiles)[pos.x + pos.y * width];
+        }
+
+        /// All the tiles of the layer, in row-major order.
+        [[nodiscard]] std::vector<Tile> const& get_tiles() const { return *tiles; }
+        /// Returns a reference to the current tile data that stays unchanged while the layer is
+        /// edited; Used for saving the layer from another thread without copying all its tiles.
+        [[nodiscard]] std::shared_ptr<const std::vector<Tile>> share_tiles() const {
+            return tiles;
+        }
+
+        /// Size of the layer in tiles.
+        [[nodiscard]] math::IVec2D get_size() const {
+            return {static_cast<i32>(width), static_cast<i32>(height)};
         }
 
         [[nodiscard]] bool is_pos_valid(math::IVec2D pos) const {
@@ -37,24 +68,88 @@ struct [[assets::serialize]] [[assets::load_before(Tileset)]] [[assets::load_bef
         }
 
         void set_tile(math::IVec2D pos, Tile new_val) {
-            tiles[pos.x + pos.y * width] = new_val;
-            regenerate_mesh();
+            get_writable_tiles()[pos.x + pos.y * width] = new_val;
+            const u64 quad = get_quad_index(pos.x, pos.y);
+            mark_dirty(quad, quad + 1);
+            mark_texture_dirty({pos, {pos.x + 1, pos.y + 1}});
         }
 
+        /// Sets all the tiles inside the given rect at once, marking them dirty row by row instead
+        /// of tile by tile. The rect is clipped to the layer bounds.
+        /// @param data Tiles to place, in row-major order. Must contain exactly
+        /// rect.width() * rect.height() tiles.
+        void set_tiles(math::IRect2D rect, std::vector<Tile> const& data);
+
         /// TODO: Layer should not have mesh in it, this should be external
         [[nodiscard]] Handle<assets::Mesh> get_mesh() const { return mesh; }
+        /// Uploads the tiles changed since the last call to the layer mesh. Call before drawing.
+        /// The whole mesh is only regenerated if it doesn't exist yet or the tileset has changed.
+        void update_mesh();
         void regenerate_mesh();
+        /// Updates the layer mesh and draws the chunks of it that intersect the given rect of
+        /// tiles. The shader, texture and uniforms to use must be bound beforehand.
+        void draw_chunks(math::IRect2D tile_view);
+
+        /// Uploads the tiles changed since the last call to the instance buffer, creating it if
+        /// it doesn't exist yet.
+        void update_instances();
+        /// Updates the instance buffer and draws the chunks that intersect the given rect of
+        /// tiles, instancing a unit quad per tile. Positions are given in tiles, so the model
+        /// matrix must scale from tiles instead of from the whole map. The shader, texture and
+        /// uniforms to use must be bound beforehand.
+        void draw_instanced_chunks(math::IRect2D tile_view);
+
+        /// Uploads the tiles changed since the last call to the tile ID texture, creating it if it
+        /// doesn't exist yet. Call before drawing with the tile texture render mode.
+        void update_tile_texture();
+        /// Returns the GL_R32UI texture containing the ID of each tile of the layer, one texel
+        /// per tile.
+        [[nodiscard]] unsigned int get_tile_texture() const { return tile_texture; }
+
+        /// Frees the meshes and texture used for rendering this layer.
+        void unload_render_data();
 
         Handle<assets::Tileset> tileset;
         std::string name;
         bool visible = true;
 
     private:
+        /// Range of quad (or instance) indices [begin, end).
+        struct QuadRange {
+            u64 begin;
+            u64 end;
+        };
+
+        /// Quads are stored chunk by chunk, and row by row inside each chunk, so that every chunk
+        /// is a contiguous range of the mesh buffer.
+        [[nodiscard]] u64 get_quad_index(i64 x, i64 y) const;
+        [[nodiscard]] math::IVec2D get_quad_tile_pos(u64 quad) const;
+        /// Returns the quad ranges to draw for the chunks intersecting the given rect of tiles.
+        [[nodiscard]] std::vector<QuadRange> get_visible_quad_ranges(math::IRect2D tile_view) const;
+        /// Sorts the given ranges and merges the ones that overlap or are close to each other.
+        static void coalesce_ranges(std::vector<QuadRange>& ranges);
+        static void push_dirty_range(std::vector<QuadRange>& ranges, u64 begin, u64 end);
+        void mark_dirty(u64 begin, u64 end);
+        void mark_texture_dirty(math::IRect2D rect);
+        void generate_tile_quad(float* quad, i64 x, i64 y, Tileset const& tl) const;
+        /// Returns the tile vector to modify, copying it first if it is shared with a snapshot.
+        std::vector<Tile>& get_writable_tiles();
         assets::Mesh generate_layer_split_quad();
 
         i64 width = 0, height = 0;
-        std::vector<Tile> tiles;
+        /// Copy-on-write: Shared with the save snapshots taken while it was unchanged.
+        std::shared_ptr<std::vector<Tile>> tiles;
         Handle<assets::Mesh> mesh;
+        /// Tileset used for generating the current mesh UVs.
+        Handle<assets::Tileset> mesh_tileset;
+        std::vector<QuadRange> dirty_ranges;
+        /// Instances of the unit quad, one per tile, in the same order as the mesh quads.
+        Handle<assets::Mesh> instance_mesh;
+        std::vector<QuadRange> instance_dirty_ranges;
+        static constexpr unsigned int notexture = static_cast<unsigned int>(-1);
+        unsigned int tile_texture = notexture;
+        /// Rect of tiles that need to be reuploaded to the tile texture. Empty if none.
+        math::IRect2D texture_dirty_rect{{0, 0}, {0, 0}};
     };
 
     struct Comment {
@@ -70,13 +165,73 @@ struct [[assets::serialize]] [[assets::load_before(Tileset)]] [[assets::load_bef
     i64 width, height;
 };
 
-template<> inline void raw_unload<Map::Layer>(Map::Layer&) {}
+/// Re-derives the shape of every autotile inside the given rect from its current neighbours, all in
+/// a single pass and a single set_tiles call. Meant for updating many tiles at once, like after
+/// filling an area, loading a map or changing the tileset of a layer. Does nothing if the layer
+/// tileset isn't an autotile tileset.
+/// @param rect Tiles to update. Clipped to the layer bounds. Tiles outside of it are only read.
+/// @param only_x_index If given, only the autotiles of this type are updated.
+void recompute_autotiles(Map::Layer& layer,
+                         math::IRect2D rect,
+                         std::optional<u32> only_x_index = std::nullopt);
+
+template<> inline void raw_unload<Map::Layer>(Map::Layer& layer) { layer.unload_render_data(); }
 template<> inline void raw_unload<Map::Comment>(Map::Comment&) {}
+/// Layers and comments belong to their map, so they are unloaded along with it.
+template<> inline void raw_unload<Map>(Map& map) {
+    for (auto& layer : map.layers) layer.unload();
+    for (auto& comment : map.comments) comment.unload();
+}
 
 template<> struct LoadParams<Map> { fs::path path; };
 
 template<> RawSaveData raw_get_save_data<Map>(Map const&);
+/// Layers and comments live in their own containers, so they are copied into the snapshot. Layer
+/// tiles are shared with the layer until it is modified instead of being copied.
+template<> struct SaveSnapshot<Map> {
+    struct LayerData {
+        std::string name;
+        u64 tileset_id;
+        std::shared_ptr<const std::vector<Map::Tile>> tiles;
+    };
+
+    std::string name;
+    i64 width, height;
+    std::vector<LayerData> layers;
+    std::vector<Map::Comment> comments;
+    std::vector<u64> entities;
+};
+template<> SaveSnapshot<Map> raw_make_save_snapshot<Map>(Map const&);
+template<> RawSaveData raw_get_snapshot_save_data<Map>(SaveSnapshot<Map> const&);
 template<> void raw_load<Map>(Map&, LoadParams<Map> const&);
+/// Contents of a map file. Layers and comments can only be placed in their containers once the map
+/// is finished in the main thread.
+template<> struct PreparedLoad<Map> {
+    struct LayerData {
+        std::string name;
+        u64 tileset_id = Handle<Tileset>::noid;
+        /// Row by row, like in the file.
+        std::vector<Map::Tile> tiles;
+        /// Encoding of the tile data. See map_file_definitions::TileDataFormat.
+        u32 data_format = 0;
+        /// Tile data as stored in the file, if it was not a plain array. Decoded into tiles after
+        /// parsing.
+        std::string encoded_data;
+    };
+
+    std::string name;
+    i64 width = -1, height = -1;
+    std::vector<LayerData> layers;
+    std::vector<Map::Comment> comments;
+    std::vector<u64> entities;
+    /// Set if the map file could not be opened or parsed. raw_finish_load leaves the map untouched
+    /// in that case, and the map is not placed in its container (See load_failed()).
+    bool failed = false;
+};
+template<> PreparedLoad<Map> raw_prepare_load<Map>(LoadParams<Map> const& params);
+template<> void raw_finish_load<Map>(Map&, PreparedLoad<Map>&& prepared);
+/// Same as raw_prepare_load<Map>, but parses a map file that is already in memory.
+PreparedLoad<Map> prepare_map_load_from_memory(std::string_view data);
 
 } // namespace arpiyi::assets
 
@@ -2,6 +2,7 @@
 #define ARPIYI_SCRIPT_HPP
 
 #include "asset.hpp"
+#include "json_asset.hpp"
 
 #include <string>
 
@@ -25,6 +26,10 @@ template<> struct LoadParams<Script> { fs::path path; };
 
 template<> RawSaveData raw_get_save_data<Script>(Script const&);
 template<> void raw_load<Script>(Script&, LoadParams<Script> const& params);
+template<> struct PreparedLoad<Script> : JsonPreparedLoad {};
+template<> PreparedLoad<Script> raw_prepare_load<Script>(LoadParams<Script> const& params);
+template<> void raw_finish_load<Script>(Script&, PreparedLoad<Script>&& prepared);
+template<> inline void raw_unload<Script>(Script&) {}
 
 } // namespace arpiyi_editor::assets
 
@@ -3,6 +3,7 @@
 
 #include "asset.hpp"
 #include "asset_manager.hpp"
+#include "json_asset.hpp"
 #include "texture.hpp"
 #include "util/math.hpp"
 
@@ -15,12 +16,12 @@ namespace aml = anton::math;
 
 namespace arpiyi::assets {
 
-struct [[assets::serialize]] [[meta::dir_name("sprites")]] Sprite {
+struct [[assets::serialize]] [[assets::binary_format(1)]] [[lua::expose]] [[meta::dir_name("sprites")]] Sprite {
     /// Texture of the sprite. Not owned by it
-    Handle<assets::Texture> texture;
-    aml::Vector2 uv_min;
-    aml::Vector2 uv_max;
-    std::string name;
+    [[lua::hidden]] Handle<assets::Texture> texture;
+    [[lua::hidden]] aml::Vector2 uv_min;
+    [[lua::hidden]] aml::Vector2 uv_max;
+    [[lua::readonly]] std::string name;
     /// Where this sprite originates from. Goes from {0,0} (Upper left) to {1,1} (Lower right).
     aml::Vector2 pivot;
 
@@ -31,12 +32,11 @@ struct [[assets::serialize]] [[meta::dir_name("sprites")]] Sprite {
     }
 };
 
-template<> struct LoadParams<Sprite> {
-    fs::path path;
-};
+// Loading, saving and unloading are generated for the binary format. Unloading leaves the texture
+// loaded, since it is not owned by the sprite.
 
-template<> RawSaveData raw_get_save_data(Sprite const&);
-template<> void raw_load(Sprite&, LoadParams<Sprite> const&);
+/// Loads the JSON files sprites were stored as before using the binary format.
+template<> bool raw_load_legacy<Sprite>(Sprite&, std::string_view data);
 
 }
 
@@ -3,8 +3,14 @@
 
 #include "asset.hpp"
 
+#include <algorithm>
 #include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <memory>
+#include <vector>
 
+#include "load_profiler.hpp"
 #include "util/intdef.hpp"
 #include <glad/glad.h>
 #include <stb_image.h>
@@ -17,10 +23,22 @@ namespace arpiyi::assets {
 struct [[assets::serialize]] [[meta::dir_name("textures")]] Texture {
     u32 w;
     u32 h;
-    unsigned int handle = static_cast<unsigned int>(-1);
+    [[assets::transient]] unsigned int handle = static_cast<unsigned int>(-1);
     constexpr static auto nohandle = static_cast<decltype(handle)>(-1);
+    /// Contents of the image file this texture was loaded from, saved back as-is so that saving
+    /// doesn't need to read the pixels back from the GPU and encode them again. Null for textures
+    /// generated at runtime, for those whose pixels don't match the file (Flipped on load) and for
+    /// all of them unless keep_texture_encoded_data() is set.
+    [[assets::transient]] std::shared_ptr<const std::vector<u8>> encoded_data;
 };
 
+/// Whether textures loaded from now on keep the contents of their image files. Only programs that
+/// save textures back, like the editor, need them; Must be set before loading anything.
+inline bool& keep_texture_encoded_data() {
+    static bool keep = false;
+    return keep;
+}
+
 enum TextureFilter { point, linear };
 template<> struct LoadParams<Texture> {
     fs::path path;
@@ -28,16 +46,60 @@ template<> struct LoadParams<Texture> {
     TextureFilter filter = TextureFilter::point;
 };
 
-template<> inline void raw_load(Texture& texture, LoadParams<Texture> const& params) {
-    stbi_set_flip_vertically_on_load(params.flip);
-    int w, h, channels;
-    unsigned char* data = stbi_load(params.path.generic_string().c_str(), &w, &h, &channels, 4);
+/// Decoded pixels of a texture, ready to be uploaded to the GPU.
+template<> struct PreparedLoad<Texture> {
+    std::unique_ptr<unsigned char, decltype(&stbi_image_free)> owned_data{nullptr,
+                                                                          &stbi_image_free};
+    /// RGBA8 pixels to upload. Points to owned_data unless the pixels are borrowed from
+    /// somewhere else, like a mapped pack file.
+    unsigned char const* data = nullptr;
+    int w = 0, h = 0;
+    TextureFilter filter = TextureFilter::point;
+    std::shared_ptr<const std::vector<u8>> encoded_data;
+};
+
+template<>
+inline PreparedLoad<Texture> raw_prepare_load<Texture>(LoadParams<Texture> const& params) {
+    PreparedLoad<Texture> prepared;
+    std::shared_ptr<std::vector<u8>> encoded_data;
+    {
+        load_profiler::StageTimer profile(load_profiler::Stage::io);
+        std::ifstream f(params.path, std::ios::binary);
+        encoded_data = std::make_shared<std::vector<u8>>(std::istreambuf_iterator<char>(f),
+                                                         std::istreambuf_iterator<char>());
+    }
+    load_profiler::StageTimer profile(load_profiler::Stage::decode);
+    int channels;
+    prepared.owned_data.reset(stbi_load_from_memory(encoded_data->data(),
+                                                    static_cast<int>(encoded_data->size()),
+                                                    &prepared.w, &prepared.h, &channels, 4));
+    if (!params.flip && keep_texture_encoded_data())
+        prepared.encoded_data = std::move(encoded_data);
+    prepared.data = prepared.owned_data.get();
+    prepared.filter = params.filter;
+
+    // stbi_set_flip_vertically_on_load() is global state shared by all threads, so flip the rows
+    // here instead.
+    if (params.flip && prepared.owned_data) {
+        const std::size_t row_size = static_cast<std::size_t>(prepared.w) * 4;
+        unsigned char* data = prepared.owned_data.get();
+        for (int y = 0; y < prepared.h / 2; ++y) {
+            std::swap_ranges(data + y * row_size, data + (y + 1) * row_size,
+                             data + (prepared.h - 1 - y) * row_size);
+        }
+    }
+    return prepared;
+}
 
+template<>
+inline void raw_finish_load<Texture>(Texture& texture, PreparedLoad<Texture>&& prepared) {
+    load_profiler::StageTimer profile(load_profiler::Stage::upload);
     unsigned int tex;
     glGenTextures(1, &tex);
     glBindTexture(GL_TEXTURE_2D, tex);
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, w, h, 0, GL_RGBA, GL_UNSIGNED_BYTE, data);
-    switch (params.filter) {
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, prepared.w, prepared.h, 0, GL_RGBA, GL_UNSIGNED_BYTE,
+                 prepared.data);
+    switch (prepared.filter) {
         case point:
             glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
             glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
@@ -52,14 +114,41 @@ template<> inline void raw_load(Texture& texture, LoadParams<Texture> const& par
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
 
-    stbi_image_free(data);
     texture.handle = tex;
-    texture.w = w;
-    texture.h = h;
+    texture.w = prepared.w;
+    texture.h = prepared.h;
+    texture.encoded_data = std::move(prepared.encoded_data);
+}
+
+template<> inline void raw_load(Texture& texture, LoadParams<Texture> const& params) {
+    raw_finish_load(texture, raw_prepare_load(params));
 }
 
 template<> RawSaveData raw_get_save_data<Texture>(Texture const& texture);
 
+/// Textures without their encoded file contents are read back from the GPU asynchronously through
+/// a pixel pack buffer, so that taking the snapshot doesn't stall the main thread.
+template<> struct SaveSnapshot<Texture> {
+    SaveSnapshot() = default;
+    SaveSnapshot(SaveSnapshot&& other) noexcept;
+    SaveSnapshot& operator=(SaveSnapshot&& other) noexcept;
+    /// Deletes the buffer and fence of readbacks that were never completed. Snapshots with one in
+    /// progress must be destroyed on the main thread.
+    ~SaveSnapshot();
+
+    std::shared_ptr<const std::vector<u8>> encoded_data;
+    u32 w = 0, h = 0;
+    /// Buffer the pixels are being read back into. nohandle once they have been copied to pixels.
+    unsigned int pbo = Texture::nohandle;
+    GLsync fence = nullptr;
+    /// RGBA8 pixels of the texture. Only used if there is no encoded data.
+    std::vector<u8> pixels;
+};
+template<> SaveSnapshot<Texture> raw_make_save_snapshot<Texture>(Texture const& texture);
+template<> bool raw_poll_save_snapshot<Texture>(SaveSnapshot<Texture>& snapshot);
+template<>
+RawSaveData raw_get_snapshot_save_data<Texture>(SaveSnapshot<Texture> const& snapshot);
+
 template<> inline void raw_unload(Texture& texture) { glDeleteTextures(1, &texture.handle); }
 
 } // namespace arpiyi_editor::assets
@@ -2,6 +2,8 @@
 #define ARPIYI_TILESET_HPP
 
 #include "asset_manager.hpp"
+#include "autotile.hpp"
+#include "json_asset.hpp"
 #include "mesh.hpp"
 #include "texture.hpp"
 #include "util/intdef.hpp"
@@ -25,11 +27,24 @@ struct [[assets::serialize]] [[meta::dir_name("tilesets")]] Tileset {
         // i.e. Inside_A2
         // This will also work with A1 tilesets, but those are meant to be animated.
         rpgmaker_a2,
+        // Used for RPGMaker A3 tilesets (Building walls and roofs).
+        rpgmaker_a3,
+        // Used for RPGMaker A4 tilesets (Wall tops and wall sides).
+        rpgmaker_a4,
         count
     } auto_type;
 
     Handle<assets::Texture> texture;
     std::string name;
+    /// Lookup tables for placing autotiles, built from the rules of auto_type. Empty if the
+    /// tileset has no autotiles. See compile_autotile_rules().
+    [[assets::transient]] autotile::CompiledRules autotile_rules;
+
+    /// @returns The arrangement of autotiles in the source images of the given auto type, or null
+    /// if it has no autotiles.
+    [[nodiscard]] static autotile::Layout const* get_autotile_layout(AutoType type);
+    /// Rebuilds autotile_rules. Must be called after changing auto_type.
+    void compile_autotile_rules();
 
     /// Returns the size of this tileset in tiles, taking the tilesize as an argument.
     [[nodiscard]] math::IVec2D get_size_in_tiles() const;
@@ -48,6 +63,9 @@ template<> struct LoadParams<Tileset> { fs::path path; };
 
 template<> RawSaveData raw_get_save_data<Tileset>(Tileset const& tileset);
 template<> void raw_load<Tileset>(Tileset& tileset, LoadParams<Tileset> const& params);
+template<> struct PreparedLoad<Tileset> : JsonPreparedLoad {};
+template<> PreparedLoad<Tileset> raw_prepare_load<Tileset>(LoadParams<Tileset> const& params);
+template<> void raw_finish_load<Tileset>(Tileset&, PreparedLoad<Tileset>&& prepared);
 
 } // namespace arpiyi_editor::assets
 
@@ -0,0 +1,153 @@
+#ifndef ARPIYI_AUTOTILE_HPP
+#define ARPIYI_AUTOTILE_HPP
+
+#include "util/intdef.hpp"
+
+#include <array>
+#include <vector>
+
+/// Rules for choosing and generating the tiles of autotiles. Each column of an autotile tileset is
+/// a type of autotile, and each of its rows is the tile to use for a given shape. The shape of a
+/// tile depends on its surroundings: A mask with a bit for each of its 8 neighbours, from the upper
+/// left to the lower right one, that is set if the neighbour is *not* of the same type.
+namespace arpiyi::autotile {
+
+constexpr u8 upper_left_corner = 1 << 0;
+constexpr u8 upper_middle_side = 1 << 1;
+constexpr u8 upper_right_corner = 1 << 2;
+constexpr u8 middle_left_side = 1 << 3;
+constexpr u8 middle_right_side = 1 << 4;
+constexpr u8 lower_left_corner = 1 << 5;
+constexpr u8 lower_middle_side = 1 << 6;
+constexpr u8 lower_right_corner = 1 << 7;
+
+/// Amount of possible surroundings masks.
+constexpr u32 surroundings_count = 256;
+
+/// Position of a minitile (A quarter of a tile) inside a block of the source image, in minitiles.
+struct MinitileSource {
+    u8 x, y;
+};
+
+/// Bits of the index of RuleSet::minitile_sources, set if the neighbour of that quadrant is of a
+/// different type.
+constexpr u8 horz_side_bit = 1 << 0;
+constexpr u8 vert_side_bit = 1 << 1;
+constexpr u8 corner_bit = 1 << 2;
+
+/// Describes a kind of autotile block: Which neighbours its shape depends on, and where in the
+/// source block to take each quarter of its tiles from.
+struct RuleSet {
+    /// Size of each block of the source image, in tiles.
+    u8 block_width, block_height;
+    /// Neighbours that are taken into account. The bits of the rest are ignored.
+    u8 neighbour_mask;
+    /// Source of each quadrant of a tile (Upper left, upper right, lower left, lower right) for
+    /// every combination of corner_bit, vert_side_bit and horz_side_bit.
+    std::array<std::array<MinitileSource, 8>, 4> minitile_sources;
+};
+
+// The layout RPGMaker uses for floor auto-tiling consists of 6 tiles (Each one composed by 2x2
+// minitiles):
+// -----------------------------------------
+// display_tile         all_external_corners
+// upper-left corner    upper-right corner
+// lower-left corner    lower-right corner
+// -----------------------------------------
+// display_tile is actually not used in the calculations; it's just the tile that RPGMaker shows
+// in the editor. Walls drop the first row, and have no corners.
+// For more information, check out
+// https://blog.rpgmakerweb.com/tutorials/anatomy-of-an-autotile/
+
+/// RPGMaker floors: A2 tilesets and the tops of A4 walls. Minitiles only use the inner corners of
+/// all_external_corners when both of their sides are of the same type.
+constexpr RuleSet floor_rules = {
+    2,
+    3,
+    0xFF,
+    {{{{{2, 4}, {0, 4}, {2, 2}, {0, 2}, {2, 0}, {0, 4}, {2, 2}, {0, 2}}},
+      {{{1, 4}, {3, 4}, {1, 2}, {3, 2}, {3, 0}, {3, 4}, {1, 2}, {3, 2}}},
+      {{{2, 3}, {0, 3}, {2, 5}, {0, 5}, {2, 1}, {0, 3}, {2, 5}, {0, 5}}},
+      {{{1, 3}, {3, 3}, {1, 5}, {3, 5}, {3, 1}, {3, 3}, {1, 5}, {3, 5}}}}}};
+
+/// RPGMaker walls and roofs: A3 tilesets and the sides of A4 walls. Only sides are taken into
+/// account.
+constexpr RuleSet wall_rules = {
+    2,
+    2,
+    upper_middle_side | middle_left_side | middle_right_side | lower_middle_side,
+    {{{{{2, 2}, {0, 2}, {2, 0}, {0, 0}, {2, 2}, {0, 2}, {2, 0}, {0, 0}}},
+      {{{1, 2}, {3, 2}, {1, 0}, {3, 0}, {1, 2}, {3, 2}, {1, 0}, {3, 0}}},
+      {{{2, 1}, {0, 1}, {2, 3}, {0, 3}, {2, 1}, {0, 1}, {2, 3}, {0, 3}}},
+      {{{1, 1}, {3, 1}, {1, 3}, {3, 3}, {1, 1}, {3, 1}, {1, 3}, {3, 3}}}}}};
+
+/// Arrangement of the blocks in the source images of an auto type. Images are split into bands of
+/// blocks from top to bottom, with the kinds of blocks given by band_rules; The sequence of bands
+/// repeats until the bottom of the image. Generated tilesets have a column per block, and every
+/// band_count columns contain the blocks in the same position of each band.
+struct Layout {
+    std::array<RuleSet const*, 2> band_rules;
+    u32 band_count;
+
+    /// Width of all the blocks in the layout, in tiles.
+    [[nodiscard]] u32 get_block_width() const { return band_rules[0]->block_width; }
+    /// Height of a whole sequence of bands, in tiles.
+    [[nodiscard]] u32 get_group_height() const {
+        u32 height = 0;
+        for (u32 i = 0; i < band_count; ++i) height += band_rules[i]->block_height;
+        return height;
+    }
+    /// Vertical position of a band within its sequence, in tiles.
+    [[nodiscard]] u32 get_band_offset(u32 band) const {
+        u32 offset = 0;
+        for (u32 i = 0; i < band; ++i) offset += band_rules[i]->block_height;
+        return offset;
+    }
+};
+
+constexpr Layout rpgmaker_a2_layout = {{&floor_rules}, 1};
+constexpr Layout rpgmaker_a3_layout = {{&wall_rules}, 1};
+/// Wall tops and wall sides are placed next to each other in the generated tileset.
+constexpr Layout rpgmaker_a4_layout = {{&floor_rules, &wall_rules}, 2};
+
+/// @returns The source minitiles of the 4 quadrants of a tile with the given surroundings.
+[[nodiscard]] std::array<MinitileSource, 4> get_minitile_sources(RuleSet const& rules,
+                                                                 u8 surroundings);
+
+/// Flat lookup tables built from the rules of a layout. Surroundings that end up generating the
+/// same tile share the same row.
+class CompiledRules {
+public:
+    CompiledRules() = default;
+    explicit CompiledRules(Layout const& layout);
+
+    /// True for tilesets without autotiles.
+    [[nodiscard]] bool empty() const { return band_count == 0; }
+
+    /// @returns The row of the tile to use for an autotile of the given column and surroundings.
+    [[nodiscard]] u32 get_row(u32 x_index, u8 surroundings) const {
+        return shape_rows[(x_index % band_count) * surroundings_count + surroundings];
+    }
+    /// @returns The surroundings of the tile at the given row and column, with the bits of ignored
+    /// neighbours cleared.
+    [[nodiscard]] u8 get_surroundings(u32 x_index, u32 row) const;
+    /// @returns Amount of different tiles the autotiles of the given column have.
+    [[nodiscard]] u32 get_shape_count(u32 x_index) const {
+        return shape_counts[x_index % band_count];
+    }
+    /// @returns Height of the generated tilesets, in tiles.
+    [[nodiscard]] u32 get_row_count() const { return row_count; }
+
+private:
+    u32 band_count = 0;
+    u32 row_count = 0;
+    /// Row of each surroundings mask, band after band.
+    std::vector<u8> shape_rows;
+    /// Surroundings of each row, band after band. row_count entries per band.
+    std::vector<u8> row_surroundings;
+    std::vector<u32> shape_counts;
+};
+
+} // namespace arpiyi::autotile
+
+#endif // ARPIYI_AUTOTILE_HPP
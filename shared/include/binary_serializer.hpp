@@ -0,0 +1,215 @@
+#ifndef ARPIYI_BINARY_SERIALIZER_HPP
+#define ARPIYI_BINARY_SERIALIZER_HPP
+
+#include "asset_manager.hpp"
+#include "load_profiler.hpp"
+#include "reflection.hpp"
+#include "util/intdef.hpp"
+
+#include <cassert>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <vector>
+
+/// Binary format used by the [[assets::binary_format(version)]] structs, written and read through
+/// their generated reflection tables. Files contain:
+/// - The magic bytes and the version of the struct layout they were written with.
+/// - Every non-transient field, in declaration order:
+///   - Trivially copyable values (Numbers, enums, vectors...) as their raw bytes.
+///   - Handles as their u64 ID.
+///   - Strings and std::vectors as their u64 element count followed by their elements.
+/// All numbers are stored in native byte order, like in packs.
+namespace arpiyi::binary {
+
+constexpr char magic[4] = {'A', 'R', 'P', 'B'};
+
+/// Bounds-checked cursor over binary asset data.
+class Reader {
+public:
+    explicit Reader(std::string_view data) : data(data) {}
+
+    /// Copies the next bytes to dst. If there are not enough bytes left, nothing is copied and
+    /// the reader is marked as failed.
+    bool read_bytes(void* dst, std::size_t size) {
+        if (failed || size > data.size() - offset) {
+            failed = true;
+            return false;
+        }
+        std::memcpy(dst, data.data() + offset, size);
+        offset += size;
+        return true;
+    }
+
+    void fail() { failed = true; }
+    [[nodiscard]] bool has_failed() const { return failed; }
+    [[nodiscard]] std::size_t bytes_left() const { return data.size() - offset; }
+
+private:
+    std::string_view data;
+    std::size_t offset = 0;
+    bool failed = false;
+};
+
+namespace detail {
+
+template<typename T> struct is_handle : std::false_type {};
+template<typename T> struct is_handle<Handle<T>> : std::true_type {};
+template<typename T> struct is_vector : std::false_type {};
+template<typename T, typename A> struct is_vector<std::vector<T, A>> : std::true_type {};
+
+template<typename T> constexpr bool is_memcpyable_v =
+    std::is_trivially_copyable_v<T> && !std::is_pointer_v<T> && !is_handle<T>::value;
+
+inline void write_bytes(std::ostream& out, void const* src, std::size_t size) {
+    out.write(static_cast<const char*>(src), static_cast<std::streamsize>(size));
+}
+
+} // namespace detail
+
+template<typename T> void write_value(std::ostream& out, T const& value) {
+    if constexpr (detail::is_handle<T>::value) {
+        const u64 id = value.get_id();
+        detail::write_bytes(out, &id, sizeof(id));
+    } else if constexpr (std::is_same_v<T, std::string>) {
+        const u64 size = value.size();
+        detail::write_bytes(out, &size, sizeof(size));
+        detail::write_bytes(out, value.data(), value.size());
+    } else if constexpr (detail::is_vector<T>::value) {
+        static_assert(!std::is_same_v<T, std::vector<bool>>, "std::vector<bool> is not supported");
+        const u64 size = value.size();
+        detail::write_bytes(out, &size, sizeof(size));
+        if constexpr (detail::is_memcpyable_v<typename T::value_type>)
+            detail::write_bytes(out, value.data(), value.size() * sizeof(typename T::value_type));
+        else
+            for (auto const& element : value) write_value(out, element);
+    } else {
+        static_assert(detail::is_memcpyable_v<T>, "Type has no binary serialization");
+        detail::write_bytes(out, &value, sizeof(value));
+    }
+}
+
+template<typename T> void read_value(Reader& reader, T& value) {
+    if constexpr (detail::is_handle<T>::value) {
+        u64 id = T::noid;
+        reader.read_bytes(&id, sizeof(id));
+        value = T(id);
+    } else if constexpr (std::is_same_v<T, std::string>) {
+        u64 size = 0;
+        // Check the size before resizing so that corrupt data can't make us allocate too much
+        if (!reader.read_bytes(&size, sizeof(size)) || size > reader.bytes_left()) {
+            reader.fail();
+            return;
+        }
+        value.resize(size);
+        reader.read_bytes(value.data(), size);
+    } else if constexpr (detail::is_vector<T>::value) {
+        static_assert(!std::is_same_v<T, std::vector<bool>>, "std::vector<bool> is not supported");
+        using ElementT = typename T::value_type;
+        u64 size = 0;
+        if (!reader.read_bytes(&size, sizeof(size)) ||
+            (detail::is_memcpyable_v<ElementT> && size > reader.bytes_left() / sizeof(ElementT))) {
+            reader.fail();
+            return;
+        }
+        value.clear();
+        if constexpr (detail::is_memcpyable_v<ElementT>) {
+            value.resize(size);
+            reader.read_bytes(value.data(), size * sizeof(ElementT));
+        } else {
+            for (u64 i = 0; i < size && !reader.has_failed(); ++i)
+                read_value(reader, value.emplace_back());
+        }
+    } else {
+        static_assert(detail::is_memcpyable_v<T>, "Type has no binary serialization");
+        reader.read_bytes(&value, sizeof(value));
+    }
+}
+
+/// Called instead of reading the fields when loading data written with an older version of an
+/// asset's struct layout. The reader is placed right after the header. Specialize it when bumping
+/// the version in [[assets::binary_format]].
+/// @returns Whether the asset could be migrated. By default no version can, and the load fails.
+template<typename AssetT> bool migrate(AssetT&, u32 /* file_version */, Reader&) {
+    return false;
+}
+
+template<typename AssetT> assets::RawSaveData get_save_data(AssetT const& asset) {
+    constexpr u32 version = reflection::Reflection<AssetT>::binary_format_version;
+    static_assert(version != 0, "Asset type has no [[assets::binary_format]] attribute");
+
+    assets::RawSaveData data;
+    detail::write_bytes(data.bytestream, magic, sizeof(magic));
+    write_value(data.bytestream, version);
+    reflection::for_each_field<AssetT>([&](auto const& field) {
+        if (!field.transient)
+            write_value(data.bytestream, asset.*field.ptr);
+    });
+    return data;
+}
+
+/// Reads the whole file in advance. Can be called from worker threads.
+inline assets::BinaryPreparedLoad prepare_load(fs::path const& path) {
+    load_profiler::StageTimer profile(load_profiler::Stage::io);
+    std::ifstream f(path, std::ios::binary);
+    std::stringstream buffer;
+    buffer << f.rdbuf();
+    return {buffer.str()};
+}
+
+/// Loads an asset from its binary data. Files that are not valid, truncated, newer than this build
+/// or of a version that can't be migrated are reported and leave the asset untouched.
+/// @returns Whether the asset was loaded.
+template<typename AssetT> bool finish_load(AssetT& asset, std::string_view data) {
+    load_profiler::StageTimer profile(load_profiler::Stage::parse);
+    using Reflection = reflection::Reflection<AssetT>;
+    constexpr u32 version = Reflection::binary_format_version;
+    static_assert(version != 0, "Asset type has no [[assets::binary_format]] attribute");
+
+    Reader reader(data);
+    char file_magic[sizeof(magic)];
+    u32 file_version = 0;
+    reader.read_bytes(file_magic, sizeof(file_magic));
+    read_value(reader, file_version);
+    if (reader.has_failed() || std::memcmp(file_magic, magic, sizeof(magic)) != 0) {
+        if (assets::raw_load_legacy(asset, data))
+            return true;
+        std::cerr << "Invalid " << Reflection::name << " file: Not in the binary asset format."
+                  << std::endl;
+        return false;
+    }
+    if (file_version > version) {
+        std::cerr << Reflection::name << " file was written with version " << file_version
+                  << " of its binary format, but this build only supports up to version "
+                  << version << "." << std::endl;
+        return false;
+    }
+
+    AssetT loaded{};
+    if (file_version != version) {
+        if (!migrate(loaded, file_version, reader)) {
+            std::cerr << Reflection::name << " file was written with version " << file_version
+                      << " of its binary format, which can't be migrated." << std::endl;
+            return false;
+        }
+    } else {
+        reflection::for_each_field<AssetT>([&](auto const& field) {
+            if (!field.transient)
+                read_value(reader, loaded.*field.ptr);
+        });
+    }
+    if (reader.has_failed()) {
+        std::cerr << "Invalid " << Reflection::name << " file: Truncated data." << std::endl;
+        return false;
+    }
+    asset = std::move(loaded);
+    return true;
+}
+
+} // namespace arpiyi::binary
+
+#endif // ARPIYI_BINARY_SERIALIZER_HPP
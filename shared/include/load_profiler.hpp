@@ -0,0 +1,103 @@
+#ifndef ARPIYI_LOAD_PROFILER_HPP
+#define ARPIYI_LOAD_PROFILER_HPP
+
+#include "util/intdef.hpp"
+
+#include <array>
+#include <chrono>
+#include <filesystem>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+/// Opt-in timing of the stages assets go through while a project is loaded. The serializer tells
+/// which asset is being loaded in each thread with AssetScope, and the raw_load implementations
+/// time their stages with StageTimer. Nothing is recorded unless a session is running.
+namespace arpiyi::load_profiler {
+
+enum class Stage {
+    /// Reading files into memory.
+    io,
+    /// Parsing JSON or other text formats. Includes reading the file for streamed parsers.
+    parse,
+    /// Decoding images and compressed data.
+    decode,
+    /// Uploading data to the GPU.
+    upload,
+    /// Generating map layer meshes.
+    mesh,
+    count
+};
+constexpr std::array<std::string_view, static_cast<std::size_t>(Stage::count)> stage_names = {
+    "io", "parse", "decode", "upload", "mesh"};
+/// Milliseconds spent on each stage.
+using StageTimes = std::array<double, static_cast<std::size_t>(Stage::count)>;
+
+struct AssetTimes {
+    /// Directory name of the asset type, like in pack files.
+    std::string type_name;
+    u64 id;
+    StageTimes stage_ms{};
+    /// Time spent inside AssetScopes for this asset, timed stages or not.
+    double total_ms = 0;
+};
+
+struct TypeTimes {
+    std::string type_name;
+    std::size_t asset_count = 0;
+    StageTimes stage_ms{};
+    double total_ms = 0;
+};
+
+/// Clears the times of the previous session and starts recording.
+void begin_session();
+/// Stops recording. The times recorded are kept until the next session begins.
+void end_session();
+[[nodiscard]] bool is_recording();
+/// Wall time between the beginning and the end of the last session.
+[[nodiscard]] double get_session_ms();
+
+/// Attributes the stages timed from the calling thread to the given asset while alive.
+class AssetScope {
+public:
+    AssetScope(std::string_view type_name, u64 id);
+    ~AssetScope();
+    AssetScope(AssetScope const&) = delete;
+    AssetScope& operator=(AssetScope const&) = delete;
+
+private:
+    /// Index of the asset in the session, or -1 if not recording.
+    std::size_t index;
+    std::size_t previous_index;
+    std::chrono::steady_clock::time_point start;
+};
+
+/// Adds the time elapsed while alive to a stage of the asset of the current AssetScope.
+class StageTimer {
+public:
+    explicit StageTimer(Stage stage);
+    ~StageTimer();
+    StageTimer(StageTimer const&) = delete;
+    StageTimer& operator=(StageTimer const&) = delete;
+
+private:
+    Stage stage;
+    std::chrono::steady_clock::time_point start;
+};
+
+/// @returns The times of every asset recorded in the last session, slowest first.
+[[nodiscard]] std::vector<AssetTimes> get_asset_times();
+/// @returns The times of the last session added up by asset type, slowest first.
+[[nodiscard]] std::vector<TypeTimes> get_type_times();
+
+/// Writes a human readable summary of the last session: Times per type and the slowest assets.
+void print_summary(std::ostream& out, std::size_t slowest_asset_count = 10);
+/// Writes all the times of the last session to a JSON file.
+void write_json_report(fs::path const& path);
+
+} // namespace arpiyi::load_profiler
+
+#endif // ARPIYI_LOAD_PROFILER_HPP
@@ -0,0 +1,124 @@
+#ifndef ARPIYI_PACK_HPP
+#define ARPIYI_PACK_HPP
+
+#include "assets/json_asset.hpp"
+#include "assets/map.hpp"
+#include "assets/texture.hpp"
+#include "load_profiler.hpp"
+#include "util/intdef.hpp"
+
+#include <cstddef>
+#include <filesystem>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+
+namespace fs = std::filesystem;
+
+/// Packs are read-only, single file versions of a project made by the arpiyi-pack tool so that the
+/// player can load them with one memory mapping instead of opening every asset file. They contain:
+/// - A Header.
+/// - The table of contents: Header::toc_count TocEntry structs, sorted by type name and ID.
+/// - Every asset's data, each one aligned to payload_alignment bytes. Texture data is stored
+///   already decoded (see TexturePayloadHeader); everything else is stored as it is on the
+///   project folder.
+/// All numbers are stored in native byte order.
+namespace arpiyi::pack {
+
+constexpr char magic[8] = {'A', 'R', 'P', 'I', 'P', 'A', 'C', 'K'};
+constexpr u32 format_version = 1;
+constexpr u64 payload_alignment = 16;
+/// Type name of the entry containing the project.json file, with ID 0.
+constexpr std::string_view project_file_type_name = "project";
+
+struct Header {
+    char magic[8];
+    u32 version;
+    u32 toc_count;
+    u64 toc_offset;
+};
+
+struct TocEntry {
+    /// The asset's directory name (AssetDirName<T>::value), padded with zeros.
+    char type_name[16];
+    u64 id;
+    u64 offset;
+    u64 size;
+
+    [[nodiscard]] std::string_view get_type_name() const {
+        std::size_t len = 0;
+        while (len < sizeof(type_name) && type_name[len] != '\0') ++len;
+        return {type_name, len};
+    }
+};
+
+/// Placed at the start of texture data, followed by w * h RGBA8 pixels starting at
+/// payload_alignment bytes from the start.
+struct TexturePayloadHeader {
+    u32 w;
+    u32 h;
+};
+
+static_assert(std::is_trivially_copyable_v<Header> && std::is_trivially_copyable_v<TocEntry> &&
+              std::is_trivially_copyable_v<TexturePayloadHeader>);
+static_assert(sizeof(TexturePayloadHeader) <= payload_alignment);
+
+/// A pack file mapped into memory. All data returned points directly to the mapping, so it is only
+/// valid while the PackFile is alive.
+class PackFile {
+public:
+    /// Maps the given file. Check is_open() afterwards to know if it was mapped and is a valid pack.
+    explicit PackFile(fs::path const& path);
+    ~PackFile();
+    PackFile(PackFile const&) = delete;
+    PackFile& operator=(PackFile const&) = delete;
+
+    [[nodiscard]] bool is_open() const { return mapping != nullptr; }
+
+    /// @returns The range of entries with the given type name, sorted by ID.
+    [[nodiscard]] std::pair<TocEntry const*, TocEntry const*>
+    get_entries(std::string_view type_name) const;
+    /// @returns The entry with the given type name and ID, or nullptr if there is none.
+    [[nodiscard]] TocEntry const* find(std::string_view type_name, u64 id) const;
+    [[nodiscard]] std::string_view get_data(TocEntry const& entry) const {
+        return {static_cast<const char*>(mapping) + entry.offset, entry.size};
+    }
+
+private:
+    void unmap();
+
+    void const* mapping = nullptr;
+    std::size_t mapping_size = 0;
+    TocEntry const* toc_begin = nullptr;
+    TocEntry const* toc_end = nullptr;
+#ifdef _WIN32
+    void* file_handle = nullptr;
+    void* mapping_handle = nullptr;
+#endif
+};
+
+/// Prepares an asset from its data in a pack, with the same restrictions as
+/// assets::raw_prepare_load(). By default the data is parsed as a JSON document, or copied as is
+/// for assets using the generated binary format.
+template<typename AssetT>
+assets::PreparedLoad<AssetT> prepare_packed_load(std::string_view data) {
+    if constexpr (std::is_base_of_v<assets::BinaryPreparedLoad, assets::PreparedLoad<AssetT>>) {
+        load_profiler::StageTimer profile(load_profiler::Stage::io);
+        return {{std::string(data)}};
+    } else {
+        static_assert(std::is_base_of_v<assets::JsonPreparedLoad, assets::PreparedLoad<AssetT>>,
+                      "Asset type has no packed load implementation");
+        return {{assets::parse_json_data(data)}};
+    }
+}
+
+/// Textures are not copied at all; their pixels are uploaded straight from the mapping.
+template<>
+assets::PreparedLoad<assets::Texture> prepare_packed_load<assets::Texture>(std::string_view data);
+
+template<> assets::PreparedLoad<assets::Map> prepare_packed_load<assets::Map>(std::string_view data);
+
+} // namespace arpiyi::pack
+
+#endif // ARPIYI_PACK_HPP
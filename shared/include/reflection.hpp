@@ -0,0 +1,48 @@
+#ifndef ARPIYI_REFLECTION_HPP
+#define ARPIYI_REFLECTION_HPP
+
+#include <string_view>
+#include <tuple>
+#include <utility>
+
+/// Compile-time descriptions of the public data members of every [[assets::serialize]] struct,
+/// generated by arpiyi-codegen from the asset headers.
+namespace arpiyi::reflection {
+
+template<typename ClassT, typename MemberT> struct Field {
+    using class_type = ClassT;
+    using member_type = MemberT;
+
+    std::string_view name;
+    /// Type as written in the asset header. Only meant for displaying it.
+    std::string_view type_name;
+    MemberT ClassT::*ptr;
+    /// True if the member was marked with [[assets::transient]] and must not be serialized.
+    bool transient;
+};
+
+template<typename ClassT, typename MemberT>
+constexpr Field<ClassT, MemberT> make_field(std::string_view name,
+                                            std::string_view type_name,
+                                            MemberT ClassT::*ptr,
+                                            bool transient) {
+    return {name, type_name, ptr, transient};
+}
+
+/// Specialized for every [[assets::serialize]] struct with:
+/// - constexpr static std::string_view name
+/// - constexpr static u32 binary_format_version: The argument of [[assets::binary_format]], or 0
+///   if the struct doesn't use the generated binary format.
+/// - constexpr static auto fields: A tuple of Field, in declaration order.
+template<typename T> struct Reflection;
+
+/// Calls the given function with every field of T, in declaration order.
+template<typename T, typename F> constexpr void for_each_field(F&& func) {
+    std::apply([&func](auto const&... fields) { (func(fields), ...); }, Reflection<T>::fields);
+}
+
+} // namespace arpiyi::reflection
+
+#include "assets/reflection_cg.hpp" // codegen
+
+#endif // ARPIYI_REFLECTION_HPP
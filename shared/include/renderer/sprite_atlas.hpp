@@ -0,0 +1,71 @@
+#ifndef ARPIYI_SPRITE_ATLAS_HPP
+#define ARPIYI_SPRITE_ATLAS_HPP
+
+#include <anton/math/vector2.hpp>
+#include <optional>
+#include <unordered_map>
+#include <vector>
+
+#include "asset_manager.hpp"
+#include "assets/sprite.hpp"
+#include "util/intdef.hpp"
+#include "util/math.hpp"
+
+namespace aml = anton::math;
+
+namespace arpiyi::renderer {
+
+/// Packs rectangles into a fixed size bin, placing each one as low as possible on top of the
+/// skyline formed by the previous ones (Skyline bottom-left heuristic).
+class SkylinePacker {
+public:
+    SkylinePacker(i32 width, i32 height);
+
+    /// @returns Where the rect was placed, or std::nullopt if it doesn't fit in the bin anymore.
+    std::optional<math::IVec2D> pack(math::IVec2D size);
+
+private:
+    /// Horizontal segment of the skyline.
+    struct Node {
+        i32 x, y, width;
+    };
+
+    /// @returns The Y position a rect would be placed at if put on the given node, or
+    /// std::nullopt if it doesn't fit there.
+    [[nodiscard]] std::optional<i32> fit(std::size_t node_index, math::IVec2D size) const;
+
+    i32 width, height;
+    std::vector<Node> skyline;
+};
+
+/// Copies the regions used by all loaded sprites into a few big atlas textures, so that sprites
+/// that originally came from different textures can be drawn together.
+/// Sprites themselves are not modified: Their original texture and UVs remain the source of
+/// truth, and the atlas has to be rebuilt if they change.
+class SpriteAtlas {
+public:
+    struct Region {
+        unsigned int texture;
+        aml::Vector2 uv_min;
+        aml::Vector2 uv_max;
+    };
+
+    /// Packs all the sprites currently loaded. Any previously built atlas textures are destroyed.
+    /// Sprites bigger than the atlas size are left out.
+    void build(i32 atlas_size = 2048);
+    /// @returns The region of the atlas the given sprite was packed in, or nullptr if it wasn't.
+    [[nodiscard]] Region const* find(Handle<assets::Sprite> sprite) const;
+    [[nodiscard]] std::size_t get_atlas_count() const { return atlases.size(); }
+
+    /// Frees all the atlas textures.
+    void destroy();
+
+private:
+    std::vector<unsigned int> atlases;
+    /// Sprite ID -> Region.
+    std::unordered_map<u64, Region> regions;
+};
+
+} // namespace arpiyi::renderer
+
+#endif // ARPIYI_SPRITE_ATLAS_HPP
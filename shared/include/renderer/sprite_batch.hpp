@@ -0,0 +1,71 @@
+#ifndef ARPIYI_SPRITE_BATCH_HPP
+#define ARPIYI_SPRITE_BATCH_HPP
+
+#include <anton/math/vector2.hpp>
+#include <vector>
+
+#include "util/intdef.hpp"
+
+namespace aml = anton::math;
+
+namespace arpiyi::renderer {
+
+/// Collects textured quads during a frame and draws them all at once, issuing only one draw call
+/// per run of consecutive quads that use the same texture. Packing sprites into an atlas makes
+/// these runs longer.
+/// Vertices are given in the format expected by basic.vert: {pos.x pos.y uv.x uv.y}, so the model
+/// matrix must transform from the same space the sprite positions are given in.
+class SpriteBatch {
+public:
+    struct Stats {
+        /// Amount of sprites drawn in the last batch.
+        u64 sprites = 0;
+        /// Amount of draw calls issued in the last batch.
+        u64 draw_calls = 0;
+        /// CPU time spent building, uploading and submitting the last batch, in milliseconds.
+        float submit_time_ms = 0;
+    };
+
+    /// Starts collecting sprites. Any sprites from a previous unfinished batch are discarded.
+    void begin();
+    /// Queues a sprite to be drawn.
+    /// @param pos Position of the upper left corner of the sprite.
+    /// @param size Size of the sprite, in the same units as pos.
+    void draw(unsigned int texture,
+              aml::Vector2 pos,
+              aml::Vector2 size,
+              aml::Vector2 uv_min,
+              aml::Vector2 uv_max);
+    /// Draws all the sprites queued since begin(), in the order they were queued in. The shader
+    /// and uniforms to use must be bound beforehand.
+    void end();
+
+    /// Returns the statistics of the last batch drawn.
+    [[nodiscard]] Stats const& get_stats() const { return stats; }
+
+    /// Frees the GPU buffers used by this batch. They will be recreated if it is used again.
+    void destroy();
+
+private:
+    struct QueuedSprite {
+        unsigned int texture;
+        aml::Vector2 pos;
+        aml::Vector2 size;
+        aml::Vector2 uv_min;
+        aml::Vector2 uv_max;
+    };
+
+    std::vector<QueuedSprite> sprites;
+    std::vector<float> vertices;
+    Stats stats;
+
+    static constexpr auto noobj = static_cast<unsigned int>(-1);
+    unsigned int vao = noobj;
+    unsigned int vbo = noobj;
+    /// Size of the vertex buffer storage, in bytes.
+    u64 vbo_capacity = 0;
+};
+
+} // namespace arpiyi::renderer
+
+#endif // ARPIYI_SPRITE_BATCH_HPP
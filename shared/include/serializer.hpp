@@ -2,12 +2,30 @@
 #define ARPIYI_SERIALIZER_HPP
 
 #include "asset_manager.hpp"
+#include "assets/all_assets_cg.hpp" // codegen
+#include "load_profiler.hpp"
+#include "pack.hpp"
+#include "util/intdef.hpp"
+#include "util/thread_pool.hpp"
+#include "util/type_list.hpp"
 
+#include <algorithm>
 #include <fstream>
 #include <functional>
+#include <future>
+#include <iostream>
+#include <memory>
+#include <optional>
 #include <rapidjson/document.h>
 #include <rapidjson/stringbuffer.h>
 #include <rapidjson/writer.h>
+#include <string>
+#include <tuple>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
+#include <variant>
+#include <vector>
 
 namespace arpiyi::serializer {
 
@@ -29,105 +47,466 @@ constexpr std::string_view id_json_key = "id";
 constexpr std::string_view path_json_key = "path";
 } // namespace detail::meta_file_definitions
 
+namespace detail {
+
+/// Worker threads used for reading and parsing asset files while loading projects.
+inline util::ThreadPool& get_load_thread_pool() {
+    static util::ThreadPool pool;
+    return pool;
+}
+
+/// Assets of a type being prepared in the load thread pool, by ID.
 template<typename AssetT>
-void load_assets(fs::path const& project_path,
-                 std::function<void(std::string_view /* progress string */,
-                                    float /* progress (0~1) */)> const& per_step_func) {
-    namespace mfd = detail::meta_file_definitions;
+using PreparedAssets = std::vector<std::pair<u64, std::future<assets::PreparedLoad<AssetT>>>>;
+
+/// Places a loaded asset in its container with the ID it was saved with. IDs that can't be used,
+/// like corrupt ones or ones that collide with an asset already loaded, are reported and their
+/// asset is unloaded.
+template<typename AssetT> Handle<AssetT> put_loaded_asset(AssetT& asset, u64 id) {
+    auto const& storage = arpiyi::detail::AssetContainer<AssetT>::get_instance().storage;
+    if (const char* error = storage.get_emplace_error(id)) {
+        std::cerr << "Could not place " << assets::AssetDirName<AssetT>::value << " asset with ID "
+                  << id << ": " << error << "." << std::endl;
+        assets::raw_unload(asset);
+        return {};
+    }
+    return asset_manager::put(asset, id);
+}
+
+/// Finishes loading the given assets in the calling thread, in order, and places them in their
+/// container. Assets that fail to load or have unusable IDs are left out.
+template<typename AssetT, typename PerStepF>
+void finish_prepared_assets(PreparedAssets<AssetT>& prepared_assets,
+                            PerStepF const& per_step_func) {
+    std::size_t i = 0;
+    for (auto& [id, prepared] : prepared_assets) {
+        per_step_func(assets::AssetDirName<AssetT>::value,
+                      static_cast<float>(i) / static_cast<float>(prepared_assets.size()));
+        AssetT asset;
+        auto loaded = prepared.get();
+        {
+            load_profiler::AssetScope profile(assets::AssetDirName<AssetT>::value, id);
+            assets::raw_finish_load(asset, std::move(loaded));
+        }
+        // The reason has already been reported; Handles to the asset will just find nothing
+        if (!assets::load_failed(loaded))
+            put_loaded_asset(asset, id);
+        ++i;
+    }
+}
+
+/// Where and when the assets of a type were last saved to or loaded from.
+struct SaveState {
+    fs::path project_path;
+    /// Value of the modification epoch at that point.
+    u64 epoch = 0;
+};
+
+template<typename AssetT> SaveState& get_save_state() {
+    static SaveState state;
+    return state;
+}
+
+/// Starts reading and parsing every asset file of a type in the worker threads, since that doesn't
+/// require the GL context nor the asset containers.
+/// @returns The assets being prepared, or nothing if the project has no assets of this type.
+template<typename AssetT>
+std::optional<PreparedAssets<AssetT>> start_loading_assets(fs::path const& project_path) {
+    namespace mfd = meta_file_definitions;
     std::string meta_filename = assets::AssetDirName<AssetT>::value.data();
     meta_filename += ".json";
-    if (!fs::exists(project_path / detail::project_file_definitions::metadata_path / meta_filename))
-        return;
+    if (!fs::exists(project_path / project_file_definitions::metadata_path / meta_filename))
+        return std::nullopt;
     // Read meta document
-    std::ifstream f(project_path / detail::project_file_definitions::metadata_path / meta_filename);
+    std::ifstream f(project_path / project_file_definitions::metadata_path / meta_filename);
     std::stringstream buffer;
     buffer << f.rdbuf();
 
     rapidjson::Document doc;
     doc.Parse(buffer.str().data());
 
-    std::size_t i = 0;
+    PreparedAssets<AssetT> prepared_assets;
+    prepared_assets.reserve(doc.GetArray().Size());
     for (auto const& asset_meta : doc.GetArray()) {
         const auto id = asset_meta.GetObject()[mfd::id_json_key.data()].GetUint64();
-        per_step_func(assets::AssetDirName<AssetT>::value,
-                      static_cast<float>(i) / static_cast<float>(doc.GetArray().Size()));
         const fs::path path =
             project_path / asset_meta.GetObject()[mfd::path_json_key.data()].GetString();
+        prepared_assets.emplace_back(id, get_load_thread_pool().submit([path, id]() {
+            load_profiler::AssetScope profile(assets::AssetDirName<AssetT>::value, id);
+            return assets::raw_prepare_load<AssetT>({path});
+        }));
+    }
+    return prepared_assets;
+}
+
+/// Finishes the assets started by start_loading_assets() in the calling thread, which is where the
+/// GPU uploads happen.
+template<typename AssetT, typename PerStepF>
+void finish_loading_assets(fs::path const& project_path,
+                           PreparedAssets<AssetT>& prepared_assets,
+                           PerStepF const& per_step_func) {
+    finish_prepared_assets(prepared_assets, per_step_func);
+    get_save_state<AssetT>() = {project_path, ::arpiyi::detail::modification_epoch()};
+}
+
+/// Same as start_loading_assets(), but for the assets of a type contained in a pack. The pack must
+/// stay open until the assets are finished.
+template<typename AssetT>
+PreparedAssets<AssetT> start_loading_packed_assets(pack::PackFile const& pack) {
+    const auto [begin, end] = pack.get_entries(assets::AssetDirName<AssetT>::value);
+    PreparedAssets<AssetT> prepared_assets;
+    prepared_assets.reserve(end - begin);
+    for (auto const* entry = begin; entry != end; ++entry) {
+        const std::string_view data = pack.get_data(*entry);
+        const u64 id = entry->id;
+        prepared_assets.emplace_back(id, get_load_thread_pool().submit([data, id]() {
+            load_profiler::AssetScope profile(assets::AssetDirName<AssetT>::value, id);
+            return pack::prepare_packed_load<AssetT>(data);
+        }));
+    }
+    return prepared_assets;
+}
+
+/// Slot for the assets of a type being prepared while loading a dependency level.
+template<typename AssetT>
+using LevelSlot = std::conditional_t<assets::AssetInfo<AssetT>::serialize,
+                                     std::optional<PreparedAssets<AssetT>>,
+                                     std::monostate>;
+
+/// Loads all the serializable types of a dependency level: Every type in the level is started
+/// with start(type_tag) before any of them is finished with finish(type_tag, prepared_assets).
+template<typename... AssetTs, typename StartF, typename FinishF>
+void load_level(util::type_list<AssetTs...> types,
+                std::size_t level,
+                StartF const& start,
+                FinishF const& finish) {
+    std::tuple<LevelSlot<AssetTs>...> prepared_assets;
+    util::for_each_type(types, [&](auto tag) {
+        using AssetT = typename decltype(tag)::type;
+        if constexpr (assets::AssetInfo<AssetT>::serialize) {
+            if (assets::AssetInfo<AssetT>::load_level == level)
+                std::get<LevelSlot<AssetT>>(prepared_assets) = start(tag);
+        }
+    });
+    util::for_each_type(types, [&](auto tag) {
+        using AssetT = typename decltype(tag)::type;
+        if constexpr (assets::AssetInfo<AssetT>::serialize) {
+            if (auto& prepared = std::get<LevelSlot<AssetT>>(prepared_assets))
+                finish(tag, *prepared);
+        }
+    });
+}
+
+template<typename... AssetTs>
+constexpr std::size_t count_serializable_assets(util::type_list<AssetTs...>) {
+    return (static_cast<std::size_t>(assets::AssetInfo<AssetTs>::serialize) + ... + 0);
+}
+
+template<typename... AssetTs> constexpr std::size_t count_load_levels(util::type_list<AssetTs...>) {
+    std::size_t levels = 0;
+    ((levels = assets::AssetInfo<AssetTs>::serialize
+                   ? std::max(levels, assets::AssetInfo<AssetTs>::load_level + 1)
+                   : levels),
+     ...);
+    return levels;
+}
+
+} // namespace detail
+
+/// per_step_func is called as per_step_func(std::string_view progress_string, float progress) with
+/// progress from 0 to 1, like in every other load function.
+template<typename AssetT, typename PerStepF>
+void load_assets(fs::path const& project_path, PerStepF const& per_step_func) {
+    if (auto prepared_assets = detail::start_loading_assets<AssetT>(project_path))
+        detail::finish_loading_assets<AssetT>(project_path, *prepared_assets, per_step_func);
+}
+
+/// Loads all the assets of a type contained in a pack and places them in their container.
+/// The pack must stay open until this function returns.
+template<typename AssetT, typename PerStepF>
+void load_packed_assets(pack::PackFile const& pack, PerStepF const& per_step_func) {
+    auto prepared_assets = detail::start_loading_packed_assets<AssetT>(pack);
+    detail::finish_prepared_assets(prepared_assets, per_step_func);
+}
+
+/// Loads assets one by one on demand instead of all of them at once, from either a project folder
+/// or a pack file. The asset index (The metadata files of a folder, or the table of contents of a
+/// pack) is read up front, and the pack is kept mapped for as long as the source is alive.
+class AssetSource {
+public:
+    /// Opens a project folder or pack file. Check is_open() afterwards to know if it succeeded.
+    explicit AssetSource(fs::path const& path);
+
+    [[nodiscard]] bool is_open() const;
+    /// Parses the project file of the source.
+    [[nodiscard]] rapidjson::Document read_project_file() const;
+
+    /// Loads the asset with the given ID and places it in its container. Assets already loaded are
+    /// not loaded again.
+    /// @returns A handle to the asset, or a null handle if the source doesn't contain it or it
+    /// could not be loaded.
+    template<typename AssetT> Handle<AssetT> load(u64 id) const {
+        if (Handle<AssetT>(id).get())
+            return id;
+
+        const std::string_view type_name = assets::AssetDirName<AssetT>::value;
+        if (pack) {
+            auto const* entry = pack->find(type_name, id);
+            if (!entry)
+                return {};
+            return place<AssetT>(id, [&]() {
+                load_profiler::AssetScope profile(type_name, id);
+                return pack::prepare_packed_load<AssetT>(pack->get_data(*entry));
+            }());
+        } else {
+            auto const* path = find_path(type_name, id);
+            if (!path)
+                return {};
+            return place<AssetT>(id, [&]() {
+                load_profiler::AssetScope profile(type_name, id);
+                return assets::raw_prepare_load<AssetT>({*path});
+            }());
+        }
+    }
+
+private:
+    template<typename AssetT>
+    static Handle<AssetT> place(u64 id, assets::PreparedLoad<AssetT>&& prepared) {
         AssetT asset;
-        assets::raw_load(asset, {path});
-        asset_manager::put(asset, id);
-        ++i;
+        {
+            load_profiler::AssetScope profile(assets::AssetDirName<AssetT>::value, id);
+            assets::raw_finish_load(asset, std::move(prepared));
+        }
+        if (assets::load_failed(prepared))
+            return {};
+        return detail::put_loaded_asset(asset, id);
     }
+
+    [[nodiscard]] fs::path const* find_path(std::string_view type_name, u64 id) const;
+
+    fs::path project_path;
+    std::unique_ptr<pack::PackFile> pack;
+    /// Path of every asset in the project folder, by asset directory name and ID.
+    std::unordered_map<std::string, std::unordered_map<u64, fs::path>> asset_paths;
 };
 
-template<typename AssetT>
-void save_assets(fs::path const& project_path,
-                 std::function<void(std::string_view /* progress string */,
-                                    float /* progress (0~1) */)> const& per_step_func) {
-    rapidjson::StringBuffer s;
-    rapidjson::Writer<rapidjson::StringBuffer> meta(s);
+/// Assets captured for saving them in the background while they keep being edited.
+/// See snapshot_all_assets().
+class SaveTask {
+public:
+    virtual ~SaveTask() = default;
+
+    /// Completes the snapshots of the assets that couldn't be captured at once, like GPU
+    /// readbacks. Returns true once all of them are complete. Must be called from the main
+    /// thread, once per frame until it returns true.
+    virtual bool poll() = 0;
+    /// Writes the captured assets to the project folder. Can be called from any thread once poll()
+    /// has returned true.
+    virtual void write(std::function<void(std::string_view /* progress string */,
+                                          float /* progress (0~1) */)> const& per_step_func) = 0;
+};
+
+namespace detail {
+
+template<typename AssetT> fs::path get_asset_relative_path(u64 id) {
+    const std::string asset_filename = std::to_string(id) + ".asset";
+    return fs::path(assets::AssetDirName<AssetT>::value) / asset_filename;
+}
+
+template<typename AssetT> class AssetSaveTask : public SaveTask {
+public:
+    bool poll() override {
+        bool complete = true;
+        for (auto& [id, snapshot] : snapshots)
+            complete &= assets::raw_poll_save_snapshot(snapshot);
+        return complete;
+    }
+
+    void write(std::function<void(std::string_view, float)> const& per_step_func) override {
+        namespace mfd = detail::meta_file_definitions;
+
+        std::size_t i = 0;
+        for (auto const& [id, snapshot] : snapshots) {
+            const fs::path relative_path = get_asset_relative_path<AssetT>(id);
+            const fs::path asset_path = project_path / relative_path;
+            fs::create_directories(asset_path.parent_path());
+            assets::RawSaveData data = assets::raw_get_snapshot_save_data(snapshot);
+            std::ofstream f(asset_path, std::ios::binary);
+            f << data.bytestream.rdbuf();
+            per_step_func(relative_path.generic_string(),
+                          static_cast<float>(i) / static_cast<float>(snapshots.size()));
+            ++i;
+        }
+
+        if (!write_meta)
+            return;
+
+        // Delete the files of the assets that were removed since the last save
+        if (fs::exists(meta_path)) {
+            std::ifstream f(meta_path);
+            std::stringstream buffer;
+            buffer << f.rdbuf();
+
+            rapidjson::Document old_meta;
+            old_meta.Parse(buffer.str().data());
+            if (!old_meta.HasParseError() && old_meta.IsArray()) {
+                for (auto const& asset_meta : old_meta.GetArray()) {
+                    const auto id = asset_meta.GetObject()[mfd::id_json_key.data()].GetUint64();
+                    if (!std::binary_search(ids.begin(), ids.end(), id))
+                        fs::remove(project_path /
+                                   asset_meta.GetObject()[mfd::path_json_key.data()].GetString());
+                }
+            }
+        }
+
+        rapidjson::StringBuffer s;
+        rapidjson::Writer<rapidjson::StringBuffer> meta(s);
+        meta.StartArray();
+        for (const u64 id : ids) {
+            meta.StartObject();
+            meta.Key(mfd::id_json_key.data());
+            meta.Uint64(id);
+            meta.Key(mfd::path_json_key.data());
+            meta.String(get_asset_relative_path<AssetT>(id).generic_string().c_str());
+            meta.EndObject();
+        }
+        meta.EndArray();
+
+        fs::create_directories(meta_path.parent_path());
+        std::ofstream meta_file(meta_path);
+        meta_file << s.GetString();
+    }
+
+    fs::path project_path;
+    fs::path meta_path;
+    std::vector<std::pair<u64, assets::SaveSnapshot<AssetT>>> snapshots;
+    /// Whether assets were added or removed, and the metadata file needs to be rewritten.
+    bool write_meta = false;
+    /// IDs of all the assets of the type, sorted. Only filled if write_meta is true.
+    std::vector<u64> ids;
+};
+
+} // namespace detail
+
+/// Captures the assets of a type that need to be saved to a project folder: The ones modified
+/// since they were last saved to or loaded from that same folder. The metadata file is only
+/// rewritten if assets were added or removed, and the files of removed assets are deleted.
+/// Assets modified after this call are saved the next time.
+template<typename AssetT> std::unique_ptr<SaveTask> snapshot_assets(fs::path const& project_path) {
     namespace pfd = detail::project_file_definitions;
-    namespace mfd = detail::meta_file_definitions;
 
     const auto& container = ::arpiyi::detail::AssetContainer<AssetT>::get_instance();
+    auto& save_state = detail::get_save_state<AssetT>();
 
-    std::size_t i = 0;
-    meta.StartArray();
-    for (auto const& [id, asset] : container.map) {
-        const std::string asset_filename = std::to_string(id) + ".asset";
-        const fs::path asset_path =
-            project_path / assets::AssetDirName<AssetT>::value / asset_filename;
-        fs::create_directories(asset_path.parent_path());
-        assets::RawSaveData data = assets::raw_get_save_data(asset);
-        std::ofstream f(asset_path);
-        f << data.bytestream.rdbuf();
-
-        // Add metadata object
-        meta.StartObject();
-        meta.Key(mfd::id_json_key.data());
-        meta.Uint64(id);
-        meta.Key(mfd::path_json_key.data());
-        std::string const relative_path = fs::relative(asset_path, project_path).generic_string();
-        meta.String(relative_path.c_str());
-        meta.EndObject();
-
-        per_step_func(relative_path,
-                      1.f / static_cast<float>(container.map.size()) * static_cast<float>(i));
-        ++i;
+    auto task = std::make_unique<detail::AssetSaveTask<AssetT>>();
+    std::string meta_filename = assets::AssetDirName<AssetT>::value.data();
+    meta_filename += ".json";
+    task->project_path = project_path;
+    task->meta_path = project_path / pfd::metadata_path / meta_filename;
+    const bool full_save = save_state.project_path != project_path || !fs::exists(task->meta_path);
+
+    for (auto const& entry : container.storage) {
+        if (full_save || container.storage.get_modification_epoch(entry.id) > save_state.epoch)
+            task->snapshots.emplace_back(entry.id, assets::raw_make_save_snapshot(entry.asset));
     }
-    meta.EndArray();
 
-    {
-        std::string meta_filename = assets::AssetDirName<AssetT>::value.data();
-        meta_filename += ".json";
-        fs::create_directories(project_path / pfd::metadata_path);
-        std::ofstream meta_file(project_path / pfd::metadata_path / meta_filename);
-        meta_file << s.GetString();
+    if (full_save || container.membership_epoch > save_state.epoch) {
+        task->write_meta = true;
+        for (auto const& entry : container.storage) task->ids.emplace_back(entry.id);
+        std::sort(task->ids.begin(), task->ids.end());
     }
+
+    save_state = {project_path, ::arpiyi::detail::modification_epoch()};
+    return task;
 }
 
-/// The number of asset structs that are marked with the [[assets::serialize]]
-/// attribute.
-extern const std::size_t serializable_assets;
-
-/// Loads one single asset type from a project folder and places the results in the
-/// corresponding asset container. The "One single asset type" is useful for
-/// simulating coroutines.
-/// You can call this function with indices from 0 to <serializable_assets> to load
-/// all assets.
-void load_one_asset_type(std::size_t asset_type_index,
-                         fs::path project_path,
-                         std::function<void(std::string_view /* progress string */,
-                                            float /* progress (0~1) */)> per_step_func);
-
-/// Saves one single asset type from its container to a project folder.
-/// The "One single asset type" is useful for simulating coroutines.
-/// You can call this function with indices from 0 to <serializable_assets> to save
-/// all assets.
-void save_one_asset_type(std::size_t asset_type_index,
-                         fs::path project_path,
-                         std::function<void(std::string_view /* progress string */,
-                                            float /* progress (0~1) */)> per_step_func);
+/// Writes the assets of a type to a project folder right away. See snapshot_assets() for which
+/// assets are written.
+template<typename AssetT>
+void save_assets(fs::path const& project_path,
+                 std::function<void(std::string_view /* progress string */,
+                                    float /* progress (0~1) */)> const& per_step_func) {
+    auto task = snapshot_assets<AssetT>(project_path);
+    while (!task->poll()) {}
+    task->write(per_step_func);
+}
+
+/// The number of asset structs that are marked with the [[assets::serialize]] attribute.
+constexpr std::size_t serializable_assets = detail::count_serializable_assets(assets::all_assets{});
+
+/// The number of dependency levels of the asset types, as given by [[assets::load_before]].
+/// Types only depend on types of previous levels.
+constexpr std::size_t load_levels = detail::count_load_levels(assets::all_assets{});
+
+/// Loads all the asset types of a dependency level from a project folder at the same time: The
+/// files of every type in the level are read and parsed in the load thread pool at once, and only
+/// finishing them (GPU uploads, placing them in their containers) is done in the calling thread.
+/// The "One single level" is useful for simulating coroutines.
+/// You must call this function with levels from 0 to <load_levels>, in order.
+template<typename PerStepF>
+void load_one_level(std::size_t level, fs::path const& project_path, PerStepF const& per_step_func) {
+    detail::load_level(
+        assets::all_assets{}, level,
+        [&](auto tag) {
+            return detail::start_loading_assets<typename decltype(tag)::type>(project_path);
+        },
+        [&](auto tag, auto& prepared_assets) {
+            detail::finish_loading_assets<typename decltype(tag)::type>(
+                project_path, prepared_assets, per_step_func);
+        });
+}
+
+/// Same as load_one_level(), but loads the assets from a pack file instead of a project folder.
+template<typename PerStepF>
+void load_one_packed_level(std::size_t level,
+                           pack::PackFile const& pack,
+                           PerStepF const& per_step_func) {
+    detail::load_level(
+        assets::all_assets{}, level,
+        [&](auto tag) {
+            return detail::start_loading_packed_assets<typename decltype(tag)::type>(pack);
+        },
+        [&](auto, auto& prepared_assets) {
+            detail::finish_prepared_assets(prepared_assets, per_step_func);
+        });
+}
+
+/// Loads every asset type from a project folder, one dependency level after another.
+template<typename PerStepF>
+void load_all_parallel(fs::path const& project_path, PerStepF const& per_step_func) {
+    for (std::size_t level = 0; level < load_levels; ++level)
+        load_one_level(level, project_path, per_step_func);
+}
+
+/// Same as load_all_parallel(), but loads the assets from a pack file. The pack must stay open
+/// until this function returns.
+template<typename PerStepF>
+void load_all_packed_parallel(pack::PackFile const& pack, PerStepF const& per_step_func) {
+    for (std::size_t level = 0; level < load_levels; ++level)
+        load_one_packed_level(level, pack, per_step_func);
+}
+
+/// Writes every asset type to a project folder right away. See save_assets().
+template<typename PerStepF>
+void save_all_assets(fs::path const& project_path, PerStepF const& per_step_func) {
+    util::for_each_type(assets::all_assets{}, [&](auto tag) {
+        using AssetT = typename decltype(tag)::type;
+        if constexpr (assets::AssetInfo<AssetT>::serialize)
+            save_assets<AssetT>(project_path, per_step_func);
+    });
+}
+
+/// Captures every asset type for saving it to a project folder in the background, one task per
+/// type. See snapshot_assets().
+inline std::vector<std::unique_ptr<SaveTask>> snapshot_all_assets(fs::path const& project_path) {
+    std::vector<std::unique_ptr<SaveTask>> tasks;
+    util::for_each_type(assets::all_assets{}, [&](auto tag) {
+        using AssetT = typename decltype(tag)::type;
+        if constexpr (assets::AssetInfo<AssetT>::serialize)
+            tasks.emplace_back(snapshot_assets<AssetT>(project_path));
+    });
+    return tasks;
+}
 
 } // namespace arpiyi::serializer
 
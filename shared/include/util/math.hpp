@@ -26,6 +26,15 @@ struct Rect2D {
     Vec2D end;
 };
 
+/// Integer rectangle. `end` is exclusive.
+struct IRect2D {
+    IVec2D start;
+    IVec2D end;
+
+    [[nodiscard]] i32 width() const { return end.x - start.x; }
+    [[nodiscard]] i32 height() const { return end.y - start.y; }
+};
+
 }
 
 #endif // ARPIYI_MATH_HPP
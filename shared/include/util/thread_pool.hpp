@@ -0,0 +1,79 @@
+#ifndef ARPIYI_THREAD_POOL_HPP
+#define ARPIYI_THREAD_POOL_HPP
+
+#include <algorithm>
+#include <condition_variable>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+namespace arpiyi::util {
+
+/// Fixed amount of worker threads that run the tasks submitted to them in FIFO order.
+class ThreadPool {
+public:
+    explicit ThreadPool(std::size_t thread_count = std::max(1u, std::thread::hardware_concurrency())) {
+        for (std::size_t i = 0; i < thread_count; ++i) {
+            workers.emplace_back([this]() {
+                while (true) {
+                    std::function<void()> task;
+                    {
+                        std::unique_lock lock(mutex);
+                        condition.wait(lock, [this]() { return stopping || !tasks.empty(); });
+                        if (stopping && tasks.empty())
+                            return;
+                        task = std::move(tasks.front());
+                        tasks.pop();
+                    }
+                    task();
+                }
+            });
+        }
+    }
+
+    ThreadPool(ThreadPool const&) = delete;
+    ThreadPool& operator=(ThreadPool const&) = delete;
+
+    /// Waits for all the tasks submitted to finish before returning.
+    ~ThreadPool() {
+        {
+            std::lock_guard lock(mutex);
+            stopping = true;
+        }
+        condition.notify_all();
+        for (auto& worker : workers) worker.join();
+    }
+
+    /// Queues a task to be run in one of the worker threads.
+    /// @returns A future containing the result of the task, or the exception it threw.
+    template<typename F> std::future<std::invoke_result_t<F>> submit(F&& func) {
+        // std::function requires copyable callables, so keep the task itself in a shared_ptr
+        auto task =
+            std::make_shared<std::packaged_task<std::invoke_result_t<F>()>>(std::forward<F>(func));
+        auto future = task->get_future();
+        {
+            std::lock_guard lock(mutex);
+            tasks.emplace([task]() { (*task)(); });
+        }
+        condition.notify_one();
+        return future;
+    }
+
+    [[nodiscard]] std::size_t get_thread_count() const { return workers.size(); }
+
+private:
+    std::vector<std::thread> workers;
+    std::queue<std::function<void()>> tasks;
+    std::mutex mutex;
+    std::condition_variable condition;
+    bool stopping = false;
+};
+
+} // namespace arpiyi::util
+
+#endif // ARPIYI_THREAD_POOL_HPP
@@ -0,0 +1,23 @@
+#ifndef ARPIYI_TYPE_LIST_HPP
+#define ARPIYI_TYPE_LIST_HPP
+
+#include <cstddef>
+
+namespace arpiyi::util {
+
+template<typename T> struct type_tag {
+    using type = T;
+};
+
+template<typename... Ts> struct type_list {
+    constexpr static std::size_t size = sizeof...(Ts);
+};
+
+/// Calls the given function with a type_tag of every type in the list, in order.
+template<typename... Ts, typename F> constexpr void for_each_type(type_list<Ts...>, F&& func) {
+    (func(type_tag<Ts>{}), ...);
+}
+
+} // namespace arpiyi::util
+
+#endif // ARPIYI_TYPE_LIST_HPP
@@ -1,4 +1,5 @@
 #include "api/api.hpp"
+#include "api/lua_bindings_cg.hpp" // codegen
 #include "assets/entity.hpp"
 #include "assets/sprite.hpp"
 #include "util/math.hpp"
@@ -97,25 +98,14 @@ void define_camera(sol::state_view& s) {
 }
 
 void define_sprite(sol::state_view& s) {
-    /* clang-format off */
     sol::table game_table = s["game"];
-    game_table.new_usertype<assets::Sprite>("Sprite",
-                                          "pivot", &assets::Sprite::pivot,
-                                          "name", sol::readonly(&assets::Sprite::name),
-                                          "pixel_size", sol::readonly_property(&assets::Sprite::get_size_in_pixels)
-    );
-    /* clang-format on */
+    auto sprite_type = define_usertype<assets::Sprite>(game_table);
+    sprite_type["pixel_size"] = sol::readonly_property(&assets::Sprite::get_size_in_pixels);
 }
 
 void define_entity(sol::state_view& s) {
-    /* clang-format off */
     sol::table game_table = s["game"];
-    game_table.new_usertype<assets::Entity>("Entity",
-                                            "pos", &assets::Entity::pos,
-                                            "name", &assets::Entity::name,
-                                            "sprite", &assets::Entity::sprite
-    );
-    /* clang-format on */
+    define_usertype<assets::Entity>(game_table);
 }
 
 void define_screen_layer(sol::state_view& s) {
@@ -364,6 +354,8 @@ void define_game_play_data(GamePlayData& data, sol::state_view& s) {
     });
     game_table.set_function("add_default_map_layer",
                             [&data]() -> decltype(auto) { return data.add_default_map_layer(); });
+    game_table.set_function("change_map",
+                            [](u64 map_id) { return change_map(Handle<assets::Map>(map_id)); });
 }
 
 void define_api(GamePlayData& data, sol::state_view& s) {
@@ -50,12 +50,15 @@ template<> RawSaveData raw_get_save_data<Entity>(Entity const& entity) {
 }
 
 template<> void raw_load<Entity>(Entity& entity, LoadParams<Entity> const& params) {
-    std::ifstream f(params.path);
-    std::stringstream buffer;
-    buffer << f.rdbuf();
+    raw_finish_load(entity, raw_prepare_load(params));
+}
+
+template<> PreparedLoad<Entity> raw_prepare_load<Entity>(LoadParams<Entity> const& params) {
+    return {{parse_json_file(params.path)}};
+}
 
-    rapidjson::Document doc;
-    doc.Parse(buffer.str().data());
+template<> void raw_finish_load<Entity>(Entity& entity, PreparedLoad<Entity>&& prepared) {
+    auto const& doc = prepared.doc;
 
     using namespace entity_file_definitions;
 
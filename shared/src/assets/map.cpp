@@ -1,63 +1,99 @@
 #include "assets/map.hpp"
 #include "global_tile_size.hpp"
+#include "load_profiler.hpp"
 
-#include <rapidjson/document.h>
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <limits>
+#include <rapidjson/filereadstream.h>
+#include <rapidjson/memorystream.h>
+#include <rapidjson/reader.h>
 #include <rapidjson/stringbuffer.h>
 #include <rapidjson/writer.h>
+#include <stb_image.h>
+#include <stb_zlib_compress.h>
 
 namespace arpiyi::assets {
 
+// Format: {pos.x pos.y uv.x uv.y ...}
+// 2 because it's 2 position coords and 2 UV coords.
+constexpr auto sizeof_vertex = 4;
+constexpr auto sizeof_triangle = 3 * sizeof_vertex;
+constexpr auto sizeof_quad = 2 * sizeof_triangle;
+
+/// Maximum amount of clean tiles between two dirty ranges for them to be uploaded together.
+/// Reuploading a few unchanged quads is cheaper than issuing another glBufferSubData call.
+constexpr u64 max_dirty_range_gap = 16;
+
+/// Per-instance data of the instanced renderer. Tile positions are stored in tiles instead of
+/// normalized coordinates, so they stay exact no matter how big the map is.
+struct TileInstance {
+    u16 x, y;
+    u32 id;
+};
+static_assert(sizeof(TileInstance) == 8);
+
+/// Unit quad shared by the instance meshes of all layers.
+static Handle<Mesh> get_unit_quad() {
+    static Handle<Mesh> quad;
+    if (!quad.get())
+        quad = asset_manager::put(Mesh::generate_quad());
+    return quad;
+}
+
+void Map::Layer::generate_tile_quad(float* quad, i64 x, i64 y, Tileset const& tl) const {
+    const float x_slice_size = 1.f / width;
+    const float y_slice_size = 1.f / height;
+    const float min_vertex_x_pos = static_cast<float>(x) * x_slice_size;
+    const float min_vertex_y_pos = static_cast<float>(height - y - 1) * y_slice_size;
+    const float max_vertex_x_pos = min_vertex_x_pos + x_slice_size;
+    const float max_vertex_y_pos = min_vertex_y_pos + y_slice_size;
+
+    const math::Rect2D uv_pos = tl.get_uv((*tiles)[x + y * width].id);
+
+    // First triangle //
+    /* X pos 1st vertex */ quad[0] = min_vertex_x_pos;
+    /* Y pos 1st vertex */ quad[1] = min_vertex_y_pos;
+    /* X UV 1st vertex  */ quad[2] = uv_pos.start.x;
+    /* Y UV 1st vertex  */ quad[3] = uv_pos.start.y;
+    /* X pos 2nd vertex */ quad[4] = max_vertex_x_pos;
+    /* Y pos 2nd vertex */ quad[5] = min_vertex_y_pos;
+    /* X UV 2nd vertex  */ quad[6] = uv_pos.end.x;
+    /* Y UV 2nd vertex  */ quad[7] = uv_pos.start.y;
+    /* X pos 3rd vertex */ quad[8] = min_vertex_x_pos;
+    /* Y pos 3rd vertex */ quad[9] = max_vertex_y_pos;
+    /* X UV 2nd vertex  */ quad[10] = uv_pos.start.x;
+    /* Y UV 2nd vertex  */ quad[11] = uv_pos.end.y;
+
+    // Second triangle //
+    /* X pos 1st vertex */ quad[12] = max_vertex_x_pos;
+    /* Y pos 1st vertex */ quad[13] = min_vertex_y_pos;
+    /* X UV 1st vertex  */ quad[14] = uv_pos.end.x;
+    /* Y UV 1st vertex  */ quad[15] = uv_pos.start.y;
+    /* X pos 2nd vertex */ quad[16] = max_vertex_x_pos;
+    /* Y pos 2nd vertex */ quad[17] = max_vertex_y_pos;
+    /* X UV 2nd vertex  */ quad[18] = uv_pos.end.x;
+    /* Y UV 2nd vertex  */ quad[19] = uv_pos.end.y;
+    /* X pos 3rd vertex */ quad[20] = min_vertex_x_pos;
+    /* Y pos 3rd vertex */ quad[21] = max_vertex_y_pos;
+    /* X UV 3rd vertex  */ quad[22] = uv_pos.start.x;
+    /* Y UV 3rd vertex  */ quad[23] = uv_pos.end.y;
+}
+
 Mesh Map::Layer::generate_layer_split_quad() {
-    // Format: {pos.x pos.y uv.x uv.y ...}
-    // 2 because it's 2 position coords and 2 UV coords.
-    constexpr auto sizeof_vertex = 4;
-    constexpr auto sizeof_triangle = 3 * sizeof_vertex;
-    constexpr auto sizeof_quad = 2 * sizeof_triangle;
     const auto sizeof_splitted_quad = height * width * sizeof_quad;
 
     std::vector<float> result(sizeof_splitted_quad);
-    const float x_slice_size = 1.f / width;
-    const float y_slice_size = 1.f / height;
     assert(tileset.get());
     const auto& tl = *tileset.get();
     // Create a quad for each {x, y} position.
     for (int y = 0; y < height; y++) {
         for (int x = 0; x < width; x++) {
-            const float min_vertex_x_pos = static_cast<float>(x) * x_slice_size;
-            const float min_vertex_y_pos = static_cast<float>((int)height - y - 1) * y_slice_size;
-            const float max_vertex_x_pos = min_vertex_x_pos + x_slice_size;
-            const float max_vertex_y_pos = min_vertex_y_pos + y_slice_size;
-
-            const math::Rect2D uv_pos = tl.get_uv(get_tile({x, y}).id);
-
-            const auto quad_n = (x + y * width) * sizeof_quad;
-            // First triangle //
-            /* X pos 1st vertex */ result[quad_n + 0] = min_vertex_x_pos;
-            /* Y pos 1st vertex */ result[quad_n + 1] = min_vertex_y_pos;
-            /* X UV 1st vertex  */ result[quad_n + 2] = uv_pos.start.x;
-            /* Y UV 1st vertex  */ result[quad_n + 3] = uv_pos.start.y;
-            /* X pos 2nd vertex */ result[quad_n + 4] = max_vertex_x_pos;
-            /* Y pos 2nd vertex */ result[quad_n + 5] = min_vertex_y_pos;
-            /* X UV 2nd vertex  */ result[quad_n + 6] = uv_pos.end.x;
-            /* Y UV 2nd vertex  */ result[quad_n + 7] = uv_pos.start.y;
-            /* X pos 3rd vertex */ result[quad_n + 8] = min_vertex_x_pos;
-            /* Y pos 3rd vertex */ result[quad_n + 9] = max_vertex_y_pos;
-            /* X UV 2nd vertex  */ result[quad_n + 10] = uv_pos.start.x;
-            /* Y UV 2nd vertex  */ result[quad_n + 11] = uv_pos.end.y;
-
-            // Second triangle //
-            /* X pos 1st vertex */ result[quad_n + 12] = max_vertex_x_pos;
-            /* Y pos 1st vertex */ result[quad_n + 13] = min_vertex_y_pos;
-            /* X UV 1st vertex  */ result[quad_n + 14] = uv_pos.end.x;
-            /* Y UV 1st vertex  */ result[quad_n + 15] = uv_pos.start.y;
-            /* X pos 2nd vertex */ result[quad_n + 16] = max_vertex_x_pos;
-            /* Y pos 2nd vertex */ result[quad_n + 17] = max_vertex_y_pos;
-            /* X UV 2nd vertex  */ result[quad_n + 18] = uv_pos.end.x;
-            /* Y UV 2nd vertex  */ result[quad_n + 19] = uv_pos.end.y;
-            /* X pos 3rd vertex */ result[quad_n + 20] = min_vertex_x_pos;
-            /* Y pos 3rd vertex */ result[quad_n + 21] = max_vertex_y_pos;
-            /* X UV 3rd vertex  */ result[quad_n + 22] = uv_pos.start.x;
-            /* Y UV 3rd vertex  */ result[quad_n + 23] = uv_pos.end.y;
+            generate_tile_quad(&result[get_quad_index(x, y) * sizeof_quad], x, y, tl);
         }
     }
 
@@ -67,9 +103,10 @@ Mesh Map::Layer::generate_layer_split_quad() {
     glGenBuffers(1, &vbo);
 
     // Fill buffer
+    // Dynamic since tiles changed afterwards are patched directly into the buffer
     glBindBuffer(GL_ARRAY_BUFFER, vbo);
     glBufferData(GL_ARRAY_BUFFER, sizeof_splitted_quad * sizeof(float), result.data(),
-                 GL_STATIC_DRAW);
+                 GL_DYNAMIC_DRAW);
 
     glBindVertexArray(vao);
     // Vertex Positions
@@ -87,17 +124,371 @@ Mesh Map::Layer::generate_layer_split_quad() {
 }
 
 Map::Layer::Layer(i64 width, i64 height, Handle<assets::Tileset> t) :
-    tileset(t), width(width), height(height), tiles(width * height) {
-    regenerate_mesh();
+    tileset(t), width(width), height(height),
+    tiles(std::make_shared<std::vector<Tile>>(width * height)) {}
+
+std::vector<Map::Tile>& Map::Layer::get_writable_tiles() {
+    if (tiles.use_count() > 1)
+        tiles = std::make_shared<std::vector<Tile>>(*tiles);
+    return *tiles;
+}
+
+void Map::Layer::set_tiles(math::IRect2D rect, std::vector<Tile> const& data) {
+    assert(rect.width() >= 0 && rect.height() >= 0);
+    assert(data.size() == static_cast<u64>(rect.width()) * rect.height());
+    const i64 min_x = std::max<i64>(rect.start.x, 0);
+    const i64 min_y = std::max<i64>(rect.start.y, 0);
+    const i64 max_x = std::min<i64>(rect.end.x, width);
+    const i64 max_y = std::min<i64>(rect.end.y, height);
+    if (min_x >= max_x || min_y >= max_y)
+        return;
+
+    auto& dst = get_writable_tiles();
+    for (i64 y = min_y; y < max_y; ++y) {
+        const auto src = data.begin() + (y - rect.start.y) * rect.width() + (min_x - rect.start.x);
+        std::copy(src, src + (max_x - min_x), dst.begin() + y * width + min_x);
+    }
+
+    mark_texture_dirty({{static_cast<i32>(min_x), static_cast<i32>(min_y)},
+                        {static_cast<i32>(max_x), static_cast<i32>(max_y)}});
+
+    // Go chunk by chunk so that rows of the same chunk get merged into a single dirty range
+    for (i64 chunk_y = min_y / chunk_size; chunk_y <= (max_y - 1) / chunk_size; ++chunk_y) {
+        for (i64 chunk_x = min_x / chunk_size; chunk_x <= (max_x - 1) / chunk_size; ++chunk_x) {
+            const i64 seg_min_x = std::max(min_x, chunk_x * chunk_size);
+            const i64 seg_max_x = std::min(max_x, (chunk_x + 1) * chunk_size);
+            const i64 seg_min_y = std::max(min_y, chunk_y * chunk_size);
+            const i64 seg_max_y = std::min(max_y, (chunk_y + 1) * chunk_size);
+            for (i64 y = seg_min_y; y < seg_max_y; ++y) {
+                const u64 quad = get_quad_index(seg_min_x, y);
+                mark_dirty(quad, quad + (seg_max_x - seg_min_x));
+            }
+        }
+    }
+}
+
+u64 Map::Layer::get_quad_index(i64 x, i64 y) const {
+    const i64 chunk_x = x / chunk_size, chunk_y = y / chunk_size;
+    // Chunks on the right and bottom edges may be smaller than chunk_size
+    const i64 chunk_width = std::min(chunk_size, width - chunk_x * chunk_size);
+    const i64 chunk_height = std::min(chunk_size, height - chunk_y * chunk_size);
+    return chunk_y * chunk_size * width + chunk_x * chunk_size * chunk_height +
+           (y % chunk_size) * chunk_width + x % chunk_size;
+}
+
+math::IVec2D Map::Layer::get_quad_tile_pos(u64 quad) const {
+    const i64 chunk_row_quads = chunk_size * width;
+    const i64 chunk_y = quad / chunk_row_quads;
+    const i64 chunk_height = std::min(chunk_size, height - chunk_y * chunk_size);
+    const i64 quad_in_chunk_row = quad % chunk_row_quads;
+    const i64 chunk_x = quad_in_chunk_row / (chunk_size * chunk_height);
+    const i64 chunk_width = std::min(chunk_size, width - chunk_x * chunk_size);
+    const i64 quad_in_chunk = quad_in_chunk_row % (chunk_size * chunk_height);
+    return {static_cast<i32>(chunk_x * chunk_size + quad_in_chunk % chunk_width),
+            static_cast<i32>(chunk_y * chunk_size + quad_in_chunk / chunk_width)};
+}
+
+void Map::Layer::push_dirty_range(std::vector<QuadRange>& ranges, u64 begin, u64 end) {
+    if (!ranges.empty()) {
+        auto& last = ranges.back();
+        if (begin >= last.begin && begin <= last.end) {
+            last.end = std::max(last.end, end);
+            return;
+        }
+    }
+    ranges.emplace_back(QuadRange{begin, end});
+}
+
+void Map::Layer::coalesce_ranges(std::vector<QuadRange>& ranges) {
+    if (ranges.empty())
+        return;
+    std::sort(ranges.begin(), ranges.end(),
+              [](QuadRange a, QuadRange b) { return a.begin < b.begin; });
+    std::size_t last = 0;
+    for (std::size_t i = 1; i < ranges.size(); ++i) {
+        if (ranges[i].begin <= ranges[last].end + max_dirty_range_gap) {
+            ranges[last].end = std::max(ranges[last].end, ranges[i].end);
+        } else {
+            ranges[++last] = ranges[i];
+        }
+    }
+    ranges.resize(last + 1);
+}
+
+void Map::Layer::mark_dirty(u64 begin, u64 end) {
+    // Buffers that don't exist yet will be generated whole when needed
+    if (mesh.get())
+        push_dirty_range(dirty_ranges, begin, end);
+    if (instance_mesh.get())
+        push_dirty_range(instance_dirty_ranges, begin, end);
+}
+
+void Map::Layer::mark_texture_dirty(math::IRect2D rect) {
+    // The whole texture will be uploaded when needed
+    if (tile_texture == notexture)
+        return;
+    if (texture_dirty_rect.width() <= 0 || texture_dirty_rect.height() <= 0) {
+        texture_dirty_rect = rect;
+        return;
+    }
+    texture_dirty_rect.start.x = std::min(texture_dirty_rect.start.x, rect.start.x);
+    texture_dirty_rect.start.y = std::min(texture_dirty_rect.start.y, rect.start.y);
+    texture_dirty_rect.end.x = std::max(texture_dirty_rect.end.x, rect.end.x);
+    texture_dirty_rect.end.y = std::max(texture_dirty_rect.end.y, rect.end.y);
+}
+
+void Map::Layer::update_mesh() {
+    if (!tileset.get())
+        return;
+    if (!mesh.get() || !(mesh_tileset == tileset)) {
+        regenerate_mesh();
+        return;
+    }
+    if (dirty_ranges.empty())
+        return;
+
+    const auto& tl = *tileset.get();
+    std::vector<float> patch;
+    glBindBuffer(GL_ARRAY_BUFFER, mesh.get()->vbo);
+    coalesce_ranges(dirty_ranges);
+    for (const auto range : dirty_ranges) {
+        patch.resize((range.end - range.begin) * sizeof_quad);
+        for (u64 i = range.begin; i < range.end; ++i) {
+            const math::IVec2D pos = get_quad_tile_pos(i);
+            generate_tile_quad(&patch[(i - range.begin) * sizeof_quad], pos.x, pos.y, tl);
+        }
+        glBufferSubData(GL_ARRAY_BUFFER, range.begin * sizeof_quad * sizeof(float),
+                        patch.size() * sizeof(float), patch.data());
+    }
+    dirty_ranges.clear();
 }
 
 void Map::Layer::regenerate_mesh() {
     if (tileset.get()) {
+        load_profiler::StageTimer profile(load_profiler::Stage::mesh);
         mesh.unload();
         mesh = asset_manager::put(generate_layer_split_quad());
+        mesh_tileset = tileset;
+        dirty_ranges.clear();
     }
 }
 
+std::vector<Map::Layer::QuadRange>
+Map::Layer::get_visible_quad_ranges(math::IRect2D tile_view) const {
+    std::vector<QuadRange> ranges;
+    const i64 min_x = std::max<i64>(tile_view.start.x, 0);
+    const i64 min_y = std::max<i64>(tile_view.start.y, 0);
+    const i64 max_x = std::min<i64>(tile_view.end.x, width);
+    const i64 max_y = std::min<i64>(tile_view.end.y, height);
+    if (min_x >= max_x || min_y >= max_y)
+        return ranges;
+
+    // Chunks next to each other in the same chunk row are contiguous in the buffer, so each
+    // chunk row can be drawn as a single range.
+    const i64 last_chunk_x = (max_x - 1) / chunk_size;
+    for (i64 chunk_y = min_y / chunk_size; chunk_y <= (max_y - 1) / chunk_size; ++chunk_y) {
+        const i64 chunk_height = std::min(chunk_size, height - chunk_y * chunk_size);
+        const i64 last_chunk_width = std::min(chunk_size, width - last_chunk_x * chunk_size);
+        const u64 first_quad = get_quad_index((min_x / chunk_size) * chunk_size,
+                                              chunk_y * chunk_size);
+        const u64 end_quad = get_quad_index(last_chunk_x * chunk_size, chunk_y * chunk_size) +
+                             last_chunk_width * chunk_height;
+        ranges.emplace_back(QuadRange{first_quad, end_quad});
+    }
+    return ranges;
+}
+
+void Map::Layer::draw_chunks(math::IRect2D tile_view) {
+    update_mesh();
+    if (!mesh.get())
+        return;
+
+    constexpr int quad_verts = 2 * 3;
+    std::vector<GLint> firsts;
+    std::vector<GLsizei> counts;
+    for (const auto range : get_visible_quad_ranges(tile_view)) {
+        firsts.emplace_back(static_cast<GLint>(range.begin * quad_verts));
+        counts.emplace_back(static_cast<GLsizei>((range.end - range.begin) * quad_verts));
+    }
+    if (firsts.empty())
+        return;
+
+    glBindVertexArray(mesh.get()->vao);
+    glMultiDrawArrays(GL_TRIANGLES, firsts.data(), counts.data(),
+                      static_cast<GLsizei>(firsts.size()));
+}
+
+void Map::Layer::update_instances() {
+    assert(width <= std::numeric_limits<u16>::max() + 1 &&
+           height <= std::numeric_limits<u16>::max() + 1);
+    const auto generate_instance = [this](u64 i) -> TileInstance {
+        const math::IVec2D pos = get_quad_tile_pos(i);
+        return {static_cast<u16>(pos.x), static_cast<u16>(pos.y), get_tile(pos).id};
+    };
+
+    if (!instance_mesh.get()) {
+        std::vector<TileInstance> instances(width * height);
+        for (u64 i = 0; i < instances.size(); ++i) { instances[i] = generate_instance(i); }
+
+        unsigned int vao, vbo;
+        glGenVertexArrays(1, &vao);
+        glGenBuffers(1, &vbo);
+
+        glBindBuffer(GL_ARRAY_BUFFER, vbo);
+        glBufferData(GL_ARRAY_BUFFER, instances.size() * sizeof(TileInstance), instances.data(),
+                     GL_DYNAMIC_DRAW);
+
+        glBindVertexArray(vao);
+        const unsigned int quad_vbo = get_unit_quad().get()->vbo;
+        // Vertex Positions
+        glEnableVertexAttribArray(0); // location 0
+        glVertexAttribFormat(0, 2, GL_FLOAT, GL_FALSE, 0);
+        glVertexAttribBinding(0, 0);
+        // UV Positions
+        glEnableVertexAttribArray(1); // location 1
+        glVertexAttribFormat(1, 2, GL_FLOAT, GL_FALSE, 2 * sizeof(float));
+        glVertexAttribBinding(1, 0);
+        glBindVertexBuffer(0, quad_vbo, 0, 4 * sizeof(float));
+        // Tile positions
+        glEnableVertexAttribArray(2); // location 2
+        glVertexAttribIFormat(2, 2, GL_UNSIGNED_SHORT, offsetof(TileInstance, x));
+        glVertexAttribBinding(2, 1);
+        // Tile IDs
+        glEnableVertexAttribArray(3); // location 3
+        glVertexAttribIFormat(3, 1, GL_UNSIGNED_INT, offsetof(TileInstance, id));
+        glVertexAttribBinding(3, 1);
+        glBindVertexBuffer(1, vbo, 0, sizeof(TileInstance));
+        glVertexBindingDivisor(1, 1);
+
+        instance_mesh = asset_manager::put(Mesh{vao, vbo});
+        instance_dirty_ranges.clear();
+        return;
+    }
+    if (instance_dirty_ranges.empty())
+        return;
+
+    std::vector<TileInstance> patch;
+    glBindBuffer(GL_ARRAY_BUFFER, instance_mesh.get()->vbo);
+    coalesce_ranges(instance_dirty_ranges);
+    for (const auto range : instance_dirty_ranges) {
+        patch.resize(range.end - range.begin);
+        for (u64 i = range.begin; i < range.end; ++i) {
+            patch[i - range.begin] = generate_instance(i);
+        }
+        glBufferSubData(GL_ARRAY_BUFFER, range.begin * sizeof(TileInstance),
+                        patch.size() * sizeof(TileInstance), patch.data());
+    }
+    instance_dirty_ranges.clear();
+}
+
+void Map::Layer::draw_instanced_chunks(math::IRect2D tile_view) {
+    update_instances();
+
+    constexpr int quad_verts = 2 * 3;
+    glBindVertexArray(instance_mesh.get()->vao);
+    for (const auto range : get_visible_quad_ranges(tile_view)) {
+        glDrawArraysInstancedBaseInstance(GL_TRIANGLES, 0, quad_verts,
+                                          static_cast<GLsizei>(range.end - range.begin),
+                                          static_cast<GLuint>(range.begin));
+    }
+}
+
+void Map::Layer::update_tile_texture() {
+    static_assert(sizeof(Tile) == sizeof(u32), "Tiles are uploaded directly as GL_R32UI texels");
+    if (tile_texture == notexture) {
+        glGenTextures(1, &tile_texture);
+        glBindTexture(GL_TEXTURE_2D, tile_texture);
+        glTexStorage2D(GL_TEXTURE_2D, 1, GL_R32UI, width, height);
+        // Integer textures can't be filtered
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        texture_dirty_rect = {{0, 0}, {static_cast<i32>(width), static_cast<i32>(height)}};
+    }
+    if (texture_dirty_rect.width() <= 0 || texture_dirty_rect.height() <= 0)
+        return;
+
+    const auto& rect = texture_dirty_rect;
+    glBindTexture(GL_TEXTURE_2D, tile_texture);
+    // Upload straight from the tile vector; The row length lets us skip the tiles outside the rect
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    glPixelStorei(GL_UNPACK_ROW_LENGTH, width);
+    glTexSubImage2D(GL_TEXTURE_2D, 0, rect.start.x, rect.start.y, rect.width(), rect.height(),
+                    GL_RED_INTEGER, GL_UNSIGNED_INT, &(*tiles)[rect.start.x + rect.start.y * width]);
+    glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+    texture_dirty_rect = {{0, 0}, {0, 0}};
+}
+
+void Map::Layer::unload_render_data() {
+    mesh.unload();
+    dirty_ranges.clear();
+    instance_mesh.unload();
+    instance_dirty_ranges.clear();
+    if (tile_texture != notexture) {
+        glDeleteTextures(1, &tile_texture);
+        tile_texture = notexture;
+    }
+}
+
+void recompute_autotiles(Map::Layer& layer, math::IRect2D rect, std::optional<u32> only_x_index) {
+    auto tileset = layer.tileset.get();
+    if (!tileset || tileset->autotile_rules.empty())
+        return;
+
+    const math::IVec2D layer_size = layer.get_size();
+    const i32 min_x = std::max(rect.start.x, 0);
+    const i32 min_y = std::max(rect.start.y, 0);
+    const i32 max_x = std::min(rect.end.x, layer_size.x);
+    const i32 max_y = std::min(rect.end.y, layer_size.y);
+    if (min_x >= max_x || min_y >= max_y)
+        return;
+
+    // Look up the tileset texture once for the whole region instead of once per tile
+    const u32 tileset_width = static_cast<u32>(tileset->get_size_in_tiles().x);
+    auto const& rules = tileset->autotile_rules;
+    auto const& tiles = layer.get_tiles();
+
+    // Autotile type of every tile of the region, plus a border of one tile around it. Tiles outside
+    // of the layer get a type no tile can have so that they count as different neighbours.
+    constexpr u32 outside = static_cast<u32>(-1);
+    const i32 padded_width = max_x - min_x + 2;
+    const i32 padded_height = max_y - min_y + 2;
+    std::vector<u32> types(static_cast<std::size_t>(padded_width) * padded_height, outside);
+    const i32 border_min_x = std::max(min_x - 1, 0);
+    const i32 border_max_x = std::min(max_x + 1, layer_size.x);
+    for (i32 y = std::max(min_y - 1, 0); y < std::min(max_y + 1, layer_size.y); ++y) {
+        const i32 row = (y - min_y + 1) * padded_width - min_x + 1;
+        for (i32 x = border_min_x; x < border_max_x; ++x)
+            types[row + x] = tiles[x + y * layer_size.x].id % tileset_width;
+    }
+
+    // In the same order as the surroundings bits: From the upper left neighbour to the lower right
+    const std::array<i32, 8> neighbour_offsets = {
+        -padded_width - 1, -padded_width, -padded_width + 1, -1, 1,
+        padded_width - 1,  padded_width,  padded_width + 1};
+
+    std::vector<Map::Tile> result;
+    result.reserve(static_cast<std::size_t>(max_x - min_x) * (max_y - min_y));
+    for (i32 y = min_y; y < max_y; ++y) {
+        for (i32 x = min_x; x < max_x; ++x) {
+            const i32 center = (y - min_y + 1) * padded_width + (x - min_x + 1);
+            const u32 type = types[center];
+            if (only_x_index && type != *only_x_index) {
+                result.emplace_back(tiles[x + y * layer_size.x]);
+                continue;
+            }
+            u32 surroundings = 0;
+            for (u32 bit = 0; bit < neighbour_offsets.size(); ++bit)
+                surroundings |= static_cast<u32>(types[center + neighbour_offsets[bit]] != type)
+                                << bit;
+            result.emplace_back(Map::Tile{
+                type + tileset_width * rules.get_row(type, static_cast<u8>(surroundings))});
+        }
+    }
+    layer.set_tiles({{min_x, min_y}, {max_x, max_y}}, result);
+}
+
 namespace map_file_definitions {
 
 constexpr std::string_view name_json_key = "name";
@@ -110,9 +501,21 @@ constexpr std::string_view entities_json_key = "entities";
 namespace layer_file_definitions {
 constexpr std::string_view name_json_key = "name";
 constexpr std::string_view data_json_key = "data";
+constexpr std::string_view data_format_json_key = "data_format";
 constexpr std::string_view tileset_id_json_key = "tileset";
 } // namespace layer_file_definitions
 
+/// Ways of storing the tile data of a layer. Layers without a data format key use json_array.
+enum class TileDataFormat : u32 {
+    /// JSON array with the ID of every tile, row by row. The only format older versions write.
+    json_array = 0,
+    /// Base64 string of the tiles, row by row, as runs of equal tiles. Every run is stored as two
+    /// LEB128 varints: The amount of tiles in it and their ID.
+    rle = 1,
+    /// Same as rle, but the runs are compressed with deflate (zlib format) before being encoded.
+    rle_deflate = 2
+};
+
 namespace comment_file_definitions {
 constexpr std::string_view position_json_key = "pos";
 constexpr std::string_view text_json_key = "text";
@@ -120,7 +523,149 @@ constexpr std::string_view text_json_key = "text";
 
 } // namespace map_file_definitions
 
-template<> RawSaveData raw_get_save_data<Map>(Map const& map) {
+namespace {
+
+constexpr std::string_view base64_chars =
+    "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+std::string base64_encode(u8 const* data, std::size_t size) {
+    std::string result;
+    result.reserve((size + 2) / 3 * 4);
+    for (std::size_t i = 0; i < size; i += 3) {
+        const u32 chunk = (u32(data[i]) << 16) | (i + 1 < size ? u32(data[i + 1]) << 8 : 0) |
+                          (i + 2 < size ? u32(data[i + 2]) : 0);
+        result += base64_chars[(chunk >> 18) & 0x3F];
+        result += base64_chars[(chunk >> 12) & 0x3F];
+        result += i + 1 < size ? base64_chars[(chunk >> 6) & 0x3F] : '=';
+        result += i + 2 < size ? base64_chars[chunk & 0x3F] : '=';
+    }
+    return result;
+}
+
+std::vector<u8> base64_decode(std::string_view str) {
+    std::vector<u8> result;
+    result.reserve(str.size() / 4 * 3);
+    u32 chunk = 0;
+    int bits = 0;
+    for (const char c : str) {
+        const auto value = base64_chars.find(c);
+        if (value == std::string_view::npos)
+            break; // Padding
+        chunk = (chunk << 6) | static_cast<u32>(value);
+        bits += 6;
+        if (bits >= 8) {
+            bits -= 8;
+            result.emplace_back(static_cast<u8>(chunk >> bits));
+        }
+    }
+    return result;
+}
+
+void write_varint(std::vector<u8>& out, u64 value) {
+    while (value >= 0x80) {
+        out.emplace_back(static_cast<u8>(value | 0x80));
+        value >>= 7;
+    }
+    out.emplace_back(static_cast<u8>(value));
+}
+
+/// @returns False if the data ended before the varint did.
+bool read_varint(u8 const*& it, u8 const* end, u64& value) {
+    value = 0;
+    for (int shift = 0; it != end && shift < 64; shift += 7) {
+        const u8 byte = *it++;
+        value |= static_cast<u64>(byte & 0x7F) << shift;
+        if (!(byte & 0x80))
+            return true;
+    }
+    return false;
+}
+
+std::string encode_tile_data(std::vector<Map::Tile> const& tiles) {
+    std::vector<u8> runs;
+    for (std::size_t i = 0; i < tiles.size();) {
+        std::size_t run_end = i + 1;
+        while (run_end < tiles.size() && tiles[run_end].id == tiles[i].id) ++run_end;
+        write_varint(runs, run_end - i);
+        write_varint(runs, tiles[i].id);
+        i = run_end;
+    }
+
+    int compressed_size;
+    u8* compressed =
+        stb_zlib_compress(runs.data(), static_cast<int>(runs.size()), &compressed_size, 8);
+    std::string result = base64_encode(compressed, static_cast<std::size_t>(compressed_size));
+    stb_zlib_free(compressed);
+    return result;
+}
+
+/// Decodes the encoded data of a layer into its tiles. Layers with data that is unknown, corrupt
+/// or doesn't contain exactly tile_count tiles are reported and left without tiles, so that they
+/// are loaded filled with empty ones instead of being partially loaded.
+void decode_tile_data(PreparedLoad<Map>::LayerData& layer, u64 tile_count) {
+    const auto fail = [&layer](const char* reason) {
+        std::cerr << "Could not load the tiles of layer \"" << layer.name << "\": " << reason
+                  << ". The layer will be left empty." << std::endl;
+        layer.tiles.clear();
+        layer.tiles.shrink_to_fit();
+    };
+
+    using map_file_definitions::TileDataFormat;
+    std::vector<u8> runs = base64_decode(layer.encoded_data);
+    layer.encoded_data.clear();
+    layer.encoded_data.shrink_to_fit();
+
+    switch (static_cast<TileDataFormat>(layer.data_format)) {
+        case TileDataFormat::rle: break;
+        case TileDataFormat::rle_deflate: {
+            int decompressed_size;
+            char* decompressed =
+                stbi_zlib_decode_malloc(reinterpret_cast<const char*>(runs.data()),
+                                        static_cast<int>(runs.size()), &decompressed_size);
+            if (!decompressed)
+                return fail("Invalid compressed data");
+            runs.assign(decompressed, decompressed + decompressed_size);
+            std::free(decompressed);
+        } break;
+        default: return fail("Unknown data format");
+    }
+
+    layer.tiles.clear();
+    layer.tiles.reserve(tile_count);
+    u8 const* it = runs.data();
+    u8 const* const end = runs.data() + runs.size();
+    while (it != end) {
+        u64 run_length, id;
+        if (!read_varint(it, end, run_length) || !read_varint(it, end, id))
+            return fail("Invalid run data");
+        if (run_length > tile_count - layer.tiles.size())
+            return fail("More tiles than the size of the map");
+        layer.tiles.insert(layer.tiles.end(), run_length, Map::Tile{static_cast<u32>(id)});
+    }
+    if (layer.tiles.size() != tile_count)
+        return fail("Fewer tiles than the size of the map");
+}
+
+} // namespace
+
+template<> SaveSnapshot<Map> raw_make_save_snapshot<Map>(Map const& map) {
+    SaveSnapshot<Map> snapshot{map.name, map.width, map.height, {}, {}, {}};
+    snapshot.layers.reserve(map.layers.size());
+    for (const auto& _l : map.layers) {
+        auto& layer = *_l.get();
+        snapshot.layers.push_back({layer.name, layer.tileset.get_id(), layer.share_tiles()});
+    }
+    snapshot.comments.reserve(map.comments.size());
+    for (const auto& c : map.comments) {
+        assert(c.get());
+        snapshot.comments.emplace_back(*c.get());
+    }
+    snapshot.entities.reserve(map.entities.size());
+    for (const auto& e : map.entities) { snapshot.entities.emplace_back(e.get_id()); }
+    return snapshot;
+}
+
+template<> RawSaveData raw_get_snapshot_save_data<Map>(SaveSnapshot<Map> const& map) {
     rapidjson::StringBuffer s;
     rapidjson::Writer<rapidjson::StringBuffer> w(s);
 
@@ -135,29 +680,25 @@ template<> RawSaveData raw_get_save_data<Map>(Map const& map) {
     w.Int64(map.height);
     w.Key(layers_json_key.data());
     w.StartArray();
-    for (const auto& _l : map.layers) {
-        auto& layer = *_l.get();
+    for (const auto& layer : map.layers) {
         namespace lfd = layer_file_definitions;
         w.StartObject();
         w.Key(lfd::name_json_key.data());
         w.String(layer.name.data());
         w.Key(lfd::tileset_id_json_key.data());
-        w.Uint64(layer.tileset.get_id());
+        w.Uint64(layer.tileset_id);
+        w.Key(lfd::data_format_json_key.data());
+        w.Uint(static_cast<u32>(TileDataFormat::rle_deflate));
         w.Key(lfd::data_json_key.data());
-        w.StartArray();
-        for (int y = 0; y < map.height; ++y) {
-            for (int x = 0; x < map.width; ++x) { w.Uint(layer.get_tile({x, y}).id); }
-        }
-        w.EndArray();
+        const std::string data = encode_tile_data(*layer.tiles);
+        w.String(data.data(), static_cast<rapidjson::SizeType>(data.size()));
         w.EndObject();
     }
     w.EndArray();
     w.Key(comments_json_key.data());
     w.StartArray();
-    for (const auto& c : map.comments) {
+    for (const auto& comment : map.comments) {
         namespace cfd = comment_file_definitions;
-        assert(c.get());
-        const auto& comment = *c.get();
         w.StartObject();
         w.Key(cfd::text_json_key.data());
         w.String(comment.text.c_str());
@@ -176,7 +717,7 @@ template<> RawSaveData raw_get_save_data<Map>(Map const& map) {
 
     w.Key(entities_json_key.data());
     w.StartArray();
-    for (const auto& c : map.entities) { w.Uint64(c.get_id()); }
+    for (const auto& id : map.entities) { w.Uint64(id); }
     w.EndArray();
 
     w.EndObject();
@@ -187,80 +728,335 @@ template<> RawSaveData raw_get_save_data<Map>(Map const& map) {
     return data;
 }
 
+template<> RawSaveData raw_get_save_data<Map>(Map const& map) {
+    return raw_get_snapshot_save_data(raw_make_save_snapshot(map));
+}
+
+namespace {
+
+/// SAX handler for map files. Tile IDs are written straight into the tile vectors of the prepared
+/// layers instead of building a DOM with a value for every single tile first.
+/// Unknown keys are skipped along with their values.
+class MapFileHandler : public rapidjson::BaseReaderHandler<rapidjson::UTF8<>, MapFileHandler> {
+public:
+    explicit MapFileHandler(PreparedLoad<Map>& map) : map(map) {}
+
+    bool StartObject() {
+        if (skip_depth != noskip)
+            return ++skip_depth, true;
+        switch (state) {
+            case State::start: state = State::map; return true;
+            case State::layers:
+                map.layers.emplace_back();
+                if (map.width > 0 && map.height > 0)
+                    map.layers.back().tiles.reserve(map.width * map.height);
+                state = State::layer;
+                return true;
+            case State::comments:
+                map.comments.emplace_back();
+                state = State::comment;
+                return true;
+            case State::comment_pos_value: state = State::comment_pos; return true;
+            default: return false;
+        }
+    }
+
+    bool EndObject(rapidjson::SizeType) {
+        if (skip_depth != noskip)
+            return end_skipped_value(-1);
+        switch (state) {
+            case State::map: state = State::end; return true;
+            case State::layer: state = State::layers; return true;
+            case State::comment: state = State::comments; return true;
+            case State::comment_pos: state = State::comment; return true;
+            default: return false;
+        }
+    }
+
+    bool StartArray() {
+        if (skip_depth != noskip)
+            return ++skip_depth, true;
+        switch (state) {
+            case State::layers_value: state = State::layers; return true;
+            case State::layer_data_value: state = State::layer_data; return true;
+            case State::comments_value: state = State::comments; return true;
+            case State::entities_value: state = State::entities; return true;
+            default: return false;
+        }
+    }
+
+    bool EndArray(rapidjson::SizeType) {
+        if (skip_depth != noskip)
+            return end_skipped_value(-1);
+        switch (state) {
+            case State::layers:
+            case State::comments:
+            case State::entities: state = State::map; return true;
+            case State::layer_data: state = State::layer; return true;
+            default: return false;
+        }
+    }
+
+    bool Key(const char* str, rapidjson::SizeType length, bool) {
+        if (skip_depth != noskip)
+            return true;
+        using namespace map_file_definitions;
+        namespace lfd = layer_file_definitions;
+        namespace cfd = comment_file_definitions;
+        const std::string_view key(str, length);
+        const auto expect = [this](State value_state) {
+            state = value_state;
+            return true;
+        };
+        switch (state) {
+            case State::map:
+                if (key == name_json_key)
+                    return expect(State::name_value);
+                if (key == width_json_key)
+                    return expect(State::width_value);
+                if (key == height_json_key)
+                    return expect(State::height_value);
+                if (key == layers_json_key)
+                    return expect(State::layers_value);
+                if (key == comments_json_key)
+                    return expect(State::comments_value);
+                if (key == entities_json_key)
+                    return expect(State::entities_value);
+                break;
+            case State::layer:
+                if (key == lfd::name_json_key)
+                    return expect(State::layer_name_value);
+                if (key == lfd::tileset_id_json_key)
+                    return expect(State::layer_tileset_value);
+                if (key == lfd::data_json_key)
+                    return expect(State::layer_data_value);
+                if (key == lfd::data_format_json_key)
+                    return expect(State::layer_data_format_value);
+                break;
+            case State::comment:
+                if (key == cfd::text_json_key)
+                    return expect(State::comment_text_value);
+                if (key == cfd::position_json_key)
+                    return expect(State::comment_pos_value);
+                break;
+            case State::comment_pos:
+                if (key == "x")
+                    return expect(State::comment_pos_x_value);
+                if (key == "y")
+                    return expect(State::comment_pos_y_value);
+                break;
+            default: return false;
+        }
+        // Skip the value of the unknown key
+        skip_depth = 0;
+        return true;
+    }
+
+    bool String(const char* str, rapidjson::SizeType length, bool) {
+        if (skip_depth != noskip)
+            return end_skipped_value(0);
+        switch (state) {
+            case State::name_value:
+                map.name.assign(str, length);
+                state = State::map;
+                return true;
+            case State::layer_name_value:
+                map.layers.back().name.assign(str, length);
+                state = State::layer;
+                return true;
+            case State::comment_text_value:
+                map.comments.back().text.assign(str, length);
+                state = State::comment;
+                return true;
+            case State::layer_data_value:
+                map.layers.back().encoded_data.assign(str, length);
+                state = State::layer;
+                return true;
+            default: return false;
+        }
+    }
+
+    bool Uint64(u64 value) {
+        if (skip_depth != noskip)
+            return end_skipped_value(0);
+        switch (state) {
+            case State::layer_data:
+                map.layers.back().tiles.push_back({static_cast<u32>(value)});
+                return true;
+            case State::entities: map.entities.emplace_back(value); return true;
+            case State::width_value:
+                map.width = static_cast<i64>(value);
+                state = State::map;
+                return true;
+            case State::height_value:
+                map.height = static_cast<i64>(value);
+                state = State::map;
+                return true;
+            case State::layer_tileset_value:
+                map.layers.back().tileset_id = value;
+                state = State::layer;
+                return true;
+            case State::layer_data_format_value:
+                map.layers.back().data_format = static_cast<u32>(value);
+                state = State::layer;
+                return true;
+            default: return Int64(static_cast<i64>(value));
+        }
+    }
+
+    bool Int64(i64 value) {
+        if (skip_depth != noskip)
+            return end_skipped_value(0);
+        switch (state) {
+            case State::comment_pos_x_value:
+                map.comments.back().pos.x = static_cast<i32>(value);
+                state = State::comment_pos;
+                return true;
+            case State::comment_pos_y_value:
+                map.comments.back().pos.y = static_cast<i32>(value);
+                state = State::comment_pos;
+                return true;
+            default: return false;
+        }
+    }
+
+    bool Uint(unsigned value) { return Uint64(value); }
+    bool Int(int value) { return Int64(value); }
+
+    /// Called for every other value type (null, bools and doubles), none of which are used.
+    bool Default() {
+        if (skip_depth != noskip)
+            return end_skipped_value(0);
+        return false;
+    }
+
+private:
+    /// Where the parser is in the file. *_value states expect the value of the key just read.
+    enum class State {
+        start,
+        map,
+        name_value,
+        width_value,
+        height_value,
+        layers_value,
+        layers,
+        layer,
+        layer_name_value,
+        layer_tileset_value,
+        layer_data_value,
+        layer_data,
+        layer_data_format_value,
+        comments_value,
+        comments,
+        comment,
+        comment_text_value,
+        comment_pos_value,
+        comment_pos,
+        comment_pos_x_value,
+        comment_pos_y_value,
+        entities_value,
+        entities,
+        end
+    } state = State::start;
+
+    static constexpr i32 noskip = -1;
+    /// Nesting level inside the value being skipped, or noskip if not skipping anything.
+    i32 skip_depth = noskip;
+
+    bool end_skipped_value(i32 depth_delta) {
+        skip_depth += depth_delta;
+        if (skip_depth == 0)
+            skip_depth = noskip;
+        return true;
+    }
+
+    PreparedLoad<Map>& map;
+};
+
+PreparedLoad<Map> failed_map_load() {
+    PreparedLoad<Map> prepared;
+    prepared.failed = true;
+    return prepared;
+}
+
+template<typename InputStream> PreparedLoad<Map> parse_map(InputStream& stream) {
+    PreparedLoad<Map> prepared;
+    {
+        load_profiler::StageTimer profile(load_profiler::Stage::parse);
+        MapFileHandler handler(prepared);
+        rapidjson::Reader reader;
+        if (!reader.Parse(stream, handler)) {
+            std::cerr << "Invalid map file: Parse error at offset " << reader.GetErrorOffset()
+                      << "." << std::endl;
+            return failed_map_load();
+        }
+    }
+    // Decode here too so that it's done in the worker threads
+    load_profiler::StageTimer profile(load_profiler::Stage::decode);
+    for (auto& layer : prepared.layers) {
+        if (!layer.encoded_data.empty())
+            decode_tile_data(layer, static_cast<u64>(prepared.width * prepared.height));
+    }
+    return prepared;
+}
+
+} // namespace
+
 template<> void raw_load<Map>(Map& map, LoadParams<Map> const& params) {
-    std::ifstream f(params.path);
-    std::stringstream buffer;
-    buffer << f.rdbuf();
+    raw_finish_load(map, raw_prepare_load(params));
+}
 
-    rapidjson::Document doc;
-    doc.Parse(buffer.str().data());
+template<> PreparedLoad<Map> raw_prepare_load<Map>(LoadParams<Map> const& params) {
+    std::FILE* file = std::fopen(params.path.generic_string().c_str(), "rb");
+    if (!file) {
+        std::cerr << "Could not open map file " << params.path.generic_string() << "."
+                  << std::endl;
+        return failed_map_load();
+    }
+    char buffer[64 * 1024];
+    rapidjson::FileReadStream stream(file, buffer, sizeof(buffer));
+    PreparedLoad<Map> prepared = parse_map(stream);
+    std::fclose(file);
+    return prepared;
+}
 
-    map.width = -1;
-    map.height = -1;
+PreparedLoad<Map> prepare_map_load_from_memory(std::string_view data) {
+    rapidjson::MemoryStream stream(data.data(), data.size());
+    return parse_map(stream);
+}
 
-    using namespace map_file_definitions;
+template<> void raw_finish_load<Map>(Map& map, PreparedLoad<Map>&& prepared) {
+    if (prepared.failed)
+        return;
+    assert((prepared.layers.empty() || (prepared.width >= 0 && prepared.height >= 0)) &&
+           "Map layer data loaded without width/height");
+    map.name = std::move(prepared.name);
+    map.width = prepared.width;
+    map.height = prepared.height;
 
-    for (auto const& obj : doc.GetObject()) {
-        if (obj.name == name_json_key.data()) {
-            map.name = obj.value.GetString();
-        } else if (obj.name == width_json_key.data()) {
-            map.width = obj.value.GetInt64();
-        } else if (obj.name == height_json_key.data()) {
-            map.height = obj.value.GetInt64();
-        } else if (obj.name == layers_json_key.data()) {
-            for (auto const& layer_object : obj.value.GetArray()) {
-                namespace lfd = layer_file_definitions;
-                if (map.width == -1 || map.height == -1) {
-                    assert("Map layer data loaded before width/height");
-                }
-                auto& layer = *map.layers
-                                   .emplace_back(asset_manager::put(
-                                       assets::Map::Layer(map.width, map.height, -1)))
-                                   .get();
-
-                for (auto const& layer_val : layer_object.GetObject()) {
-                    if (layer_val.name == lfd::name_json_key.data()) {
-                        layer.name = layer_val.value.GetString();
-                        // < 0.1.4 compatibility: Blank layer names are no longer allowed
-                        if(layer.name == "") {
-                            layer.name = "<Blank name>";
-                        }
-                    } else if (layer_val.name == lfd::tileset_id_json_key.data()) {
-                        layer.tileset = Handle<Tileset>(layer_val.value.GetUint64());
-                        layer.regenerate_mesh();
-                    } else if (layer_val.name == lfd::data_json_key.data()) {
-                        u64 i = 0;
-                        for (auto const& layer_tile : layer_val.value.GetArray()) {
-                            layer.set_tile(
-                                {static_cast<i32>(i % map.width), static_cast<i32>(i / map.width)},
-                                {layer_tile.GetUint()});
-                            ++i;
-                        }
-                    }
-                }
-            }
-        } else if (obj.name == comments_json_key.data()) {
-            for (auto const& comment_object : obj.value.GetArray()) {
-                namespace cfd = comment_file_definitions;
-
-                assets::Map::Comment comment;
-
-                for (auto const& comment_val : comment_object.GetObject()) {
-                    if (comment_val.name == cfd::text_json_key.data()) {
-                        comment.text = comment_val.value.GetString();
-                    } else if (comment_val.name == cfd::position_json_key.data()) {
-                        comment.pos.x = comment_val.value.GetObject()["x"].GetInt();
-                        comment.pos.y = comment_val.value.GetObject()["y"].GetInt();
-                    }
-                }
-
-                map.comments.emplace_back(asset_manager::put(comment));
-            }
-        } else if (obj.name == entities_json_key.data()) {
-            for (const auto& entity_id : obj.value.GetArray()) {
-                map.entities.emplace_back(entity_id.GetUint64());
-            }
+    for (auto& layer_data : prepared.layers) {
+        auto& layer = *map.layers
+                           .emplace_back(asset_manager::put(assets::Map::Layer(
+                               map.width, map.height, Handle<Tileset>(layer_data.tileset_id))))
+                           .get();
+        layer.name = std::move(layer_data.name);
+        // < 0.1.4 compatibility: Blank layer names are no longer allowed
+        if (layer.name.empty()) {
+            layer.name = "<Blank name>";
         }
+        // Plain tile arrays of old files may be shorter than the map; Missing tiles are empty
+        if (layer_data.tiles.size() > static_cast<u64>(map.width * map.height)) {
+            std::cerr << "Layer \"" << layer.name
+                      << "\" has more tiles than the size of its map. The rest will be ignored."
+                      << std::endl;
+        }
+        layer_data.tiles.resize(map.width * map.height);
+        layer.set_tiles({{0, 0}, {static_cast<i32>(map.width), static_cast<i32>(map.height)}},
+                        layer_data.tiles);
     }
+
+    for (auto const& comment : prepared.comments)
+        map.comments.emplace_back(asset_manager::put(comment));
+    for (const auto entity_id : prepared.entities) map.entities.emplace_back(entity_id);
 }
 } // namespace arpiyi_editor::assets
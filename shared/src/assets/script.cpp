@@ -31,12 +31,15 @@ template<> RawSaveData raw_get_save_data<Script>(Script const& script) {
 }
 
 template<> void raw_load<Script>(Script& script, LoadParams<Script> const& params) {
-    std::ifstream f(params.path);
-    std::stringstream buffer;
-    buffer << f.rdbuf();
+    raw_finish_load(script, raw_prepare_load(params));
+}
+
+template<> PreparedLoad<Script> raw_prepare_load<Script>(LoadParams<Script> const& params) {
+    return {{parse_json_file(params.path)}};
+}
 
-    rapidjson::Document doc;
-    doc.Parse(buffer.str().data());
+template<> void raw_finish_load<Script>(Script& script, PreparedLoad<Script>&& prepared) {
+    auto const& doc = prepared.doc;
 
     for(const auto& node : doc.GetObject()) {
         if(node.name == name_json_key.data()) {
@@ -1,11 +1,8 @@
 #include "assets/sprite.hpp"
 
 #include <string_view>
-#include <fstream>
 
 #include <rapidjson/document.h>
-#include <rapidjson/stringbuffer.h>
-#include <rapidjson/writer.h>
 
 namespace arpiyi::assets {
 
@@ -19,70 +16,46 @@ constexpr std::string_view pivot_json_key = "pivot";
 
 } // namespace sprite_file_definitions
 
-template<> RawSaveData raw_get_save_data(Sprite const& sprite) {
-    rapidjson::StringBuffer s;
-    rapidjson::Writer<rapidjson::StringBuffer> w(s);
-
-    using namespace sprite_file_definitions;
-
-    w.StartObject();
-    {
-        w.Key(texture_id_json_key.data());
-        w.Uint64(static_cast<u64>(sprite.texture.get_id()));
-
-        w.Key(uv_min_json_key.data());
-        w.StartArray();
-        w.Double(sprite.uv_min.x);
-        w.Double(sprite.uv_min.y);
-        w.EndArray();
-
-        w.Key(uv_max_json_key.data());
-        w.StartArray();
-        w.Double(sprite.uv_max.x);
-        w.Double(sprite.uv_max.y);
-        w.EndArray();
-
-        w.Key(name_json_key.data());
-        w.String(sprite.name.data());
-
-        w.Key(pivot_json_key.data());
-        w.StartArray();
-        w.Double(sprite.pivot.x);
-        w.Double(sprite.pivot.y);
-        w.EndArray();
-    }
-    w.EndObject();
-    {
-        RawSaveData data;
-        data.bytestream.write(s.GetString(), s.GetLength());
-        return data;
-    }
-}
-
-template<> void raw_load(Sprite& sprite, LoadParams<Sprite> const& params) {
-    std::ifstream f(params.path);
-    std::stringstream buffer;
-    buffer << f.rdbuf();
-
-    rapidjson::Document doc;
-    doc.Parse(buffer.str().data());
+template<> bool raw_load_legacy<Sprite>(Sprite& sprite, std::string_view data) {
+    const rapidjson::Document doc = parse_json_data(data);
+    if (doc.HasParseError() || !doc.IsObject())
+        return false;
 
     using namespace sprite_file_definitions;
 
+    const auto read_vector = [](rapidjson::Value const& value, aml::Vector2& vec) {
+        if (!value.IsArray() || value.Size() != 2)
+            return false;
+        auto const& array = value.GetArray();
+        if (!array[0].IsNumber() || !array[1].IsNumber())
+            return false;
+        vec = {array[0].GetFloat(), array[1].GetFloat()};
+        return true;
+    };
+
+    Sprite loaded{};
     for (auto const& obj : doc.GetObject()) {
+        bool valid = true;
         if (obj.name == name_json_key.data()) {
-            sprite.name = obj.value.GetString();
+            valid = obj.value.IsString();
+            if (valid)
+                loaded.name = obj.value.GetString();
         } else if (obj.name == uv_min_json_key.data()) {
-            sprite.uv_min = {obj.value.GetArray()[0].GetFloat(), obj.value.GetArray()[1].GetFloat()};
+            valid = read_vector(obj.value, loaded.uv_min);
         } else if (obj.name == uv_max_json_key.data()) {
-            sprite.uv_max = {obj.value.GetArray()[0].GetFloat(), obj.value.GetArray()[1].GetFloat()};
+            valid = read_vector(obj.value, loaded.uv_max);
         } else if (obj.name == pivot_json_key.data()) {
-            sprite.pivot = {obj.value.GetArray()[0].GetFloat(), obj.value.GetArray()[1].GetFloat()};
+            valid = read_vector(obj.value, loaded.pivot);
         } else if (obj.name == texture_id_json_key.data()) {
-            sprite.texture = Handle<assets::Texture>(obj.value.GetUint64());
-        } else
-            assert("Unknown JSON key in tileset file");
+            valid = obj.value.IsUint64();
+            if (valid)
+                loaded.texture = Handle<assets::Texture>(obj.value.GetUint64());
+        }
+        if (!valid)
+            return false;
     }
+    sprite = std::move(loaded);
+    return true;
 }
 
-} // namespace arpiyi_editor::assets
\ No newline at end of file
+} // namespace arpiyi::assets
@@ -1,5 +1,10 @@
 #include "assets/texture.hpp"
 
+#include <cassert>
+#include <cstdlib>
+#include <cstring>
+#include <utility>
+
 #include <rapidjson/stringbuffer.h>
 #include <rapidjson/writer.h>
 #include <stb_image_write.h>
@@ -13,20 +18,118 @@ constexpr std::string_view path_json_key = "path";
 
 } // namespace texture_file_definitions
 
-template<> RawSaveData raw_get_save_data<Texture>(Texture const& texture) {
-    RawSaveData data;
-    constexpr u8 channel_width = 4;
-    u64 raw_data_size = texture.w * texture.h * channel_width;
-    void* raw_tex_data = malloc(raw_data_size);
+namespace {
+
+constexpr u8 channel_width = 4;
+
+/// Deletes the buffer and fence of the readback of a snapshot, if it has any.
+void delete_readback(SaveSnapshot<Texture>& snapshot) {
+    if (snapshot.fence)
+        glDeleteSync(snapshot.fence);
+    if (snapshot.pbo != Texture::nohandle)
+        glDeleteBuffers(1, &snapshot.pbo);
+    snapshot.fence = nullptr;
+    snapshot.pbo = Texture::nohandle;
+}
+
+/// Copies the pixels read back into the snapshot PBO once the GPU is done writing them. Waits for
+/// at most timeout nanoseconds, and returns whether the pixels were copied.
+bool finish_readback(SaveSnapshot<Texture>& snapshot, GLuint64 timeout) {
+    if (snapshot.pbo == Texture::nohandle)
+        return true;
+
+    const GLenum wait_result = glClientWaitSync(snapshot.fence, GL_SYNC_FLUSH_COMMANDS_BIT, timeout);
+    if (wait_result != GL_ALREADY_SIGNALED && wait_result != GL_CONDITION_SATISFIED)
+        return false;
+
+    snapshot.pixels.resize(static_cast<std::size_t>(snapshot.w) * snapshot.h * channel_width);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, snapshot.pbo);
+    const void* mapped = glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, snapshot.pixels.size(),
+                                          GL_MAP_READ_BIT);
+    std::memcpy(snapshot.pixels.data(), mapped, snapshot.pixels.size());
+    glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+    delete_readback(snapshot);
+    return true;
+}
+
+} // namespace
+
+SaveSnapshot<Texture>::SaveSnapshot(SaveSnapshot&& other) noexcept :
+    encoded_data(std::move(other.encoded_data)),
+    w(other.w),
+    h(other.h),
+    pbo(std::exchange(other.pbo, Texture::nohandle)),
+    fence(std::exchange(other.fence, nullptr)),
+    pixels(std::move(other.pixels)) {}
+
+SaveSnapshot<Texture>& SaveSnapshot<Texture>::operator=(SaveSnapshot&& other) noexcept {
+    if (this != &other) {
+        delete_readback(*this);
+        encoded_data = std::move(other.encoded_data);
+        w = other.w;
+        h = other.h;
+        pbo = std::exchange(other.pbo, Texture::nohandle);
+        fence = std::exchange(other.fence, nullptr);
+        pixels = std::move(other.pixels);
+    }
+    return *this;
+}
+
+SaveSnapshot<Texture>::~SaveSnapshot() { delete_readback(*this); }
+
+template<> SaveSnapshot<Texture> raw_make_save_snapshot<Texture>(Texture const& texture) {
+    SaveSnapshot<Texture> snapshot;
+    snapshot.encoded_data = texture.encoded_data;
+    snapshot.w = texture.w;
+    snapshot.h = texture.h;
+    if (texture.encoded_data)
+        return snapshot;
+
+    // Read the pixels into a buffer instead of client memory so that glGetTexImage returns
+    // immediately; They are copied out once the fence is signaled.
+    glGenBuffers(1, &snapshot.pbo);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, snapshot.pbo);
+    glBufferData(GL_PIXEL_PACK_BUFFER,
+                 static_cast<GLsizeiptr>(texture.w) * texture.h * channel_width, nullptr,
+                 GL_STREAM_READ);
+    glPixelStorei(GL_PACK_ALIGNMENT, 4);
     glBindTexture(GL_TEXTURE_2D, texture.handle);
-    glGetTexImage(GL_TEXTURE_2D, 0, GL_RGBA, GL_UNSIGNED_BYTE, raw_tex_data);
-    int png_encoded_data_size;
-    unsigned const char* png_encoded_data = stbi_write_png_to_mem(reinterpret_cast<unsigned const char*>(raw_tex_data), texture.w * channel_width, texture.w, texture.h, STBI_rgb_alpha, &png_encoded_data_size);
-    free(raw_tex_data);
+    glGetTexImage(GL_TEXTURE_2D, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    snapshot.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    return snapshot;
+}
+
+template<> bool raw_poll_save_snapshot<Texture>(SaveSnapshot<Texture>& snapshot) {
+    return finish_readback(snapshot, 0);
+}
+
+template<>
+RawSaveData raw_get_snapshot_save_data<Texture>(SaveSnapshot<Texture> const& snapshot) {
+    RawSaveData data;
+    if (snapshot.encoded_data) {
+        data.bytestream.write(reinterpret_cast<const char*>(snapshot.encoded_data->data()),
+                              static_cast<std::streamsize>(snapshot.encoded_data->size()));
+        return data;
+    }
 
+    assert(snapshot.pbo == Texture::nohandle && "Texture snapshot saved before being completed");
+    int png_encoded_data_size;
+    unsigned char* png_encoded_data =
+        stbi_write_png_to_mem(snapshot.pixels.data(), snapshot.w * channel_width, snapshot.w,
+                              snapshot.h, STBI_rgb_alpha, &png_encoded_data_size);
     data.bytestream.write(reinterpret_cast<const char*>(png_encoded_data), png_encoded_data_size);
+    std::free(png_encoded_data);
 
     return data;
 }
 
+template<> RawSaveData raw_get_save_data<Texture>(Texture const& texture) {
+    auto snapshot = raw_make_save_snapshot(texture);
+    finish_readback(snapshot, GL_TIMEOUT_IGNORED);
+    return raw_get_snapshot_save_data(snapshot);
+}
+
 } // namespace arpiyi_editor::assets
\ No newline at end of file
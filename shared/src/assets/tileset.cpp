@@ -3,7 +3,6 @@
 
 #include <algorithm>
 #include <rapidjson/document.h>
-#include <set>
 
 #include "util/intdef.hpp"
 
@@ -32,57 +31,30 @@ u32 Tileset::get_id(math::IVec2D pos) const {
     return pos.x + pos.y * static_cast<u32>(tex->w / global_tile_size::get());
 }
 
-static const std::set<u8> tile_table = {
-    0b00000000, 0b00000001, 0b00000010, 0b00000100, 0b00000101,
-
-    0b00001000, 0b00001010, 0b00001100,
-
-    0b00010000, 0b00010001, 0b00010010, 0b00011000, 0b00011010,
-
-    0b00010000, 0b00010001, 0b00010010, 0b00011000, 0b00011010,
-
-    0b00100000, 0b00100001, 0b00100010, 0b00100100, 0b00100101, 0b00110000, 0b00110001, 0b00110010,
-
-    0b01000000, 0b01000001, 0b01000010, 0b01000100, 0b01000101, 0b01001000, 0b01001010, 0b01001100,
-    0b01010000, 0b01010001, 0b01010010, 0b01011000, 0b01011010,
+autotile::Layout const* Tileset::get_autotile_layout(AutoType type) {
+    switch (type) {
+        case AutoType::none: return nullptr;
+        case AutoType::rpgmaker_a2: return &autotile::rpgmaker_a2_layout;
+        case AutoType::rpgmaker_a3: return &autotile::rpgmaker_a3_layout;
+        case AutoType::rpgmaker_a4: return &autotile::rpgmaker_a4_layout;
+        default: assert(false && "Unknown tileset auto type"); return nullptr;
+    }
+}
 
-    0b10000000, 0b10000001, 0b10000010, 0b10000100, 0b10000101, 0b10001000, 0b10001010, 0b10001100,
-    0b10100000, 0b10100001, 0b10100010, 0b10100100, 0b10100101};
+void Tileset::compile_autotile_rules() {
+    const auto layout = get_autotile_layout(auto_type);
+    autotile_rules = layout ? autotile::CompiledRules(*layout) : autotile::CompiledRules();
+}
 
 u32 Tileset::get_id_auto(u32 x_index, u32 surroundings) const {
-    enum tile_sides {
-        upper_left_corner = 1 << 0,
-        upper_middle_side = 1 << 1,
-        upper_right_corner = 1 << 2,
-        middle_left_side = 1 << 3,
-        middle_right_side = 1 << 4,
-        lower_left_corner = 1 << 5,
-        lower_middle_side = 1 << 6,
-        lower_right_corner = 1 << 7
-    };
-    // Delete corners if there's a side next to them (since those cases are not covered by the tile
-    // table)
-    if (surroundings & upper_middle_side)
-        surroundings &= (0xFF ^ upper_left_corner ^ upper_right_corner);
-    if (surroundings & middle_left_side)
-        surroundings &= (0xFF ^ upper_left_corner ^ lower_left_corner);
-    if (surroundings & middle_right_side)
-        surroundings &= (0xFF ^ upper_right_corner ^ lower_right_corner);
-    if (surroundings & lower_middle_side)
-        surroundings &= (0xFF ^ lower_left_corner ^ lower_right_corner);
-
-    const auto it = tile_table.find(surroundings);
-    if (it == tile_table.end())
-        assert(false);
+    assert(!autotile_rules.empty() && surroundings < autotile::surroundings_count);
     return x_index + get_size_in_tiles().x *
-                         static_cast<u8>(std::distance(tile_table.begin(), it));
+                         autotile_rules.get_row(x_index, static_cast<u8>(surroundings));
 }
 
 u32 Tileset::get_surroundings_from_auto_id(u32 id) const {
-    const auto tileset_size_in_tiles{get_size_in_tiles()};
-    const u32 auto_tiletable_index =
-        (id - (id % tileset_size_in_tiles.x)) / tileset_size_in_tiles.x;
-    return *std::next(tile_table.begin(), auto_tiletable_index);
+    const u32 tileset_width = get_size_in_tiles().x;
+    return autotile_rules.get_surroundings(id % tileset_width, id / tileset_width);
 }
 u32 Tileset::get_x_index_from_auto_id(u32 id) const {
     const auto tileset_size_in_tiles{get_size_in_tiles()};
@@ -123,12 +95,15 @@ template<> RawSaveData raw_get_save_data<Tileset>(Tileset const& tileset) {
 }
 
 template<> void raw_load<Tileset>(Tileset& tileset, LoadParams<Tileset> const& params) {
-    std::ifstream f(params.path);
-    std::stringstream buffer;
-    buffer << f.rdbuf();
+    raw_finish_load(tileset, raw_prepare_load(params));
+}
+
+template<> PreparedLoad<Tileset> raw_prepare_load<Tileset>(LoadParams<Tileset> const& params) {
+    return {{parse_json_file(params.path)}};
+}
 
-    rapidjson::Document doc;
-    doc.Parse(buffer.str().data());
+template<> void raw_finish_load<Tileset>(Tileset& tileset, PreparedLoad<Tileset>&& prepared) {
+    auto const& doc = prepared.doc;
 
     using namespace tileset_file_definitions;
 
@@ -148,6 +123,7 @@ template<> void raw_load<Tileset>(Tileset& tileset, LoadParams<Tileset> const& p
         } else
             assert("Unknown JSON key in tileset file");
     }
+    tileset.compile_autotile_rules();
 }
 
 } // namespace arpiyi_editor::assets
\ No newline at end of file
@@ -0,0 +1,71 @@
+#include "autotile.hpp"
+
+#include <algorithm>
+#include <cassert>
+
+namespace arpiyi::autotile {
+
+std::array<MinitileSource, 4> get_minitile_sources(RuleSet const& rules, u8 surroundings) {
+    surroundings &= rules.neighbour_mask;
+    // Corner, vertical side and horizontal side neighbours of each quadrant
+    constexpr std::array<std::array<u8, 3>, 4> quadrant_neighbours = {
+        {{upper_left_corner, upper_middle_side, middle_left_side},
+         {upper_right_corner, upper_middle_side, middle_right_side},
+         {lower_left_corner, lower_middle_side, middle_left_side},
+         {lower_right_corner, lower_middle_side, middle_right_side}}};
+
+    std::array<MinitileSource, 4> sources;
+    for (std::size_t quadrant = 0; quadrant < sources.size(); ++quadrant) {
+        auto const& [corner, vert_side, horz_side] = quadrant_neighbours[quadrant];
+        const u8 index = ((surroundings & corner) ? corner_bit : 0) |
+                         ((surroundings & vert_side) ? vert_side_bit : 0) |
+                         ((surroundings & horz_side) ? horz_side_bit : 0);
+        sources[quadrant] = rules.minitile_sources[quadrant][index];
+    }
+    return sources;
+}
+
+CompiledRules::CompiledRules(Layout const& layout) :
+    band_count(layout.band_count), shape_rows(layout.band_count * surroundings_count) {
+    assert(band_count > 0 && band_count <= layout.band_rules.size());
+
+    std::vector<std::vector<u8>> band_surroundings(band_count);
+    for (u32 band = 0; band < band_count; ++band) {
+        auto const& rules = *layout.band_rules[band];
+        assert(rules.block_width == layout.get_block_width());
+        // Surroundings are visited in ascending order so that the ones representing each row are
+        // those with the least bits set. For floors, these have the corners next to sides cleared.
+        std::vector<std::array<MinitileSource, 4>> shapes;
+        for (u32 surroundings = 0; surroundings < surroundings_count; ++surroundings) {
+            const auto sources = get_minitile_sources(rules, static_cast<u8>(surroundings));
+            const auto it =
+                std::find_if(shapes.begin(), shapes.end(), [&sources](auto const& shape) {
+                    return std::equal(shape.begin(), shape.end(), sources.begin(),
+                                      [](MinitileSource a, MinitileSource b) {
+                                          return a.x == b.x && a.y == b.y;
+                                      });
+                });
+            shape_rows[band * surroundings_count + surroundings] =
+                static_cast<u8>(std::distance(shapes.begin(), it));
+            if (it == shapes.end()) {
+                shapes.emplace_back(sources);
+                band_surroundings[band].emplace_back(
+                    static_cast<u8>(surroundings & rules.neighbour_mask));
+            }
+        }
+        shape_counts.emplace_back(static_cast<u32>(shapes.size()));
+        row_count = std::max(row_count, static_cast<u32>(shapes.size()));
+    }
+
+    row_surroundings.resize(band_count * row_count);
+    for (u32 band = 0; band < band_count; ++band)
+        std::copy(band_surroundings[band].begin(), band_surroundings[band].end(),
+                  row_surroundings.begin() + band * row_count);
+}
+
+u8 CompiledRules::get_surroundings(u32 x_index, u32 row) const {
+    assert(row < get_shape_count(x_index));
+    return row_surroundings[(x_index % band_count) * row_count + row];
+}
+
+} // namespace arpiyi::autotile
@@ -0,0 +1,204 @@
+#include "load_profiler.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <fstream>
+#include <iomanip>
+#include <map>
+#include <mutex>
+#include <utility>
+
+#include <rapidjson/prettywriter.h>
+#include <rapidjson/stringbuffer.h>
+
+namespace arpiyi::load_profiler {
+
+namespace {
+
+constexpr auto noindex = static_cast<std::size_t>(-1);
+
+std::mutex mutex;
+std::atomic<bool> recording = false;
+std::chrono::steady_clock::time_point session_start;
+double session_ms = 0;
+std::vector<AssetTimes> asset_times;
+/// Index of each asset in asset_times, by type name and ID.
+std::map<std::pair<std::string, u64>, std::size_t> asset_indices;
+
+/// Asset that the stages timed from this thread are attributed to.
+thread_local std::size_t current_index = noindex;
+
+double ms_since(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start)
+        .count();
+}
+
+template<typename Writer> void write_stages(Writer& w, StageTimes const& stage_ms) {
+    w.Key("stages_ms");
+    w.StartObject();
+    for (std::size_t i = 0; i < stage_ms.size(); ++i) {
+        w.Key(stage_names[i].data());
+        w.Double(stage_ms[i]);
+    }
+    w.EndObject();
+}
+
+} // namespace
+
+void begin_session() {
+    std::lock_guard lock(mutex);
+    asset_times.clear();
+    asset_indices.clear();
+    session_ms = 0;
+    session_start = std::chrono::steady_clock::now();
+    recording = true;
+}
+
+void end_session() {
+    std::lock_guard lock(mutex);
+    if (!recording)
+        return;
+    session_ms = ms_since(session_start);
+    recording = false;
+}
+
+bool is_recording() { return recording; }
+
+double get_session_ms() {
+    std::lock_guard lock(mutex);
+    return session_ms;
+}
+
+AssetScope::AssetScope(std::string_view type_name, u64 id) :
+    index(noindex), previous_index(current_index), start(std::chrono::steady_clock::now()) {
+    if (!recording)
+        return;
+    std::lock_guard lock(mutex);
+    const auto [it, inserted] =
+        asset_indices.try_emplace({std::string(type_name), id}, asset_times.size());
+    if (inserted)
+        asset_times.push_back({std::string(type_name), id});
+    index = current_index = it->second;
+}
+
+AssetScope::~AssetScope() {
+    current_index = previous_index;
+    if (index == noindex)
+        return;
+    const double elapsed = ms_since(start);
+    std::lock_guard lock(mutex);
+    // The session may have been restarted in the meantime
+    if (index < asset_times.size())
+        asset_times[index].total_ms += elapsed;
+}
+
+StageTimer::StageTimer(Stage stage) : stage(stage), start(std::chrono::steady_clock::now()) {}
+
+StageTimer::~StageTimer() {
+    if (current_index == noindex)
+        return;
+    const double elapsed = ms_since(start);
+    std::lock_guard lock(mutex);
+    if (current_index < asset_times.size())
+        asset_times[current_index].stage_ms[static_cast<std::size_t>(stage)] += elapsed;
+}
+
+std::vector<AssetTimes> get_asset_times() {
+    std::vector<AssetTimes> times;
+    {
+        std::lock_guard lock(mutex);
+        times = asset_times;
+    }
+    std::sort(times.begin(), times.end(),
+              [](auto const& a, auto const& b) { return a.total_ms > b.total_ms; });
+    return times;
+}
+
+std::vector<TypeTimes> get_type_times() {
+    std::vector<TypeTimes> times;
+    std::lock_guard lock(mutex);
+    for (auto const& asset : asset_times) {
+        auto type = std::find_if(times.begin(), times.end(), [&asset](auto const& t) {
+            return t.type_name == asset.type_name;
+        });
+        if (type == times.end())
+            type = times.insert(times.end(), TypeTimes{asset.type_name});
+        ++type->asset_count;
+        type->total_ms += asset.total_ms;
+        for (std::size_t i = 0; i < asset.stage_ms.size(); ++i)
+            type->stage_ms[i] += asset.stage_ms[i];
+    }
+    std::sort(times.begin(), times.end(),
+              [](auto const& a, auto const& b) { return a.total_ms > b.total_ms; });
+    return times;
+}
+
+void print_summary(std::ostream& out, std::size_t slowest_asset_count) {
+    const auto flags = out.flags();
+    const auto precision = out.precision();
+    out << std::fixed << std::setprecision(2);
+
+    out << "Load profile (" << get_session_ms() << "ms total)" << std::endl;
+    for (auto const& type : get_type_times()) {
+        out << "  " << type.type_name << ": " << type.asset_count << " assets, " << type.total_ms
+            << "ms (";
+        for (std::size_t i = 0; i < type.stage_ms.size(); ++i)
+            out << (i ? ", " : "") << stage_names[i] << " " << type.stage_ms[i] << "ms";
+        out << ")" << std::endl;
+    }
+
+    const auto assets = get_asset_times();
+    out << "Slowest assets:" << std::endl;
+    for (std::size_t i = 0; i < std::min(slowest_asset_count, assets.size()); ++i) {
+        out << "  " << assets[i].type_name << "/" << assets[i].id << ": " << assets[i].total_ms
+            << "ms" << std::endl;
+    }
+
+    out.flags(flags);
+    out.precision(precision);
+}
+
+void write_json_report(fs::path const& path) {
+    rapidjson::StringBuffer s;
+    rapidjson::PrettyWriter<rapidjson::StringBuffer> w(s);
+
+    w.StartObject();
+    w.Key("total_ms");
+    w.Double(get_session_ms());
+
+    w.Key("types");
+    w.StartArray();
+    for (auto const& type : get_type_times()) {
+        w.StartObject();
+        w.Key("type");
+        w.String(type.type_name.c_str());
+        w.Key("asset_count");
+        w.Uint64(type.asset_count);
+        w.Key("total_ms");
+        w.Double(type.total_ms);
+        write_stages(w, type.stage_ms);
+        w.EndObject();
+    }
+    w.EndArray();
+
+    w.Key("assets");
+    w.StartArray();
+    for (auto const& asset : get_asset_times()) {
+        w.StartObject();
+        w.Key("type");
+        w.String(asset.type_name.c_str());
+        w.Key("id");
+        w.Uint64(asset.id);
+        w.Key("total_ms");
+        w.Double(asset.total_ms);
+        write_stages(w, asset.stage_ms);
+        w.EndObject();
+    }
+    w.EndArray();
+    w.EndObject();
+
+    std::ofstream f(path);
+    f << s.GetString();
+}
+
+} // namespace arpiyi::load_profiler
@@ -0,0 +1,167 @@
+#include "pack.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+#include <limits>
+
+#ifdef _WIN32
+#    define WIN32_LEAN_AND_MEAN
+#    define NOMINMAX
+#    include <windows.h>
+#else
+#    include <fcntl.h>
+#    include <sys/mman.h>
+#    include <sys/stat.h>
+#    include <unistd.h>
+#endif
+
+namespace arpiyi::pack {
+
+static bool entry_less(TocEntry const& entry, std::pair<std::string_view, u64> const& key) {
+    return std::make_pair(entry.get_type_name(), entry.id) < key;
+}
+
+PackFile::PackFile(fs::path const& path) {
+#ifdef _WIN32
+    file_handle = CreateFileW(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+                              FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file_handle == INVALID_HANDLE_VALUE) {
+        file_handle = nullptr;
+        return;
+    }
+    LARGE_INTEGER file_size;
+    if (!GetFileSizeEx(file_handle, &file_size) || file_size.QuadPart == 0) {
+        unmap();
+        return;
+    }
+    mapping_handle = CreateFileMappingW(file_handle, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (!mapping_handle) {
+        unmap();
+        return;
+    }
+    mapping = MapViewOfFile(mapping_handle, FILE_MAP_READ, 0, 0, 0);
+    mapping_size = static_cast<std::size_t>(file_size.QuadPart);
+#else
+    const int fd = open(path.c_str(), O_RDONLY);
+    if (fd == -1)
+        return;
+    struct stat file_stat;
+    if (fstat(fd, &file_stat) == -1 || file_stat.st_size == 0) {
+        close(fd);
+        return;
+    }
+    mapping_size = static_cast<std::size_t>(file_stat.st_size);
+    void* ptr = mmap(nullptr, mapping_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    // The mapping stays valid after closing the descriptor.
+    close(fd);
+    if (ptr == MAP_FAILED)
+        return;
+    mapping = ptr;
+#endif
+    if (!mapping) {
+        unmap();
+        return;
+    }
+
+    Header header;
+    if (mapping_size < sizeof(Header)) {
+        std::cerr << "Pack file is too small to be valid." << std::endl;
+        unmap();
+        return;
+    }
+    std::memcpy(&header, mapping, sizeof(Header));
+    if (std::memcmp(header.magic, magic, sizeof(magic)) != 0 || header.version != format_version) {
+        std::cerr << "File is not a pack or was made with an incompatible version of arpiyi-pack."
+                  << std::endl;
+        unmap();
+        return;
+    }
+    if (header.toc_offset % alignof(TocEntry) != 0 || header.toc_offset > mapping_size ||
+        (mapping_size - header.toc_offset) / sizeof(TocEntry) < header.toc_count) {
+        std::cerr << "Pack file table of contents is out of bounds." << std::endl;
+        unmap();
+        return;
+    }
+    toc_begin = reinterpret_cast<TocEntry const*>(static_cast<const char*>(mapping) +
+                                                  header.toc_offset);
+    toc_end = toc_begin + header.toc_count;
+    for (auto const* entry = toc_begin; entry != toc_end; ++entry) {
+        if (entry->offset > mapping_size || entry->size > mapping_size - entry->offset) {
+            std::cerr << "Pack file entry " << entry->get_type_name() << "/" << entry->id
+                      << " is out of bounds." << std::endl;
+            unmap();
+            return;
+        }
+    }
+}
+
+PackFile::~PackFile() { unmap(); }
+
+void PackFile::unmap() {
+#ifdef _WIN32
+    if (mapping)
+        UnmapViewOfFile(mapping);
+    if (mapping_handle)
+        CloseHandle(mapping_handle);
+    if (file_handle)
+        CloseHandle(file_handle);
+    mapping_handle = nullptr;
+    file_handle = nullptr;
+#else
+    if (mapping)
+        munmap(const_cast<void*>(mapping), mapping_size);
+#endif
+    mapping = nullptr;
+    mapping_size = 0;
+    toc_begin = toc_end = nullptr;
+}
+
+std::pair<TocEntry const*, TocEntry const*>
+PackFile::get_entries(std::string_view type_name) const {
+    auto const* begin = std::lower_bound(toc_begin, toc_end, std::make_pair(type_name, u64(0)),
+                                         entry_less);
+    auto const* end = std::partition_point(begin, toc_end, [type_name](TocEntry const& entry) {
+        return entry.get_type_name() == type_name;
+    });
+    return {begin, end};
+}
+
+TocEntry const* PackFile::find(std::string_view type_name, u64 id) const {
+    const auto key = std::make_pair(type_name, id);
+    auto const* entry = std::lower_bound(toc_begin, toc_end, key, entry_less);
+    if (entry == toc_end || entry->get_type_name() != type_name || entry->id != id)
+        return nullptr;
+    return entry;
+}
+
+template<>
+assets::PreparedLoad<assets::Texture> prepare_packed_load<assets::Texture>(std::string_view data) {
+    // Packs are read as they are, so textures with data that doesn't fit their size are reported
+    // and left without pixels, like textures whose file can't be decoded.
+    assets::PreparedLoad<assets::Texture> prepared;
+    if (data.size() < payload_alignment) {
+        std::cerr << "Packed texture is too small to be valid." << std::endl;
+        return prepared;
+    }
+    TexturePayloadHeader header;
+    std::memcpy(&header, data.data(), sizeof(TexturePayloadHeader));
+    constexpr u64 max_size = static_cast<u64>(std::numeric_limits<int>::max());
+    const u64 available = data.size() - payload_alignment;
+    if (header.w > max_size || header.h > max_size ||
+        (header.h != 0 && static_cast<u64>(header.w) > available / 4 / header.h)) {
+        std::cerr << "Packed texture of " << header.w << "x" << header.h
+                  << " pixels doesn't fit in its entry." << std::endl;
+        return prepared;
+    }
+    prepared.w = static_cast<int>(header.w);
+    prepared.h = static_cast<int>(header.h);
+    prepared.data = reinterpret_cast<unsigned char const*>(data.data() + payload_alignment);
+    return prepared;
+}
+
+template<> assets::PreparedLoad<assets::Map> prepare_packed_load<assets::Map>(std::string_view data) {
+    return assets::prepare_map_load_from_memory(data);
+}
+
+} // namespace arpiyi::pack
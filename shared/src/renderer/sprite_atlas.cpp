@@ -0,0 +1,185 @@
+#include "renderer/sprite_atlas.hpp"
+
+/* clang-format off */
+#include <glad/glad.h>
+#include <GLFW/glfw3.h>
+/* clang-format on */
+
+#include <algorithm>
+#include <cmath>
+#include <map>
+#include <tuple>
+
+namespace arpiyi::renderer {
+
+SkylinePacker::SkylinePacker(i32 width, i32 height) :
+    width(width), height(height), skyline{{0, 0, width}} {}
+
+std::optional<i32> SkylinePacker::fit(std::size_t node_index, math::IVec2D size) const {
+    const i32 x = skyline[node_index].x;
+    if (x + size.x > width)
+        return std::nullopt;
+    i32 y = skyline[node_index].y;
+    i32 width_left = size.x;
+    // Nodes cover the whole bin width, so this never goes past the last one
+    for (std::size_t i = node_index; width_left > 0; ++i) {
+        y = std::max(y, skyline[i].y);
+        if (y + size.y > height)
+            return std::nullopt;
+        width_left -= skyline[i].width;
+    }
+    return y;
+}
+
+std::optional<math::IVec2D> SkylinePacker::pack(math::IVec2D size) {
+    std::size_t best_index = skyline.size();
+    i32 best_y = height;
+    i32 best_width = width;
+    for (std::size_t i = 0; i < skyline.size(); ++i) {
+        if (const auto y = fit(i, size)) {
+            // Prefer the lowest position, then the narrowest node to leave less wasted space
+            if (*y < best_y || (*y == best_y && skyline[i].width < best_width)) {
+                best_index = i;
+                best_y = *y;
+                best_width = skyline[i].width;
+            }
+        }
+    }
+    if (best_index == skyline.size())
+        return std::nullopt;
+
+    const math::IVec2D pos{skyline[best_index].x, best_y};
+    skyline.insert(skyline.begin() + best_index, Node{pos.x, pos.y + size.y, size.x});
+
+    // Shrink or remove the nodes now covered by the new one
+    for (std::size_t i = best_index + 1; i < skyline.size();) {
+        const auto& prev = skyline[i - 1];
+        auto& node = skyline[i];
+        if (node.x >= prev.x + prev.width)
+            break;
+        const i32 shrink = prev.x + prev.width - node.x;
+        node.x += shrink;
+        node.width -= shrink;
+        if (node.width > 0)
+            break;
+        skyline.erase(skyline.begin() + i);
+    }
+
+    // Merge neighbouring nodes at the same height
+    for (std::size_t i = 0; i + 1 < skyline.size();) {
+        if (skyline[i].y == skyline[i + 1].y) {
+            skyline[i].width += skyline[i + 1].width;
+            skyline.erase(skyline.begin() + i + 1);
+        } else {
+            ++i;
+        }
+    }
+
+    return pos;
+}
+
+void SpriteAtlas::build(i32 atlas_size) {
+    destroy();
+
+    GLint max_texture_size;
+    glGetIntegerv(GL_MAX_TEXTURE_SIZE, &max_texture_size);
+    atlas_size = std::min(atlas_size, static_cast<i32>(max_texture_size));
+    // Keep a texel between regions so that they don't bleed into each other
+    constexpr i32 padding = 1;
+
+    struct SourceRect {
+        u64 sprite_id;
+        Handle<assets::Texture> texture;
+        math::IVec2D pos;
+        math::IVec2D size;
+    };
+    std::vector<SourceRect> source_rects;
+    for (auto& [id, sprite] : detail::AssetContainer<assets::Sprite>::get_instance().storage) {
+        auto texture = sprite.texture.get();
+        if (!texture)
+            continue;
+        // UVs might be flipped, so don't assume min < max
+        const i32 x0 = std::floor(std::min(sprite.uv_min.x, sprite.uv_max.x) * texture->w);
+        const i32 y0 = std::floor(std::min(sprite.uv_min.y, sprite.uv_max.y) * texture->h);
+        const i32 x1 = std::ceil(std::max(sprite.uv_min.x, sprite.uv_max.x) * texture->w);
+        const i32 y1 = std::ceil(std::max(sprite.uv_min.y, sprite.uv_max.y) * texture->h);
+        const math::IVec2D pos{std::clamp<i32>(x0, 0, texture->w),
+                               std::clamp<i32>(y0, 0, texture->h)};
+        const math::IVec2D size{std::clamp<i32>(x1, 0, texture->w) - pos.x,
+                                std::clamp<i32>(y1, 0, texture->h) - pos.y};
+        if (size.x <= 0 || size.y <= 0 || size.x + padding > atlas_size ||
+            size.y + padding > atlas_size)
+            continue;
+        source_rects.emplace_back(SourceRect{id, sprite.texture, pos, size});
+    }
+    // Packing the tallest rects first gives a much flatter skyline
+    std::sort(source_rects.begin(), source_rects.end(),
+              [](SourceRect const& a, SourceRect const& b) { return a.size.y > b.size.y; });
+
+    const auto new_atlas = [&]() {
+        unsigned int tex;
+        glGenTextures(1, &tex);
+        glBindTexture(GL_TEXTURE_2D, tex);
+        glTexStorage2D(GL_TEXTURE_2D, 1, GL_RGBA8, atlas_size, atlas_size);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        glClearTexImage(tex, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+        atlases.emplace_back(tex);
+    };
+
+    std::vector<SkylinePacker> packers;
+    // Sprites using the exact same texture region share the same place in the atlas
+    std::map<std::tuple<u64, i32, i32, i32, i32>, std::pair<std::size_t, math::IVec2D>> packed;
+    for (const auto& rect : source_rects) {
+        const auto key = std::make_tuple(rect.texture.get_id(), rect.pos.x, rect.pos.y,
+                                         rect.size.x, rect.size.y);
+        auto it = packed.find(key);
+        if (it == packed.end()) {
+            const math::IVec2D padded_size{rect.size.x + padding, rect.size.y + padding};
+            std::optional<math::IVec2D> dst;
+            std::size_t atlas_index = 0;
+            for (; atlas_index < packers.size(); ++atlas_index) {
+                if ((dst = packers[atlas_index].pack(padded_size)))
+                    break;
+            }
+            if (!dst) {
+                new_atlas();
+                dst = packers.emplace_back(atlas_size, atlas_size).pack(padded_size);
+                atlas_index = packers.size() - 1;
+                assert(dst);
+            }
+
+            glCopyImageSubData(rect.texture.get()->handle, GL_TEXTURE_2D, 0, rect.pos.x,
+                               rect.pos.y, 0, atlases[atlas_index], GL_TEXTURE_2D, 0, dst->x,
+                               dst->y, 0, rect.size.x, rect.size.y, 1);
+            it = packed.emplace(key, std::make_pair(atlas_index, *dst)).first;
+        }
+
+        const auto& [atlas_index, dst] = it->second;
+        const auto& sprite = *Handle<assets::Sprite>(rect.sprite_id).get();
+        const auto& texture = *rect.texture.get();
+        // Move the original UVs to the same place relative to the copied region
+        const auto to_atlas_uv = [&, dst = dst](aml::Vector2 uv) -> aml::Vector2 {
+            return {(dst.x + uv.x * texture.w - rect.pos.x) / atlas_size,
+                    (dst.y + uv.y * texture.h - rect.pos.y) / atlas_size};
+        };
+        regions[rect.sprite_id] = Region{atlases[atlas_index], to_atlas_uv(sprite.uv_min),
+                                         to_atlas_uv(sprite.uv_max)};
+    }
+}
+
+SpriteAtlas::Region const* SpriteAtlas::find(Handle<assets::Sprite> sprite) const {
+    const auto it = regions.find(sprite.get_id());
+    return it == regions.end() ? nullptr : &it->second;
+}
+
+void SpriteAtlas::destroy() {
+    if (!atlases.empty())
+        glDeleteTextures(static_cast<GLsizei>(atlases.size()), atlases.data());
+    atlases.clear();
+    regions.clear();
+}
+
+} // namespace arpiyi::renderer
@@ -0,0 +1,129 @@
+#include "renderer/sprite_batch.hpp"
+
+/* clang-format off */
+#include <glad/glad.h>
+#include <GLFW/glfw3.h>
+/* clang-format on */
+
+#include <algorithm>
+#include <chrono>
+
+namespace arpiyi::renderer {
+
+// Format: {pos.x pos.y uv.x uv.y ...}
+constexpr auto sizeof_vertex = 4;
+constexpr auto sizeof_quad = 6 * sizeof_vertex;
+
+void SpriteBatch::begin() { sprites.clear(); }
+
+void SpriteBatch::draw(unsigned int texture,
+                       aml::Vector2 pos,
+                       aml::Vector2 size,
+                       aml::Vector2 uv_min,
+                       aml::Vector2 uv_max) {
+    sprites.emplace_back(QueuedSprite{texture, pos, size, uv_min, uv_max});
+}
+
+void SpriteBatch::end() {
+    const auto start_time = std::chrono::steady_clock::now();
+    stats.sprites = sprites.size();
+    stats.draw_calls = 0;
+    if (sprites.empty()) {
+        stats.submit_time_ms = 0;
+        return;
+    }
+
+    vertices.resize(sprites.size() * sizeof_quad);
+    for (std::size_t i = 0; i < sprites.size(); ++i) {
+        const auto& s = sprites[i];
+        const float min_x = s.pos.x, min_y = s.pos.y;
+        const float max_x = s.pos.x + s.size.x, max_y = s.pos.y + s.size.y;
+        float* quad = &vertices[i * sizeof_quad];
+        // First triangle //
+        /* X pos 1st vertex */ quad[0] = min_x;
+        /* Y pos 1st vertex */ quad[1] = min_y;
+        /* X UV 1st vertex  */ quad[2] = s.uv_min.x;
+        /* Y UV 1st vertex  */ quad[3] = s.uv_min.y;
+        /* X pos 2nd vertex */ quad[4] = max_x;
+        /* Y pos 2nd vertex */ quad[5] = min_y;
+        /* X UV 2nd vertex  */ quad[6] = s.uv_max.x;
+        /* Y UV 2nd vertex  */ quad[7] = s.uv_min.y;
+        /* X pos 3rd vertex */ quad[8] = min_x;
+        /* Y pos 3rd vertex */ quad[9] = max_y;
+        /* X UV 3rd vertex  */ quad[10] = s.uv_min.x;
+        /* Y UV 3rd vertex  */ quad[11] = s.uv_max.y;
+
+        // Second triangle //
+        /* X pos 1st vertex */ quad[12] = max_x;
+        /* Y pos 1st vertex */ quad[13] = min_y;
+        /* X UV 1st vertex  */ quad[14] = s.uv_max.x;
+        /* Y UV 1st vertex  */ quad[15] = s.uv_min.y;
+        /* X pos 2nd vertex */ quad[16] = max_x;
+        /* Y pos 2nd vertex */ quad[17] = max_y;
+        /* X UV 2nd vertex  */ quad[18] = s.uv_max.x;
+        /* Y UV 2nd vertex  */ quad[19] = s.uv_max.y;
+        /* X pos 3rd vertex */ quad[20] = min_x;
+        /* Y pos 3rd vertex */ quad[21] = max_y;
+        /* X UV 3rd vertex  */ quad[22] = s.uv_min.x;
+        /* Y UV 3rd vertex  */ quad[23] = s.uv_max.y;
+    }
+
+    if (vao == noobj) {
+        glGenVertexArrays(1, &vao);
+        glGenBuffers(1, &vbo);
+
+        glBindVertexArray(vao);
+        // Vertex Positions
+        glEnableVertexAttribArray(0); // location 0
+        glVertexAttribFormat(0, 2, GL_FLOAT, GL_FALSE, 0);
+        glBindVertexBuffer(0, vbo, 0, sizeof_vertex * sizeof(float));
+        glVertexAttribBinding(0, 0);
+        // UV Positions
+        glEnableVertexAttribArray(1); // location 1
+        glVertexAttribFormat(1, 2, GL_FLOAT, GL_FALSE, 2 * sizeof(float));
+        glBindVertexBuffer(1, vbo, 0, sizeof_vertex * sizeof(float));
+        glVertexAttribBinding(1, 1);
+    }
+
+    const u64 vertices_size = vertices.size() * sizeof(float);
+    glBindBuffer(GL_ARRAY_BUFFER, vbo);
+    // Grow geometrically so that adding a few more sprites doesn't reallocate every frame
+    if (vertices_size > vbo_capacity)
+        vbo_capacity = std::max(vertices_size, vbo_capacity * 2);
+    // Orphan the previous storage so that we don't wait for the last batch's draws to finish
+    glBufferData(GL_ARRAY_BUFFER, vbo_capacity, nullptr, GL_STREAM_DRAW);
+    glBufferSubData(GL_ARRAY_BUFFER, 0, vertices_size, vertices.data());
+
+    glBindVertexArray(vao);
+    constexpr int quad_verts = 2 * 3;
+    // Sprites are not reordered since they may overlap; Only consecutive sprites that share a
+    // texture are merged into a single draw call
+    std::size_t run_start = 0;
+    for (std::size_t i = 1; i <= sprites.size(); ++i) {
+        if (i != sprites.size() && sprites[i].texture == sprites[run_start].texture)
+            continue;
+        glBindTexture(GL_TEXTURE_2D, sprites[run_start].texture);
+        glDrawArrays(GL_TRIANGLES, run_start * quad_verts, (i - run_start) * quad_verts);
+        ++stats.draw_calls;
+        run_start = i;
+    }
+
+    sprites.clear();
+    stats.submit_time_ms = std::chrono::duration<float, std::milli>(
+                               std::chrono::steady_clock::now() - start_time)
+                               .count();
+}
+
+void SpriteBatch::destroy() {
+    if (vao != noobj) {
+        glDeleteVertexArrays(1, &vao);
+        vao = noobj;
+    }
+    if (vbo != noobj) {
+        glDeleteBuffers(1, &vbo);
+        vbo = noobj;
+    }
+    vbo_capacity = 0;
+}
+
+} // namespace arpiyi::renderer
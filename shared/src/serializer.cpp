@@ -0,0 +1,52 @@
+#include "serializer.hpp"
+
+#include "assets/json_asset.hpp"
+
+namespace arpiyi::serializer {
+
+AssetSource::AssetSource(fs::path const& path) : project_path(path) {
+    if (fs::is_regular_file(path)) {
+        pack = std::make_unique<pack::PackFile>(path);
+        return;
+    }
+
+    namespace mfd = detail::meta_file_definitions;
+    const fs::path meta_dir = path / detail::project_file_definitions::metadata_path;
+    if (!fs::is_directory(meta_dir))
+        return;
+    // Every metadata file is named after the directory of the asset type it indexes
+    for (auto const& meta_file : fs::directory_iterator(meta_dir)) {
+        if (meta_file.path().extension() != ".json")
+            continue;
+        const rapidjson::Document doc = assets::parse_json_file(meta_file.path());
+        if (doc.HasParseError() || !doc.IsArray())
+            continue;
+        auto& paths = asset_paths[meta_file.path().stem().generic_string()];
+        for (auto const& asset_meta : doc.GetArray()) {
+            paths.emplace(asset_meta[mfd::id_json_key.data()].GetUint64(),
+                          path / asset_meta[mfd::path_json_key.data()].GetString());
+        }
+    }
+}
+
+bool AssetSource::is_open() const {
+    return pack ? pack->is_open() : fs::exists(project_path / "project.json");
+}
+
+rapidjson::Document AssetSource::read_project_file() const {
+    if (pack) {
+        auto const* entry = pack->find(pack::project_file_type_name, 0);
+        return entry ? assets::parse_json_data(pack->get_data(*entry)) : rapidjson::Document{};
+    }
+    return assets::parse_json_file(project_path / "project.json");
+}
+
+fs::path const* AssetSource::find_path(std::string_view type_name, u64 id) const {
+    const auto type_paths = asset_paths.find(std::string(type_name));
+    if (type_paths == asset_paths.end())
+        return nullptr;
+    const auto path = type_paths->second.find(id);
+    return path == type_paths->second.end() ? nullptr : &path->second;
+}
+
+} // namespace arpiyi::serializer